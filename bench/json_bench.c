@@ -0,0 +1,480 @@
+/*
+ * Throughput and latency of the public entry points over a generated corpus.
+ *
+ *   json_bench [-f text|csv|json] [-t seconds] [-s seed] [-e entry] [-d doc]
+ *
+ * The corpus is rebuilt from the seed on every run (small/medium/large,
+ * flat/nested, number/string heavy documents), so results of two builds are
+ * comparable. Every document is a root object holding "id", "name", "value"
+ * and an "items" array of records, the members each entry point queries.
+ * -e and -d keep the entries/documents whose name contains the argument.
+ * csv and json print one row per entry and document for regression tracking.
+ */
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "json_parser.h"
+#include "json_jsmn_scan.h"
+
+#define BENCH_WARMUP				3
+#define BENCH_MIN_ITERATIONS		5
+#define BENCH_MAX_SAMPLES			200000
+
+#define BENCH_NESTED				0x01
+#define BENCH_STRINGS				0x02
+
+struct bench_buffer
+{
+	char *data;
+	size_t len, cap;
+};
+
+struct bench_doc
+{
+	char name[32];
+	struct bench_buffer js;
+	int tokcount;
+};
+
+struct bench_entry
+{
+	const char *name;
+	int (*run)(const struct bench_doc *doc);
+};
+
+struct bench_result
+{
+	unsigned long iterations;
+	double seconds;
+	double p50, p90, p99, max;				// microseconds
+};
+
+static json_jsmn_token_t *bench_tokens;
+static uint64_t bench_rng;
+
+static uint64_t bench_random(void)
+{
+	// xorshift64*, fixed for a given seed on every platform
+	bench_rng ^= bench_rng >> 12;
+	bench_rng ^= bench_rng << 25;
+	bench_rng ^= bench_rng >> 27;
+	return bench_rng * 0x2545f4914f6cdd1dULL;
+}
+
+static double bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void bench_printf(struct bench_buffer *b, const char *fmt, ...)
+{
+	va_list args;
+	int n;
+
+	for(;;)
+	{
+		va_start(args, fmt);
+		n = vsnprintf(b->data + b->len, b->cap - b->len, fmt, args);
+		va_end(args);
+		if(n >= 0 && (size_t)n < b->cap - b->len)
+		{
+			b->len += n;
+			return;
+		}
+		b->cap = b->cap ? b->cap * 2 : 4096;
+		b->data = realloc(b->data, b->cap);
+		if(!b->data)
+		{
+			fprintf(stderr, "out of memory\n");
+			exit(1);
+		}
+	}
+}
+
+static void bench_scalar(struct bench_buffer *b, int shape)
+{
+	static const char *words[] = { "alpha", "bravo", "charlie", "delta", "echo", "foxtrot" };
+	uint64_t r = bench_random();
+
+	if(shape & BENCH_STRINGS)
+	{
+		// some strings need unescaping
+		bench_printf
+			(
+				b, r & 7 ? "\"%s %s %lu\"" : "\"%s \\\"%s\\\" \\u00e9%lu\"",
+				words[r % 6], words[(r >> 8) % 6], (unsigned long)(r >> 40)
+			);
+	}
+	else if(r & 1)
+	{
+		bench_printf(b, "%ld", (long)(r >> 33) - (1L << 29));
+	}
+	else
+	{
+		bench_printf(b, "%lu.%03lue%d", (unsigned long)(r >> 44), (unsigned long)(r >> 20) % 1000, (int)(r % 9) - 4);
+	}
+}
+
+static void bench_record(struct bench_buffer *b, int shape, int depth)
+{
+	int i, n;
+
+	bench_printf(b, "{\"id\":%lu,\"name\":", (unsigned long)(bench_random() >> 40));
+	bench_scalar(b, BENCH_STRINGS);
+	for(i = 0, n = 4 + bench_random() % 4; i < n; i++)
+	{
+		bench_printf(b, ",\"f%d\":", i);
+		bench_scalar(b, shape);
+	}
+	if((shape & BENCH_NESTED) && depth < 3)
+	{
+		bench_printf(b, ",\"list\":[");
+		for(i = 0, n = 1 + bench_random() % 3; i < n; i++)
+		{
+			if(i)
+			{
+				bench_printf(b, ",");
+			}
+			bench_scalar(b, shape);
+		}
+		bench_printf(b, "],\"child\":");
+		bench_record(b, shape, depth + 1);
+	}
+	bench_printf(b, "}");
+}
+
+static void bench_generate(struct bench_doc *doc, const char *size_name, size_t size, int shape)
+{
+	struct bench_buffer *b = &doc->js;
+	int i;
+
+	snprintf
+		(
+			doc->name, sizeof(doc->name), "%s-%s-%s",
+			size_name, shape & BENCH_NESTED ? "nested" : "flat", shape & BENCH_STRINGS ? "str" : "num"
+		);
+	bench_printf(b, "{\"id\":%lu,\"name\":\"%s\",\"value\":3.25,\"items\":[", (unsigned long)(bench_random() >> 40), doc->name);
+	for(i = 0; !i || b->len + 2 < size; i++)
+	{
+		if(i)
+		{
+			bench_printf(b, ",");
+		}
+		if(shape & BENCH_NESTED)
+		{
+			bench_record(b, shape, 0);
+		}
+		else
+		{
+			bench_scalar(b, shape);
+		}
+	}
+	bench_printf(b, "]}");
+	doc->tokcount = json_parse_count(b->data, b->len);
+}
+
+static int bench_document(const struct bench_doc *doc)
+{
+	json_jsmn_t jjs;
+
+	return json_parse_document(&jjs, doc->js.data, doc->js.len, bench_tokens, doc->tokcount, NULL);
+}
+
+static const char *bench_keys[] = { "id", "name", "items", NULL };
+
+static int bench_parse(const struct bench_doc *doc)
+{
+	json_jsmntok_t toks[3];
+
+	return json_parse(doc->js.data, doc->js.len, bench_tokens, doc->tokcount, bench_keys, toks, 3);
+}
+
+static int bench_parse_fmt(const struct bench_doc *doc)
+{
+	json_jsmntok_t id, name, items;
+
+	return json_parse_fmt(doc->js.data, doc->js.len, bench_tokens, doc->tokcount, bench_keys, 3, &id, &name, &items);
+}
+
+struct bench_record
+{
+	int32_t id;
+	char name[64];
+	double value;
+};
+
+#define bench_objects(objs, rec)																								\
+	json_jsmn_object_t objs[] =																									\
+	{																															\
+		{ "id", &(rec).id, sizeof((rec).id), JSMN_PRIMITIVE, JSON_JSMN_EMPTY, NULL, JSON_JSMN_VTYPE_INT32 },					\
+		{ "name", (rec).name, sizeof((rec).name), JSMN_STRING, JSON_JSMN_EMPTY, NULL, JSON_JSMN_VTYPE_AUTO },					\
+		{ "value", &(rec).value, sizeof((rec).value), JSMN_PRIMITIVE, JSON_JSMN_EMPTY, NULL, JSON_JSMN_VTYPE_DOUBLE },		\
+	}
+
+static int bench_parse_object(const struct bench_doc *doc)
+{
+	struct bench_record rec;
+	bench_objects(objs, rec);
+
+	return json_parse_object(doc->js.data, doc->js.len, bench_tokens, doc->tokcount, objs, 3);
+}
+
+static int bench_parse_object_fmt(const struct bench_doc *doc)
+{
+	struct bench_record rec;
+	bench_objects(objs, rec);
+
+	return json_parse_object_fmt(doc->js.data, doc->js.len, bench_tokens, doc->tokcount, 3, &objs[0], &objs[1], &objs[2]);
+}
+
+static int bench_element_callback(int index, jsmntype_t type, void *value, int len, void *callback_args)
+{
+	*(long *)callback_args += len;
+	return 0;
+}
+
+static int bench_parse_array(const struct bench_doc *doc)
+{
+	long total = 0;
+
+	return json_parse_array(doc->js.data, doc->js.len, bench_tokens, doc->tokcount, "items", bench_element_callback, &total);
+}
+
+static const struct bench_entry bench_entries[] =
+{
+	{ "json_parse_document", bench_document },
+	{ "json_parse", bench_parse },
+	{ "json_parse_fmt", bench_parse_fmt },
+	{ "json_parse_object", bench_parse_object },
+	{ "json_parse_object_fmt", bench_parse_object_fmt },
+	{ "json_parse_array", bench_parse_array },
+};
+
+static int bench_compare(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static double bench_percentile(const double *sorted, unsigned long n, double p)
+{
+	return sorted[(unsigned long)(p * (n - 1) + 0.5)];
+}
+
+static int bench_measure
+	(
+		const struct bench_entry *entry,
+		const struct bench_doc *doc,
+		double min_seconds,
+		double *samples,
+		struct bench_result *result
+	)
+{
+	double start, t;
+	unsigned long i;
+	int rc = 0;
+
+	for(i = 0; i < BENCH_WARMUP; i++)
+	{
+		rc = entry->run(doc);
+	}
+	if(rc < 0)
+	{
+		return rc;
+	}
+
+	start = bench_now();
+	for(i = 0; i < BENCH_MAX_SAMPLES && (i < BENCH_MIN_ITERATIONS || bench_now() - start < min_seconds); i++)
+	{
+		t = bench_now();
+		entry->run(doc);
+		samples[i] = (bench_now() - t) * 1e6;
+	}
+	result->seconds = bench_now() - start;
+	result->iterations = i;
+
+	qsort(samples, i, sizeof(*samples), bench_compare);
+	result->p50 = bench_percentile(samples, i, 0.50);
+	result->p90 = bench_percentile(samples, i, 0.90);
+	result->p99 = bench_percentile(samples, i, 0.99);
+	result->max = samples[i - 1];
+	return 0;
+}
+
+static void bench_print
+	(
+		const char *format, int first,
+		const struct bench_entry *entry,
+		const struct bench_doc *doc,
+		const struct bench_result *r
+	)
+{
+	double mbs = r->iterations * doc->js.len / r->seconds / 1e6;
+	double docs = r->iterations / r->seconds;
+
+	if(!strcmp(format, "csv"))
+	{
+		if(first)
+		{
+			printf("entry,doc,bytes,tokens,iterations,mb_s,docs_s,p50_us,p90_us,p99_us,max_us\n");
+		}
+		printf
+			(
+				"%s,%s,%lu,%d,%lu,%.2f,%.1f,%.3f,%.3f,%.3f,%.3f\n",
+				entry->name, doc->name, (unsigned long)doc->js.len, doc->tokcount, r->iterations,
+				mbs, docs, r->p50, r->p90, r->p99, r->max
+			);
+	}
+	else if(!strcmp(format, "json"))
+	{
+		printf
+			(
+				"%s\n  {\"entry\":\"%s\",\"doc\":\"%s\",\"bytes\":%lu,\"tokens\":%d,\"iterations\":%lu,"
+				"\"mb_s\":%.2f,\"docs_s\":%.1f,\"p50_us\":%.3f,\"p90_us\":%.3f,\"p99_us\":%.3f,\"max_us\":%.3f}",
+				first ? "" : ",",
+				entry->name, doc->name, (unsigned long)doc->js.len, doc->tokcount, r->iterations,
+				mbs, docs, r->p50, r->p90, r->p99, r->max
+			);
+	}
+	else
+	{
+		if(first)
+		{
+			printf
+				(
+					"%-22s %-18s %9s %9s %12s %10s %10s %10s\n",
+					"entry", "doc", "bytes", "MB/s", "docs/s", "p50 us", "p99 us", "max us"
+				);
+		}
+		printf
+			(
+				"%-22s %-18s %9lu %9.1f %12.0f %10.2f %10.2f %10.2f\n",
+				entry->name, doc->name, (unsigned long)doc->js.len, mbs, docs, r->p50, r->p99, r->max
+			);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	static const struct
+	{
+		const char *name;
+		size_t size;
+	}sizes[] = { { "small", 256 }, { "medium", 16 * 1024 }, { "large", 1024 * 1024 } };
+	struct bench_doc docs[3 * 4];
+	struct bench_result result;
+	const char *format = "text", *entry_filter = "", *doc_filter = "";
+	double seconds = 0.2, *samples;
+	unsigned long seed = 1;
+	int doc_count = 0, tokmax = 0, first = 1;
+	int c, i, j, shape;
+
+	while((c = getopt(argc, argv, "f:t:s:e:d:")) != -1)
+	{
+		switch(c)
+		{
+		case 'f':
+			format = optarg;
+			break;
+		case 't':
+			seconds = atof(optarg);
+			break;
+		case 's':
+			seed = strtoul(optarg, NULL, 0);
+			break;
+		case 'e':
+			entry_filter = optarg;
+			break;
+		case 'd':
+			doc_filter = optarg;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-f text|csv|json] [-t seconds] [-s seed] [-e entry] [-d doc]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	bench_rng = seed ? seed : 1;
+	memset(docs, 0, sizeof(docs));
+	for(i = 0; i < 3; i++)
+	{
+		for(shape = 0; shape < 4; shape++)
+		{
+			bench_generate(&docs[doc_count], sizes[i].name, sizes[i].size, shape);
+			if(docs[doc_count].tokcount > tokmax)
+			{
+				tokmax = docs[doc_count].tokcount;
+			}
+			doc_count++;
+		}
+	}
+
+	bench_tokens = malloc(tokmax * sizeof(*bench_tokens));
+	samples = malloc(BENCH_MAX_SAMPLES * sizeof(*samples));
+	if(!bench_tokens || !samples)
+	{
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	if(!strcmp(format, "json"))
+	{
+		printf
+			(
+				"{\"seed\":%lu,\"scan\":\"%s\",\"compact_tokens\":%d,\"results\":[",
+				seed, json_jsmn_scan_impl(),
+#ifdef JSON_JSMN_COMPACT_TOKENS
+				1
+#else
+				0
+#endif
+			);
+	}
+	else if(!strcmp(format, "text"))
+	{
+		printf("seed %lu, scanner %s, %.2fs per measure\n", seed, json_jsmn_scan_impl(), seconds);
+	}
+
+	for(i = 0; i < (int)(sizeof(bench_entries) / sizeof(bench_entries[0])); i++)
+	{
+		if(!strstr(bench_entries[i].name, entry_filter))
+		{
+			continue;
+		}
+		for(j = 0; j < doc_count; j++)
+		{
+			if(!strstr(docs[j].name, doc_filter))
+			{
+				continue;
+			}
+			if(bench_measure(&bench_entries[i], &docs[j], seconds, samples, &result))
+			{
+				fprintf(stderr, "%s failed on %s\n", bench_entries[i].name, docs[j].name);
+				return 1;
+			}
+			bench_print(format, first, &bench_entries[i], &docs[j], &result);
+			first = 0;
+		}
+	}
+
+	if(!strcmp(format, "json"))
+	{
+		printf("\n]}\n");
+	}
+
+	for(j = 0; j < doc_count; j++)
+	{
+		free(docs[j].js.data);
+	}
+	free(samples);
+	free(bench_tokens);
+	return 0;
+}
@@ -4,6 +4,9 @@
 #include <string.h>
 #include <stdarg.h>
 #include "json_jsmn.h"
+#include "json_jsmn_number.h"
+#include "json_jsmn_string.h"
+#include "json_jsmn_stats.h"
 
 #ifndef assert
 #define assert(c)
@@ -26,25 +29,25 @@ typedef enum { START, KEY, VALUE, SKIP, STOP } parse_state;
 typedef int (*json_jsmn_get_key_t)
 		(
 			const char *js,		// input json
-			const jsmntok_t *t,	// input token
+			const json_jsmn_token_t *t,	// input token
 			void *args
 		);
 typedef int (*json_jsmn_get_value_t)
 		(
 			const char *js,
-			const jsmntok_t *t, size_t t_count,
+			const json_jsmn_token_t *t, size_t t_count,
 			void *args
 		);
 
-#define jsmn_object_size(t,t_count)	json_jsmn_get_value(NULL,t,t_count,NULL,0)
 static int json_jsmn_get_value
 	(
 		const char *js,
-		const jsmntok_t *t, size_t t_count,
+		const json_jsmn_token_t *t, size_t t_count,
+		json_jsmn_vtype_t vtype,
 		void *out, int size
 	)
 {
-	int i, j;
+	json_jsmn_string_t str;
 
 	if (t_count == 0)
 	{
@@ -56,85 +59,285 @@ static int json_jsmn_get_value
 	case JSMN_STRING:
 		if(js && out && size)
 		{
-			i = t->end - t->start + 1;
-			if(size > i)
-				size = i;
-			strlcpy((char *)out, js + t->start, size);
+			// copied as is unless the body holds escapes, NUL terminated
+			json_jsmn_token_string(js, t, &str);
+			if(0 > json_jsmn_string_copy(&str, (char *)out, size))
+			{
+				return -1;
+			}
 		}
 		return 1;
 	case JSMN_PRIMITIVE:
 		if(js && out && size)
 		{
-			long n;
-
-			if(0 == strncmp(js + t->start, "true", 4))
-			{
-				n = 1;
-			}
-			else if(0 == strncmp(js + t->start, "true", 4))
+			if(0 > json_jsmn_number_decode(js + t->start, t->end - t->start, vtype, out, size))
 			{
-				n = 0;
-			}
-			else
-			{
-				n = strtol(js + t->start, NULL, 10);
+				return -1;
 			}
+		}
+		return 1;
 
-			switch(size)
-			{
-				case sizeof(uint64_t):
-				{
-					int64_t value = n;
-					memcpy(out, &value, size);
-				}
-				break;
+	case JSMN_OBJECT:
+	case JSMN_ARRAY:
+		// t_count is the subtree span, the whole container is consumed
+		return t_count;
 
-				case sizeof(int32_t):
-				{
-					int32_t value = n;
-					memcpy(out, &value, size);
-				}
-				break;
+	default:
+		return 0;
+	}
+}
 
-				case sizeof(int16_t):
-				{
-					int16_t value = n;
-					memcpy(out, &value, size);
-				}
+void json_jsmn_init
+	(
+		json_jsmn_t *jjs,
+		const char *js,
+		const json_jsmn_token_t *tokens, unsigned int token_count
+	)
+{
+	jjs->js = js;
+	jjs->tokens = tokens;
+	jjs->token_count = token_count;
+	jjs->spans = NULL;
+}
 
-				case sizeof(int8_t):
-				{
-					int8_t value = n;
-					memcpy(out, &value, size);
-				}
-			}
+int json_jsmn_index
+	(
+		json_jsmn_t *jjs,
+		unsigned int *spans, unsigned int spans_count
+	)
+{
+#ifdef JSON_JSMN_COMPACT_TOKENS
+	// compact tokens carry their span, there is nothing to build
+	return 0;
+#else
+	unsigned int i, j;
+	int k;
+
+	if(spans_count < jjs->token_count)
+	{
+		return JSMN_ERROR_NOMEM;
+	}
+
+	/*
+	 * Tokens are stored in pre-order, so walking backwards guarantees that the
+	 * span of every child is known before its parent: a token spans itself
+	 * plus the spans of its t->size direct children.
+	 */
+	for(i = jjs->token_count; i-- > 0;)
+	{
+		for(j = i + 1, k = 0; k < jjs->tokens[i].size && j < jjs->token_count; k++)
+		{
+			j += spans[j];
 		}
-		return 1;
+		spans[i] = j - i;
+	}
 
-	case JSMN_OBJECT:
-		// bypass
-		j = 0;
-		for (i = 0; i < t->size; i++)
+	jjs->spans = spans;
+	return 0;
+#endif
+}
+
+int json_jsmn_span(const json_jsmn_t *jjs, const json_jsmn_token_t *t)
+{
+	unsigned int i;
+#ifndef JSON_JSMN_COMPACT_TOKENS
+	unsigned int n;
+	int pending;
+#endif
+
+	i = t - jjs->tokens;
+	if(i >= jjs->token_count)
+	{
+		return 0;
+	}
+
+#ifdef JSON_JSMN_COMPACT_TOKENS
+	// span 0: still open, the subtree runs to the last token so far
+	return t->span ? (int)t->span : (int)(jjs->token_count - i);
+#else
+	if(jjs->spans)
+	{
+		return jjs->spans[i];
+	}
+
+	// no index: count the subtree without recursion
+	for(n = 0, pending = 1; pending > 0 && i + n < jjs->token_count; n++)
+	{
+		pending += t[n].size - 1;
+	}
+	return n;
+#endif
+}
+
+void json_jsmn_subdocument
+	(
+		const json_jsmn_t *jjs,
+		const json_jsmn_token_t *t,
+		json_jsmn_t *sub
+	)
+{
+	sub->js = jjs->js;
+	sub->tokens = t;
+	sub->token_count = json_jsmn_span(jjs, t);
+	// spans are relative, the index slices like the tokens
+	sub->spans = jjs->spans ? jjs->spans + (t - jjs->tokens) : NULL;
+}
+
+int json_jsmn_array_foreach
+	(
+		const json_jsmn_t *jjs,
+		const json_jsmn_token_t *t,
+		json_jsmn_element_callback_t callback, void *args
+	)
+{
+	const json_jsmn_token_t *k, *end;
+	json_jsmn_t element;
+	int index;
+
+	if(t->type != JSMN_ARRAY)
+	{
+		return JSMN_ERROR_INVAL;
+	}
+
+	for(k = t + 1, end = t + json_jsmn_span(jjs, t), index = 0; k < end; )
+	{
+		json_jsmn_subdocument(jjs, k, &element);
+		index++;
+		if(callback && callback(index - 1, &element, args))
 		{
-			// name
-			j+= json_jsmn_get_value(js, t+1+j, t_count-j, NULL, 0);
+			debugPrintln("array: stop at element %d", index - 1);
+			break;
+		}
+		k += element.token_count;
+	}
+	return index;
+}
+
+static uint32_t json_jsmn_keyset_hash(const char *s, unsigned int len)
+{
+	uint32_t h = 2166136261u;		// FNV-1a
+
+	while(len--)
+	{
+		h ^= (unsigned char)*s++;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+int json_jsmn_keyset_add
+	(
+		json_jsmn_keyset_t *ks,
+		const char *key, int index
+	)
+{
+	unsigned int len, slot;
+	uint32_t hash;
+
+	if(ks->count + 1 >= ks->slot_count)
+	{
+		return JSMN_ERROR_NOMEM;
+	}
 
-			//value
-			j+= json_jsmn_get_value(js, t+1+j, t_count-j, NULL, 0);
+	len = strlen(key);
+	hash = json_jsmn_keyset_hash(key, len);
+	for(slot = hash % ks->slot_count; ks->slots[slot].key; slot = (slot + 1) % ks->slot_count)
+	{
+		if(ks->slots[slot].hash == hash && ks->slots[slot].len == len && 0 == memcmp(ks->slots[slot].key, key, len))
+		{
+			// duplicate key: the first entry wins
+			return 0;
 		}
-		return j+1;
+	}
 
-	case JSMN_ARRAY:
-		j = 0;
-		for (i = 0; i < t->size; i++)
+	ks->slots[slot].key = key;
+	ks->slots[slot].len = len;
+	ks->slots[slot].hash = hash;
+	ks->slots[slot].index = index;
+	ks->count++;
+	return 0;
+}
+
+static void json_jsmn_keyset_reset
+	(
+		json_jsmn_keyset_t *ks,
+		json_jsmn_keyset_slot_t *slots, unsigned int slot_count
+	)
+{
+	memset(slots, 0, slot_count * sizeof(*slots));
+	ks->slots = slots;
+	ks->slot_count = slot_count;
+	ks->count = 0;
+}
+
+int json_jsmn_keyset_init
+	(
+		json_jsmn_keyset_t *ks,
+		json_jsmn_keyset_slot_t *slots, unsigned int slot_count,
+		const char **keys_filter_list
+	)
+{
+	int i, rc;
+
+	json_jsmn_keyset_reset(ks, slots, slot_count);
+	for(i = 0; keys_filter_list[i]; i++)
+	{
+		rc = json_jsmn_keyset_add(ks, keys_filter_list[i], i);
+		if(rc)
 		{
-			j+= json_jsmn_get_value(js, t+1+j, t_count-j, NULL, 0);
+			return rc;
 		}
-		return j+1;
+	}
+	return ks->count;
+}
 
-	default:
-		return 0;
+int json_jsmn_keyset_init_object
+	(
+		json_jsmn_keyset_t *ks,
+		json_jsmn_keyset_slot_t *slots, unsigned int slot_count,
+		const json_jsmn_object_t *objs, int objs_count
+	)
+{
+	int i, rc;
+
+	json_jsmn_keyset_reset(ks, slots, slot_count);
+	for(i = 0; i < objs_count; i++)
+	{
+		rc = json_jsmn_keyset_add(ks, objs[i].key, i);
+		if(rc)
+		{
+			return rc;
+		}
 	}
+	return ks->count;
+}
+
+int json_jsmn_keyset_find
+	(
+		const json_jsmn_keyset_t *ks,
+		const char *js, const json_jsmn_token_t *t
+	)
+{
+	unsigned int len, slot;
+	uint32_t hash;
+	const json_jsmn_keyset_slot_t *s;
+
+	if(!ks->count)
+	{
+		return -1;
+	}
+
+	len = t->end - t->start;
+	hash = json_jsmn_keyset_hash(js + t->start, len);
+	for(slot = hash % ks->slot_count; (s = &ks->slots[slot])->key; slot = (slot + 1) % ks->slot_count)
+	{
+		JSON_JSMN_STAT_ADD(key_compares, 1);
+		if(s->hash == hash && s->len == len && 0 == memcmp(s->key, js + t->start, len))
+		{
+			return s->index;
+		}
+	}
+	return -1;
 }
 
 static int json_jsmn_parse_core
@@ -145,18 +348,20 @@ static int json_jsmn_parse_core
 		void *args
 	)
 {
-	int i, t_skip, t_skip1, n;
+	int i, t_skip, t_span, n, rc;
 	parse_state state = START;
 	int token_size = 0;
+	JSON_JSMN_STAT_CLOCK(lap);
 
+	JSON_JSMN_STAT_ADD(match_calls, 1);
 
 	for (
 			n = 0, i = 0, t_skip = 1;
-			i < jjs->token_count;
+			i < jjs->token_count && state != STOP;
 			i += t_skip
 		)
 	{
-		const jsmntok_t *t = &jjs->tokens[i];
+		const json_jsmn_token_t *t = &jjs->tokens[i];
 
 		// Should never reach uninitialized tokens
 		assert(t->start != -1 && t->end != -1);
@@ -169,7 +374,13 @@ static int json_jsmn_parse_core
 					debugPrintln("Invalid object(%d): root element must be an object.", t->type);
 				}
 
-				if (!t->size)
+#ifdef JSON_JSMN_COMPACT_TOKENS
+				// no child count: count the tokens left in the object instead
+				token_size = json_jsmn_span(jjs, t) - 1;
+#else
+				token_size = t->size;
+#endif
+				if (!token_size)
 				{
 					state = START;
 					debugPrintln("Empty object.");
@@ -177,7 +388,6 @@ static int json_jsmn_parse_core
 				else
 				{
 					state = KEY;
-					token_size = t->size;
 				}
 
 				t_skip = 1;
@@ -192,7 +402,15 @@ static int json_jsmn_parse_core
 					debugPrintln("Invalid object(%d): object keys must be strings.", t->type);
 				}
 
-				if(!get_key_callback(jjs->js, t, args))
+				rc = get_key_callback(jjs->js, t, args);
+				JSON_JSMN_STAT_ADD(keys, 1);
+				if(rc < 0)
+				{
+					// nothing left to match, skip the rest of the document
+					state = STOP;
+					debugPrintln("stop at token: %.*s", t->end - t->start, jjs->js+t->start);
+				}
+				else if(!rc)
 				{
 					state = SKIP;
 					debugPrintln("skip token: %.*s", t->end - t->start, jjs->js+t->start);
@@ -200,46 +418,52 @@ static int json_jsmn_parse_core
 				else
 				{
 					state = VALUE;
+					JSON_JSMN_STAT_ADD(matches, 1);
 					debugPrintln("add token: %.*s", t->end - t->start, jjs->js+t->start);
 				}
 
 				break;
 
 			case SKIP:
-				t_skip = jsmn_object_size(t, jjs->token_count-t_skip);
+				t_skip = json_jsmn_span(jjs, t);
+				JSON_JSMN_STAT_ADD(tokens_skipped, t_skip);
+#ifdef JSON_JSMN_COMPACT_TOKENS
+				token_size -= t_skip;
+#endif
 //            	token_size -= 1;
 				state = KEY;
 
-				if (token_size == 0)
+				if (token_size <= 0)
 					state = START;
 				break;
 
 			case VALUE:
-				t_skip1 = get_value_callback
-							(
-								jjs->js,
-								t, jjs->token_count-t_skip,
-								args
-							);
-				if(t_skip1)
+				t_skip = t_span = json_jsmn_span(jjs, t);
+#ifdef JSON_JSMN_COMPACT_TOKENS
+				token_size -= t_skip;
+#endif
+				JSON_JSMN_STAT_LAP(cycles_match, lap);
+				if(get_value_callback
+					(
+						jjs->js,
+						t, t_span,
+						args
+					))
 				{
-					t_skip = t_skip1;
 					n++;
+					JSON_JSMN_STAT_ADD(values, 1);
 				}
-				else
-				{
-					t_skip = jsmn_object_size(t, jjs->token_count-t_skip);
-				}
+				JSON_JSMN_STAT_LAP(cycles_convert, lap);
 
 				state = KEY;
 
-				if (token_size == 0)
+				if (token_size <= 0)
 					state = START;
 
 				break;
 
 			case STOP:
-				// Just consume the tokens
+				// not reached, the loop ends on STOP
 				break;
 
 			default:
@@ -247,6 +471,7 @@ static int json_jsmn_parse_core
 		}
 	}
 //    assert_fmt(n <= json_jsmntok_count, "invalid return (%d)", n);
+	JSON_JSMN_STAT_LAP(cycles_match, lap);
 	return n;
 }
 
@@ -255,12 +480,13 @@ struct parse_jsmntok_args
 	int count;
 	int index;
 	const char **keys_filter_list;
+	const json_jsmn_keyset_t *keyset;
 	json_jsmntok_t *json_jsmntok_list;
 };
 static int parse_get_key
 	(
 		const char *js,
-		jsmntok_t *t,
+		json_jsmn_token_t *t,
 		struct parse_jsmntok_args *jargs
 	)
 {
@@ -268,7 +494,18 @@ static int parse_get_key
 
 	if(jargs->index >= jargs->count)
 	{
-		return 0;
+		// output buffer is full
+		return -1;
+	}
+
+	if(jargs->keyset)
+	{
+		if(0 > json_jsmn_keyset_find(jargs->keyset, js, t))
+		{
+			return 0;
+		}
+		jargs->json_jsmntok_list[jargs->index].t_key = t;
+		return 1;
 	}
 
 	if(!jargs->keys_filter_list)
@@ -280,6 +517,7 @@ static int parse_get_key
 	keys_filter_list = jargs->keys_filter_list;
 	while(*keys_filter_list)
 	{
+		JSON_JSMN_STAT_ADD(key_compares, 1);
 		if(0 == jsmntok_strcmp(js, t, *keys_filter_list++))
 		{
 			jargs->json_jsmntok_list[jargs->index].t_key = t;
@@ -292,12 +530,10 @@ static int parse_get_key
 static int parse_get_value
 	(
 		const char *js,
-		jsmntok_t *t, size_t t_count,
+		json_jsmn_token_t *t, size_t t_count,
 		struct parse_jsmntok_args *jargs
 	)
 {
-	int t_skip;
-
 	if(jargs->index >= jargs->count)
 	{
 		return 0;
@@ -305,9 +541,9 @@ static int parse_get_value
 
 	jargs->json_jsmntok_list[jargs->index].t_value_type = t->type;
 	jargs->json_jsmntok_list[jargs->index].t_value = t;
-	jargs->json_jsmntok_list[jargs->index].t_count = t_skip = jsmn_object_size(t, t_count);
+	jargs->json_jsmntok_list[jargs->index].t_count = t_count;
 	jargs->index++;
-	return t_skip;
+	return t_count;
 }
 int json_jsmn_parse
 		(
@@ -322,6 +558,7 @@ int json_jsmn_parse
 	parse_jsmntok_args.count = json_jsmntok_count;
 	parse_jsmntok_args.json_jsmntok_list = json_jsmntok;
 	parse_jsmntok_args.keys_filter_list = keys_filter_list;
+	parse_jsmntok_args.keyset = NULL;
 	return json_jsmn_parse_core
 				(
 					jjs,
@@ -331,24 +568,92 @@ int json_jsmn_parse
 				);
 }
 
+int json_jsmn_parse_keyset
+		(
+			json_jsmn_t *jjs,
+			const json_jsmn_keyset_t *keyset,						// precompiled key filter
+			json_jsmntok_t *json_jsmntok, int json_jsmntok_count	// output buffer
+		)
+{
+	struct parse_jsmntok_args parse_jsmntok_args;
+
+	parse_jsmntok_args.index = 0;
+	parse_jsmntok_args.count = json_jsmntok_count;
+	parse_jsmntok_args.json_jsmntok_list = json_jsmntok;
+	parse_jsmntok_args.keys_filter_list = NULL;
+	parse_jsmntok_args.keyset = keyset;
+	return json_jsmn_parse_core
+				(
+					jjs,
+					(json_jsmn_get_key_t)parse_get_key,
+					(json_jsmn_get_value_t)parse_get_value,
+					&parse_jsmntok_args
+				);
+}
+
+int json_jsmn_object_set
+	(
+		json_jsmn_object_t *jobj,
+		const char *js,
+		const json_jsmn_token_t *t, int t_count
+	)
+{
+	int t_skip;
+
+	if(jobj->type != t->type)
+	{
+		jobj->status = JSON_JSMN_INVALID;
+		return 0;
+	}
+
+	t_skip = json_jsmn_get_value(js, t, t_count, jobj->vtype, jobj->value, jobj->size);
+	if(t_skip < 0)
+	{
+		// not a number of the requested type or out of its range
+		jobj->status = JSON_JSMN_INVALID;
+		return 0;
+	}
+	jobj->status = JSON_JSMN_VALID;
+	if(jobj->callback)
+	{
+		jobj->callback(jobj, js, (json_jsmn_token_t *)t);
+	}
+	return t_skip;
+}
+
 struct parse_object_args
 {
 	int count;
 	int index;
+	int remaining;
+	const json_jsmn_keyset_t *keyset;
 	json_jsmn_object_t *jobj;
 };
 static int parse_object_get_key_args_callback
 	(
 		const char *js,
-		jsmntok_t *t,
+		json_jsmn_token_t *t,
 		struct parse_object_args *jvargs
 	)
 {
 	int i;
 
+	if(!jvargs->remaining)
+	{
+		// every object is filled: stop the walk
+		return -1;
+	}
+
+	if(jvargs->keyset)
+	{
+		jvargs->index = json_jsmn_keyset_find(jvargs->keyset, js, t);
+		return jvargs->index != -1;
+	}
+
 	jvargs->index = -1;
 	for(i = 0; i < jvargs->count; i++)
 	{
+		JSON_JSMN_STAT_ADD(key_compares, 1);
 		if (0 == jsmntok_strcmp(js, t, jvargs->jobj[i].key))
 		{
 			jvargs->index = i;
@@ -361,51 +666,50 @@ static int parse_object_get_key_args_callback
 static int parse_object_get_value_args_callback
 	(
 		const char *js,
-		jsmntok_t *t, size_t t_count,
+		json_jsmn_token_t *t, size_t t_count,
 		struct parse_object_args *jvargs
 	)
 {
-	int t_skip=0;
+	json_jsmn_object_t *jobj;
 
 	if(jvargs->index == -1)
 	{
 		return 0;
 	}
-	t_skip = json_jsmn_get_value
-			(
-				js,
-				t, t_count,
-				jvargs->jobj[jvargs->index].value, jvargs->jobj[jvargs->index].size
-			);
 
-	if(jvargs->jobj[jvargs->index].type == t->type)
+	jobj = &jvargs->jobj[jvargs->index];
+	if(jobj->status != JSON_JSMN_VALID)
 	{
-		jvargs->jobj[jvargs->index].status = JSON_JSMN_VALID;
-		jvargs->count--;
-		if(jvargs->jobj[jvargs->index].callback)
+		if(json_jsmn_object_set(jobj, js, t, t_count))
 		{
-			jvargs->jobj[jvargs->index].callback(jvargs->jobj, js, t);
+			jvargs->remaining--;
+			return 1;
 		}
-		return t_skip;
-	}
-	else
-	{
-		jvargs->jobj[jvargs->index].status = JSON_JSMN_INVALID;
 		return 0;
 	}
+	return json_jsmn_object_set(jobj, js, t, t_count);
 }
 
-int json_jsmn_parse_object
+static int json_jsmn_parse_object_core
 	(
 		json_jsmn_t *jjs,
+		const json_jsmn_keyset_t *keyset,
 		json_jsmn_object_t *objs, int objs_count
 	)
 {
+	int i;
 	struct parse_object_args parse_object_args;
 
+	for(i = 0; i < objs_count; i++)
+	{
+		objs[i].status = JSON_JSMN_EMPTY;
+	}
+
 	parse_object_args.index = -1;
 	parse_object_args.count = objs_count;
+	parse_object_args.remaining = keyset ? (int)keyset->count : objs_count;
 	parse_object_args.jobj = objs;
+	parse_object_args.keyset = keyset;
 	return json_jsmn_parse_core
 			(
 				jjs,
@@ -415,10 +719,30 @@ int json_jsmn_parse_object
 			);
 }
 
+int json_jsmn_parse_object
+	(
+		json_jsmn_t *jjs,
+		json_jsmn_object_t *objs, int objs_count
+	)
+{
+	return json_jsmn_parse_object_core(jjs, NULL, objs, objs_count);
+}
+
+int json_jsmn_parse_object_keyset
+	(
+		json_jsmn_t *jjs,
+		const json_jsmn_keyset_t *keyset,
+		json_jsmn_object_t *objs, int objs_count
+	)
+{
+	return json_jsmn_parse_object_core(jjs, keyset, objs, objs_count);
+}
+
 #if __STDC_VERSION__ >= 199901L
 struct parse_jsmntok_vargs
 {
 	int count;
+	int remaining;
 	const char **keys_filter_list;
 	va_list vargs;
 	json_jsmntok_t *json_jsmntok;
@@ -426,7 +750,7 @@ struct parse_jsmntok_vargs
 static int parse_get_key_vargs_callback
 	(
 		const char *js,
-		jsmntok_t *t,
+		json_jsmn_token_t *t,
 		struct parse_jsmntok_vargs *jargs
 	)
 {
@@ -435,44 +759,48 @@ static int parse_get_key_vargs_callback
 	int i;
 	json_jsmntok_t *json_jsmntok;
 
+	if(!jargs->remaining)
+	{
+		return -1;
+	}
+
+	// the i-th output argument receives the i-th key of keys_filter_list
+	jargs->json_jsmntok = NULL;
+	keys_filter_list = jargs->keys_filter_list;
 	va_copy(args1, jargs->vargs);
 	for(i = 0; i < jargs->count; i++)
 	{
-		json_jsmntok = va_arg(jargs->vargs, json_jsmntok_t *);
+		json_jsmntok = va_arg(args1, json_jsmntok_t *);
 
-		if(json_jsmntok)
+		if(keys_filter_list && !keys_filter_list[i])
 		{
-			if(!jargs->keys_filter_list)
-			{
-				jargs->json_jsmntok = json_jsmntok;
-				return 1;
-			}
+			break;
+		}
 
-			keys_filter_list = jargs->keys_filter_list;
-			while(*keys_filter_list)
-			{
-				if(0 == jsmntok_strcmp(js, t, *keys_filter_list++))
-				{
-					jargs->json_jsmntok = json_jsmntok;
-					jargs->json_jsmntok->t_key = t;
-					return 1;
-				}
-			}
+		if(!json_jsmntok || json_jsmntok->t_key)
+		{
+			continue;
+		}
+
+		JSON_JSMN_STAT_ADD(key_compares, keys_filter_list != NULL);
+		if(!keys_filter_list || 0 == jsmntok_strcmp(js, t, keys_filter_list[i]))
+		{
+			jargs->json_jsmntok = json_jsmntok;
+			jargs->json_jsmntok->t_key = t;
+			break;
 		}
 	}
 	va_end(args1);
 
-	return 0;
+	return jargs->json_jsmntok != NULL;
 }
 static int parse_get_value_vargs_callback
 	(
 		const char *js,
-		jsmntok_t *t, size_t t_count,
+		json_jsmn_token_t *t, size_t t_count,
 		struct parse_jsmntok_vargs *jargs
 	)
 {
-	int t_skip;
-
 	if(!jargs->json_jsmntok)
 	{
 		return 0;
@@ -480,25 +808,35 @@ static int parse_get_value_vargs_callback
 
 	jargs->json_jsmntok->t_value_type = t->type;
 	jargs->json_jsmntok->t_value = t;
-	jargs->json_jsmntok->t_count = t_skip = jsmn_object_size(t, t_count);
-	jargs->count--;
-	return t_skip;
+	jargs->json_jsmntok->t_count = t_count;
+	jargs->remaining--;
+	return t_count;
 }
-static void parse_init_va_list(va_list vargs)
+static int parse_init_va_list(int count, const char **keys_filter_list, va_list vargs)
 {
 	va_list args1;
 	json_jsmntok_t *json_jsmntok;
+	int i, n;
 
 	va_copy(args1, vargs);
-	json_jsmntok = va_arg(vargs, json_jsmntok_t *);
-	if(json_jsmntok)
+	for(i = 0, n = 0; i < count; i++)
 	{
-		json_jsmntok->t_value_type = JSMN_UNDEFINED;
-		json_jsmntok->t_key = NULL;
-		json_jsmntok->t_value = NULL;
-		json_jsmntok->t_count = 0;
+		json_jsmntok = va_arg(args1, json_jsmntok_t *);
+		if(keys_filter_list && !keys_filter_list[i])
+		{
+			break;
+		}
+		if(json_jsmntok)
+		{
+			json_jsmntok->t_value_type = JSMN_UNDEFINED;
+			json_jsmntok->t_key = NULL;
+			json_jsmntok->t_value = NULL;
+			json_jsmntok->t_count = 0;
+			n++;
+		}
 	}
 	va_end(args1);
+	return n;
 }
 int json_jsmn_parse_va_list
 		(
@@ -507,20 +845,23 @@ int json_jsmn_parse_va_list
 			int json_jsmntok_count, va_list vargs		// output vargs
 		)
 {
+	int n;
 	struct parse_jsmntok_vargs parse_jsmntok_vargs;
 
-	parse_init_va_list(vargs);
+	parse_jsmntok_vargs.remaining = parse_init_va_list(json_jsmntok_count, keys_filter_list, vargs);
 	parse_jsmntok_vargs.count = json_jsmntok_count;
 	parse_jsmntok_vargs.keys_filter_list = keys_filter_list;
-	parse_jsmntok_vargs.vargs = vargs;
+	va_copy(parse_jsmntok_vargs.vargs, vargs);
 	parse_jsmntok_vargs.json_jsmntok = NULL;
-	return json_jsmn_parse_core
-				(
-					jjs,
-					(json_jsmn_get_key_t)parse_get_key_vargs_callback,
-					(json_jsmn_get_value_t)parse_get_value_vargs_callback,
-					&parse_jsmntok_vargs
-				);
+	n = json_jsmn_parse_core
+			(
+				jjs,
+				(json_jsmn_get_key_t)parse_get_key_vargs_callback,
+				(json_jsmn_get_value_t)parse_get_value_vargs_callback,
+				&parse_jsmntok_vargs
+			);
+	va_end(parse_jsmntok_vargs.vargs);
+	return n;
 }
 int json_jsmn_parse_fmt
 	(
@@ -547,13 +888,14 @@ int json_jsmn_parse_fmt
 struct json_jsmn_parse_object_vargs
 {
 	int count;
+	int remaining;
 	va_list args;
 	json_jsmn_object_t *jobj;
 };
 static int parse_object_get_key_vargs_callback
 	(
 		const char *js,
-		jsmntok_t *t,
+		json_jsmn_token_t *t,
 		struct json_jsmn_parse_object_vargs *jvargs
 	)
 {
@@ -561,60 +903,68 @@ static int parse_object_get_key_vargs_callback
 	int i;
 	json_jsmn_object_t *jobj;
 
+	if(!jvargs->remaining)
+	{
+		return -1;
+	}
+
+	jvargs->jobj = NULL;
 	va_copy(args1, jvargs->args);
 	for(i = 0; i < jvargs->count; i++)
 	{
-		jobj = va_arg(jvargs->args, json_jsmn_object_t *);
+		jobj = va_arg(args1, json_jsmn_object_t *);
 		debugPrintln("object: %s", jobj ? jobj->key:"null");
+		JSON_JSMN_STAT_ADD(key_compares, jobj != NULL);
 		if (jobj && 0 == jsmntok_strcmp(js, t, jobj->key))
 		{
 			jvargs->jobj = jobj;
-			return 1;
+			break;
 		}
 	}
 	va_end(args1);
-	return 0;
+	return jvargs->jobj != NULL;
 }
 static int parse_object_get_value_vargs_callback
 	(
 		const char *js,
-		jsmntok_t *t, size_t t_count,
+		json_jsmn_token_t *t, size_t t_count,
 		struct json_jsmn_parse_object_vargs *jvargs
 	)
 {
-	int t_skip;
+	if(!jvargs->jobj)
+	{
+		return 0;
+	}
 
-	if(jvargs->jobj && jvargs->jobj->type == t->type)
+	if(jvargs->jobj->status != JSON_JSMN_VALID)
 	{
-		t_skip = json_jsmn_get_value(js, t, t_count, jvargs->jobj->value, jvargs->jobj->size);
-		jvargs->jobj->status = JSON_JSMN_VALID;
-		jvargs->count--;
-		if(jvargs->jobj->callback)
+		if(json_jsmn_object_set(jvargs->jobj, js, t, t_count))
 		{
-			jvargs->jobj->callback(jvargs->jobj, js, t);
+			jvargs->remaining--;
+			return 1;
 		}
-		return t_skip;
-	}
-	else
-	{
-		jvargs->jobj->status = JSON_JSMN_INVALID;
 		return 0;
 	}
+	return json_jsmn_object_set(jvargs->jobj, js, t, t_count);
 }
-static void parse_object_init_va_list(va_list vargs)
+static int parse_object_init_va_list(int count, va_list vargs)
 {
 	va_list args1;
 	json_jsmn_object_t *json_jsmn_object;
+	int n;
 
 	va_copy(args1, vargs);
-	json_jsmn_object = va_arg(vargs, json_jsmn_object_t *);
-	if(json_jsmn_object)
+	for(n = 0; count--;)
 	{
-		json_jsmn_object->type = JSMN_UNDEFINED;
-		json_jsmn_object->value = NULL;
-		json_jsmn_object->status = JSON_JSMN_INVALID;
+		json_jsmn_object = va_arg(args1, json_jsmn_object_t *);
+		if(json_jsmn_object)
+		{
+			json_jsmn_object->status = JSON_JSMN_EMPTY;
+			n++;
+		}
 	}
 	va_end(args1);
+	return n;
 }
 int json_jsmn_parse_object_va_list
 	(
@@ -622,19 +972,22 @@ int json_jsmn_parse_object_va_list
 		int objs_count, va_list vargs					// output args
 	)
 {
+	int n;
 	struct json_jsmn_parse_object_vargs json_jsmn_parse_object_vargs;
 
-	parse_object_init_va_list(vargs);
+	json_jsmn_parse_object_vargs.remaining = parse_object_init_va_list(objs_count, vargs);
 	json_jsmn_parse_object_vargs.count = objs_count;
-	json_jsmn_parse_object_vargs.args = vargs;
+	va_copy(json_jsmn_parse_object_vargs.args, vargs);
 	json_jsmn_parse_object_vargs.jobj = NULL;
-	return json_jsmn_parse_core
+	n = json_jsmn_parse_core
 			(
 				jjs,
 				(json_jsmn_get_key_t)parse_object_get_key_vargs_callback,
 				(json_jsmn_get_value_t)parse_object_get_value_vargs_callback,
 				&json_jsmn_parse_object_vargs
 			);
+	va_end(json_jsmn_parse_object_vargs.args);
+	return n;
 }
 
 int json_jsmn_parse_object_fmt
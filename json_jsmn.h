@@ -2,17 +2,43 @@
 #define __JSON_JSMN_H_
 
 #include <stddef.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
 #include "jsmn/jsmn.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#ifdef JSON_JSMN_COMPACT_TOKENS
+/*
+ * Compact document token (12 bytes instead of a jsmntok_t plus a span index
+ * entry): no child count and no parent link, the subtree span lives in the
+ * token itself. end is -1 while a container is open and span is 0 until a
+ * container closes or a key receives its value. A document is limited to
+ * 2 GB and a subtree to JSON_JSMN_SPAN_MAX tokens, the tokenizers fail with
+ * JSMN_ERROR_INVAL beyond.
+ */
+typedef struct
+{
+	int32_t start;
+	int32_t end;
+	uint32_t type : 4;				// jsmntype_t
+	uint32_t span : 28;
+}json_jsmn_token_t;
+
+#define JSON_JSMN_SPAN_MAX			((1u << 28) - 1)
+#else
+typedef jsmntok_t json_jsmn_token_t;
+#endif
+
 typedef struct
 {
 	jsmntype_t t_value_type;
-	jsmntok_t *t_key;
-	jsmntok_t *t_value;
+	json_jsmn_token_t *t_key;
+	json_jsmn_token_t *t_value;
 	int t_count;
 }json_jsmntok_t;
 
@@ -25,8 +51,31 @@ enum jsonstatus
 	JSON_JSMN_INVALID
 };
 
+/*
+ * Destination type of a json_jsmn_object_t value. JSON_JSMN_VTYPE_AUTO keeps
+ * the historic behaviour: strings are copied with their escapes decoded (see
+ * json_jsmn_string.h) and primitives are stored as a signed integer of size
+ * bytes. The other tags decode primitives exactly (range checked, see
+ * json_jsmn_number.h), size must hold the type.
+ */
+typedef enum
+{
+	JSON_JSMN_VTYPE_AUTO,
+	JSON_JSMN_VTYPE_INT8,
+	JSON_JSMN_VTYPE_INT16,
+	JSON_JSMN_VTYPE_INT32,
+	JSON_JSMN_VTYPE_INT64,
+	JSON_JSMN_VTYPE_UINT8,
+	JSON_JSMN_VTYPE_UINT16,
+	JSON_JSMN_VTYPE_UINT32,
+	JSON_JSMN_VTYPE_UINT64,
+	JSON_JSMN_VTYPE_FLOAT,
+	JSON_JSMN_VTYPE_DOUBLE,
+	JSON_JSMN_VTYPE_BOOL			// true/false into an unsigned integer of size bytes
+}json_jsmn_vtype_t;
+
 typedef struct json_jsmn_object json_jsmn_object_t;
-typedef void (*json_jsmn_object_callback_t)(struct json_jsmn_object *jobj, const char *js, jsmntok_t *t);
+typedef void (*json_jsmn_object_callback_t)(struct json_jsmn_object *jobj, const char *js, json_jsmn_token_t *t);
 
 struct json_jsmn_object{
     const char *key;
@@ -35,24 +84,60 @@ struct json_jsmn_object{
     jsmntype_t type;
     enum jsonstatus status;
     json_jsmn_object_callback_t callback;
+    json_jsmn_vtype_t vtype;
 };
 
+/*
+ * Precompiled key set: an open addressing hash table over the filter keys,
+ * built once and reused for every message. Each document key is hashed once
+ * and compared against a single candidate instead of every filter key.
+ * slots is caller storage; slot_count must exceed the number of keys (about
+ * twice the key count keeps probe sequences short).
+ */
+typedef struct
+{
+	const char *key;
+	unsigned int len;
+	uint32_t hash;
+	int index;					// position in the source list/table
+}json_jsmn_keyset_slot_t;
+
+typedef struct
+{
+	json_jsmn_keyset_slot_t *slots;
+	unsigned int slot_count;
+	unsigned int count;
+}json_jsmn_keyset_t;
+
 typedef struct
 {
 	const char *js;
-	const jsmntok_t *tokens;
+	const json_jsmn_token_t *tokens;
 	unsigned int token_count;
+	const unsigned int *spans;		// optional subtree index, see json_jsmn_index()
 }json_jsmn_t;
 
-#define jsmntok_strcmp(js, t, s)		strncmp((const char *)((js) + (t)->start), s, (t)->end - (t)->start)
-#define jsmntok_strncasecmp(js, t, s)	strncasecmp((const char *)((js) + (t)->start), s, (t)->end - (t)->start)
+/*
+ * Whole-token comparison: 0 only when the token text equals s exactly, so a
+ * "id" token no longer matches "idx" (nor "idx" matches "id").
+ */
+static inline int jsmntok_strcmp(const char *js, const json_jsmn_token_t *t, const char *s)
+{
+	int rc = strncmp((const char *)js + t->start, s, t->end - t->start);
+	return rc ? rc : -(unsigned char)s[t->end - t->start];
+}
+static inline int jsmntok_strncasecmp(const char *js, const json_jsmn_token_t *t, const char *s)
+{
+	int rc = strncasecmp((const char *)js + t->start, s, t->end - t->start);
+	return rc ? rc : -(unsigned char)s[t->end - t->start];
+}
 #define jsmntok_get_offset(t)		(t->start)
 #define jsmntok_get_size(t)			(t->end - t->start)
 
 #define jsmntok_get_copy_size(t, buffer_size)	\
 	(((t)->start + (buffer_size) + 1) < (t)->end ? ((t)->end - (t)->start):((buffer_size)-1))
 
-static inline int jsmntok_strlcpy(const char *js, const jsmntok_t *t, char *s, size_t num)	\
+static inline int jsmntok_strlcpy(const char *js, const json_jsmn_token_t *t, char *s, size_t num)	\
 {
 	if(num > 1)
 	{
@@ -64,12 +149,96 @@ static inline int jsmntok_strlcpy(const char *js, const jsmntok_t *t, char *s, s
 	return 0;
 }
 
+void json_jsmn_init
+	(
+		json_jsmn_t *jjs,
+		const char *js,
+		const json_jsmn_token_t *tokens, unsigned int token_count
+	);
+
+/*
+ * Build the subtree index of a tokenized document in one linear pass.
+ * spans[i] receives the number of tokens covered by tokens[i] (itself and all
+ * of its descendants), so the next sibling of tokens[i] is tokens[i + spans[i]].
+ * spans must hold at least jjs->token_count entries; once indexed, skipping a
+ * value in all json_jsmn_parse* functions is O(1). Compact tokens carry their
+ * span already, there this is a no-op.
+ */
+int json_jsmn_index
+	(
+		json_jsmn_t *jjs,
+		unsigned int *spans, unsigned int spans_count
+	);
+
+// number of tokens covered by t and its descendants
+int json_jsmn_span(const json_jsmn_t *jjs, const json_jsmn_token_t *t);
+
+/*
+ * Sub-document rooted at t: sub covers t and its descendants only (and the
+ * matching part of the subtree index), so every json_jsmn_parse* function
+ * can run on a single element of a larger document without re-tokenizing.
+ */
+void json_jsmn_subdocument
+	(
+		const json_jsmn_t *jjs,
+		const json_jsmn_token_t *t,
+		json_jsmn_t *sub
+	);
+
+// return non zero to stop the iteration after this element
+typedef int (*json_jsmn_element_callback_t)(int index, const json_jsmn_t *element, void *args);
+
+/*
+ * Visit the elements of the array token t in order, stepping from one
+ * element to the next by its span so nested objects and arrays are handed
+ * over whole, as a sub-document. Returns the number of elements visited
+ * (the one that stopped included) or JSMN_ERROR_INVAL when t is not an
+ * array.
+ */
+int json_jsmn_array_foreach
+	(
+		const json_jsmn_t *jjs,
+		const json_jsmn_token_t *t,
+		json_jsmn_element_callback_t callback, void *args
+	);
+
+int json_jsmn_keyset_init
+	(
+		json_jsmn_keyset_t *ks,
+		json_jsmn_keyset_slot_t *slots, unsigned int slot_count,
+		const char **keys_filter_list
+	);
+int json_jsmn_keyset_init_object
+	(
+		json_jsmn_keyset_t *ks,
+		json_jsmn_keyset_slot_t *slots, unsigned int slot_count,
+		const json_jsmn_object_t *objs, int objs_count
+	);
+// add one key to an initialized keyset, duplicates keep the first index
+int json_jsmn_keyset_add
+	(
+		json_jsmn_keyset_t *ks,
+		const char *key, int index
+	);
+// index of the token key in the source list/table, -1 if absent
+int json_jsmn_keyset_find
+	(
+		const json_jsmn_keyset_t *ks,
+		const char *js, const json_jsmn_token_t *t
+	);
+
 int json_jsmn_parse
 	(
 		json_jsmn_t *jjs,
 		const char **json_jsmntok_keys,
 		json_jsmntok_t *json_jsmntok, int json_jsmntok_count
 	);
+int json_jsmn_parse_keyset
+	(
+		json_jsmn_t *jjs,
+		const json_jsmn_keyset_t *keyset,
+		json_jsmntok_t *json_jsmntok, int json_jsmntok_count
+	);
 int json_jsmn_parse_va_list
 	(
 		json_jsmn_t *jjs,
@@ -85,12 +254,31 @@ int json_jsmn_parse_fmt
 	);
 
 
+/*
+ * Store the value token t (t_count tokens span) into jobj when its type
+ * matches and it decodes as jobj->vtype: sets status and runs the object
+ * callback. Returns t_count when accepted, 0 otherwise.
+ */
+int json_jsmn_object_set
+	(
+		json_jsmn_object_t *jobj,
+		const char *js,
+		const json_jsmn_token_t *t, int t_count
+	);
+
 int json_jsmn_parse_object
 	(
 		json_jsmn_t *jjs,
 		json_jsmn_object_t *objs, int objs_count
 	);
 
+int json_jsmn_parse_object_keyset
+	(
+		json_jsmn_t *jjs,
+		const json_jsmn_keyset_t *keyset,
+		json_jsmn_object_t *objs, int objs_count
+	);
+
 int json_jsmn_parse_object_va_list
 	(
 		json_jsmn_t *jjs,
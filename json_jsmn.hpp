@@ -0,0 +1,455 @@
+#ifndef __JSON_JSMN_HPP_
+#define __JSON_JSMN_HPP_
+
+/*
+ * C++17 front end, header only. The fields of a struct are declared once as
+ * a constexpr table:
+ *
+ *	struct point { int32_t x; double y; std::string_view name; };
+ *	JSON_JSMN_FIELDS(point,
+ *		json_jsmn::field("x", &point::x),
+ *		json_jsmn::field("y", &point::y),
+ *		json_jsmn::field("name", &point::name));
+ *
+ * and the key matcher of the table is built by the compiler: a perfect hash
+ * of the key length and first/last bytes (of every byte when those collide)
+ * into a slot table, one compare against the single candidate, then a
+ * switch on the field index into the typed decoder of that member. No key
+ * list, no va_list, no runtime setup. Documents are the usual json_jsmn_t
+ * over C token arrays, so the same tokens can go through the C API too.
+ */
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "json_jsmn.h"
+#include "json_jsmn_number.h"
+#include "json_jsmn_string.h"
+
+namespace json_jsmn
+{
+
+/*
+ * Member of T named key in JSON. Supported member types:
+ * - bool, integers, float, double: primitives decoded like the C vtypes,
+ *   range checked (json_jsmn_number_decode())
+ * - std::string_view: body of a string token inside js, escapes left as is
+ * - std::string, char[N]: string with its escapes decoded, char[N] is
+ *   truncated and NUL terminated like json_jsmn_unescape()
+ * - const json_jsmn_token_t *: the value token, any type, for the C API
+ * - json_jsmn_t: the value as a sub-document (json_jsmn_subdocument())
+ * - a struct with its own JSON_JSMN_FIELDS() table, for nested objects
+ */
+template <class T, class M>
+struct field
+{
+	std::string_view key;
+	M T::*member;
+
+	constexpr field(std::string_view key, M T::*member) : key(key), member(member) {}
+};
+
+// specialized by JSON_JSMN_FIELDS(): static constexpr std::tuple value of fields
+template <class T>
+struct fields;
+
+namespace detail
+{
+
+template <class T, class = void>
+struct has_fields : std::false_type {};
+
+template <class T>
+struct has_fields<T, std::void_t<decltype(fields<T>::value)>> : std::true_type {};
+
+template <class T>
+constexpr std::size_t field_count = std::tuple_size_v<std::decay_t<decltype(fields<T>::value)>>;
+
+constexpr std::uint32_t key_hash(const char *s, std::size_t len, std::uint32_t seed, bool full)
+{
+	std::uint32_t h = seed ^ (std::uint32_t)len * 0x9e3779b1u;
+	std::size_t i = 0;
+
+	if(full)
+	{
+		for(i = 0; i < len; i++)
+		{
+			h = (h ^ (unsigned char)s[i]) * 0x01000193u;
+		}
+	}
+	else if(len)
+	{
+		h = (h ^ (unsigned char)s[0]) * 0x01000193u;
+		h = (h ^ (unsigned char)s[len - 1]) * 0x01000193u;
+	}
+	return h ^ (h >> 15);
+}
+
+// power of two, at least 4 slots per key: a perfect seed is found quickly
+constexpr std::size_t key_slots(std::size_t n)
+{
+	std::size_t size = 4;
+
+	while(size < 4 * n)
+	{
+		size *= 2;
+	}
+	return size;
+}
+
+template <std::size_t N>
+struct key_table
+{
+	std::array<std::string_view, N> keys;
+	std::array<int, key_slots(N)> slots;	// field index, -1 empty
+	std::uint32_t seed;
+	bool full;
+	bool probe;								// not perfect, collisions chained by linear probing
+};
+
+template <std::size_t N>
+constexpr bool key_table_fill(key_table<N> &kt, bool probe)
+{
+	constexpr std::size_t mask = key_slots(N) - 1;
+	std::size_t i = 0, slot = 0;
+
+	for(slot = 0; slot <= mask; slot++)
+	{
+		kt.slots[slot] = -1;
+	}
+	for(i = 0; i < N; i++)
+	{
+		slot = key_hash(kt.keys[i].data(), kt.keys[i].size(), kt.seed, kt.full) & mask;
+		while(kt.slots[slot] >= 0)
+		{
+			if(!probe)
+			{
+				return false;
+			}
+			slot = (slot + 1) & mask;
+		}
+		kt.slots[slot] = (int)i;
+	}
+	return true;
+}
+
+template <std::size_t N>
+constexpr key_table<N> key_table_make(const std::array<std::string_view, N> &keys)
+{
+	key_table<N> kt{};
+	int full = 0;
+
+	kt.keys = keys;
+	for(full = 0; full < 2; full++)
+	{
+		kt.full = full;
+		for(kt.seed = 0; kt.seed < 256; kt.seed++)
+		{
+			if(key_table_fill(kt, false))
+			{
+				return kt;
+			}
+		}
+	}
+	// large key set: keep the full hash, chain the few collisions
+	kt.seed = 0;
+	kt.probe = true;
+	key_table_fill(kt, true);
+	return kt;
+}
+
+template <class Tuple, std::size_t... I>
+constexpr std::array<std::string_view, sizeof...(I)> key_list(const Tuple &t, std::index_sequence<I...>)
+{
+	return { { std::get<I>(t).key... } };
+}
+
+template <class T>
+constexpr bool keys_unique()
+{
+	constexpr auto keys = key_list(fields<T>::value, std::make_index_sequence<field_count<T>>());
+	std::size_t i = 0, j = 0;
+
+	for(i = 0; i < keys.size(); i++)
+	{
+		for(j = i + 1; j < keys.size(); j++)
+		{
+			if(keys[i] == keys[j])
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+template <class T>
+struct key_matcher
+{
+	static_assert(keys_unique<T>(), "JSON_JSMN_FIELDS(): duplicate key");
+
+	static constexpr key_table<field_count<T>> table =
+		key_table_make(key_list(fields<T>::value, std::make_index_sequence<field_count<T>>()));
+
+	// field index of the key s[0..len), -1 if none
+	static inline int find(const char *s, std::size_t len)
+	{
+		constexpr std::size_t mask = key_slots(field_count<T>) - 1;
+		std::size_t slot = key_hash(s, len, table.seed, table.full) & mask;
+		int i;
+
+		while((i = table.slots[slot]) >= 0)
+		{
+			if(table.keys[i].size() == len && !std::char_traits<char>::compare(table.keys[i].data(), s, len))
+			{
+				return i;
+			}
+			if(!table.probe)
+			{
+				break;
+			}
+			slot = (slot + 1) & mask;
+		}
+		return -1;
+	}
+};
+
+template <class M>
+constexpr json_jsmn_vtype_t number_vtype()
+{
+	if constexpr(std::is_same_v<M, bool>)
+	{
+		return JSON_JSMN_VTYPE_BOOL;
+	}
+	else if constexpr(std::is_same_v<M, float>)
+	{
+		return JSON_JSMN_VTYPE_FLOAT;
+	}
+	else if constexpr(std::is_same_v<M, double>)
+	{
+		return JSON_JSMN_VTYPE_DOUBLE;
+	}
+	else if constexpr(std::is_signed_v<M>)
+	{
+		return sizeof(M) == 1 ? JSON_JSMN_VTYPE_INT8 :
+			sizeof(M) == 2 ? JSON_JSMN_VTYPE_INT16 :
+			sizeof(M) == 4 ? JSON_JSMN_VTYPE_INT32 : JSON_JSMN_VTYPE_INT64;
+	}
+	else
+	{
+		return sizeof(M) == 1 ? JSON_JSMN_VTYPE_UINT8 :
+			sizeof(M) == 2 ? JSON_JSMN_VTYPE_UINT16 :
+			sizeof(M) == 4 ? JSON_JSMN_VTYPE_UINT32 : JSON_JSMN_VTYPE_UINT64;
+	}
+}
+
+inline jsmntype_t token_type(const json_jsmn_token_t *t)
+{
+	// a 4 bit field with compact tokens
+	return static_cast<jsmntype_t>(t->type);
+}
+
+template <class T>
+int decode_object(const json_jsmn_t &jjs, const json_jsmn_token_t *t, T &out);
+
+// 1 when the value token t was stored into out, 0 when it does not fit M
+template <class M>
+int decode_value(const json_jsmn_t &jjs, const json_jsmn_token_t *t, M &out)
+{
+	const char *s = jjs.js + t->start;
+	std::size_t len = t->end - t->start;
+
+	if constexpr(std::is_arithmetic_v<M>)
+	{
+		static_assert(sizeof(M) <= 8, "json_jsmn: unsupported number type");
+		if(token_type(t) != JSMN_PRIMITIVE)
+		{
+			return 0;
+		}
+		return !json_jsmn_number_decode(s, len, number_vtype<M>(), &out, sizeof(out));
+	}
+	else if constexpr(std::is_same_v<M, std::string_view>)
+	{
+		if(token_type(t) != JSMN_STRING)
+		{
+			return 0;
+		}
+		out = std::string_view(s, len);
+		return 1;
+	}
+	else if constexpr(std::is_same_v<M, std::string>)
+	{
+		int n;
+
+		if(token_type(t) != JSMN_STRING)
+		{
+			return 0;
+		}
+		// decoded text is never longer than its source
+		out.resize(len + 1);
+		n = json_jsmn_unescape(s, len, &out[0], len + 1);
+		if(n < 0)
+		{
+			out.clear();
+			return 0;
+		}
+		out.resize(n);
+		return 1;
+	}
+	else if constexpr(std::is_array_v<M> && std::is_same_v<std::remove_extent_t<M>, char>)
+	{
+		if(token_type(t) != JSMN_STRING)
+		{
+			return 0;
+		}
+		return json_jsmn_unescape(s, len, out, sizeof(out)) >= 0;
+	}
+	else if constexpr(std::is_same_v<M, const json_jsmn_token_t *>)
+	{
+		out = t;
+		return 1;
+	}
+	else if constexpr(std::is_same_v<M, json_jsmn_t>)
+	{
+		json_jsmn_subdocument(&jjs, t, &out);
+		return 1;
+	}
+	else
+	{
+		static_assert(has_fields<M>::value, "json_jsmn: member type without JSON_JSMN_FIELDS()");
+		return decode_object(jjs, t, out);
+	}
+}
+
+// decode the value t into field I of out: a switch once the folds are inlined
+template <class T, std::size_t... I>
+int decode_field(const json_jsmn_t &jjs, const json_jsmn_token_t *t, T &out, int index, std::index_sequence<I...>)
+{
+	int n = 0;
+
+	(void)((index == (int)I && (n = decode_value(jjs, t, out.*(std::get<I>(fields<T>::value).member)), true)) || ...);
+	return n;
+}
+
+// members without a field are skipped by their span
+template <class T>
+int decode_object(const json_jsmn_t &jjs, const json_jsmn_token_t *t, T &out)
+{
+	const json_jsmn_token_t *k, *end;
+	int index, n;
+
+	if(token_type(t) != JSMN_OBJECT)
+	{
+		return 0;
+	}
+
+	// a key spans its value too, k always lands on the next key
+	for(
+			k = t + 1, end = t + json_jsmn_span(&jjs, t), n = 0;
+			k + 1 < end;
+			k += json_jsmn_span(&jjs, k)
+		)
+	{
+		index = key_matcher<T>::find(jjs.js + k->start, k->end - k->start);
+		if(index >= 0)
+		{
+			n += decode_field(jjs, k + 1, out, index, std::make_index_sequence<field_count<T>>());
+		}
+	}
+	return n;
+}
+
+} // namespace detail
+
+/*
+ * Decode the object token t of jjs straight into out, in a single walk of
+ * the tokens. Same rules as json_jsmn_struct_decode(): members left out of
+ * the table are skipped, members whose value has another type or does not
+ * decode are left untouched. Returns the number of values stored, those of
+ * nested objects included, or JSMN_ERROR_INVAL when t is not an object.
+ */
+template <class T>
+int decode(const json_jsmn_t &jjs, const json_jsmn_token_t *t, T &out)
+{
+	static_assert(detail::has_fields<T>::value, "json_jsmn::decode(): type without JSON_JSMN_FIELDS()");
+	if(!t || t < jjs.tokens || t >= jjs.tokens + jjs.token_count || detail::token_type(t) != JSMN_OBJECT)
+	{
+		return JSMN_ERROR_INVAL;
+	}
+	return detail::decode_object(jjs, t, out);
+}
+
+// the root object of jjs
+template <class T>
+int decode(const json_jsmn_t &jjs, T &out)
+{
+	return decode(jjs, jjs.token_count ? jjs.tokens : nullptr, out);
+}
+
+// field index of the key token t in the table of T, -1 if none
+template <class T>
+int find_key(const char *js, const json_jsmn_token_t *t)
+{
+	return detail::key_matcher<T>::find(js + t->start, t->end - t->start);
+}
+
+/*
+ * json_jsmn_t holder: a tokenized document (tokens from jsmn_parse(),
+ * json_parse_document() or any other C entry point) and its optional span
+ * index. The C API keeps working on get().
+ */
+class document
+{
+public:
+	document(const char *js, const json_jsmn_token_t *tokens, unsigned int token_count)
+	{
+		json_jsmn_init(&jjs_, js, tokens, token_count);
+	}
+
+	explicit document(const json_jsmn_t &jjs) : jjs_(jjs) {}
+
+	// see json_jsmn_index()
+	int index(unsigned int *spans, unsigned int spans_count)
+	{
+		return json_jsmn_index(&jjs_, spans, spans_count);
+	}
+
+	json_jsmn_t *get() { return &jjs_; }
+	const json_jsmn_t *get() const { return &jjs_; }
+
+	const json_jsmn_token_t *root() const { return jjs_.token_count ? jjs_.tokens : nullptr; }
+
+	template <class T>
+	int decode(T &out) const
+	{
+		return json_jsmn::decode(jjs_, out);
+	}
+
+	template <class T>
+	int decode(const json_jsmn_token_t *t, T &out) const
+	{
+		return json_jsmn::decode(jjs_, t, out);
+	}
+
+private:
+	json_jsmn_t jjs_;
+};
+
+} // namespace json_jsmn
+
+// field table of type, at global scope: JSON_JSMN_FIELDS(type, json_jsmn::field(...), ...)
+#define JSON_JSMN_FIELDS(type, ...)										\
+	namespace json_jsmn													\
+	{																	\
+		template <>														\
+		struct fields<type>												\
+		{																\
+			static constexpr auto value = std::make_tuple(__VA_ARGS__);	\
+		};																\
+	}
+
+#endif /* __JSON_JSMN_HPP_ */
@@ -0,0 +1,58 @@
+#ifndef __JSON_JSMN_NUMBER_H_
+#define __JSON_JSMN_NUMBER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "json_jsmn.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// the number is valid JSON but does not fit the destination
+#define JSON_JSMN_NUMBER_RANGE		(-4)
+
+/*
+ * Locale independent decoding of the JSON number s[0..len). Integers are
+ * accumulated directly (8 digits at a time when possible) and overflow is
+ * reported instead of clamped. Doubles and floats are correctly rounded:
+ * Clinger's exact fast path, then Eisel-Lemire over a 128-bit table of
+ * powers of five, then for the rare literal of more than 19 digits whose
+ * tail decides, an exact decimal conversion of any length. Returns 0, JSMN_ERROR_INVAL when s is not a JSON number
+ * (or not an integer for the integer variants) or JSON_JSMN_NUMBER_RANGE.
+ * On range errors doubles/floats still receive +-inf.
+ */
+int json_jsmn_number_int64(const char *s, size_t len, int64_t *value);
+int json_jsmn_number_uint64(const char *s, size_t len, uint64_t *value);
+int json_jsmn_number_double(const char *s, size_t len, double *value);
+int json_jsmn_number_float(const char *s, size_t len, float *value);
+
+/*
+ * Decode the primitive s[0..len) into out (size bytes) as vtype. true and
+ * false decode to 1 and 0 for the integer and bool types, null is rejected.
+ */
+int json_jsmn_number_decode
+	(
+		const char *s, size_t len,
+		json_jsmn_vtype_t vtype,
+		void *out, int size
+	);
+
+static inline int json_jsmn_token_int64(const char *js, const json_jsmn_token_t *t, int64_t *value)
+{
+	return json_jsmn_number_int64(js + t->start, t->end - t->start, value);
+}
+static inline int json_jsmn_token_uint64(const char *js, const json_jsmn_token_t *t, uint64_t *value)
+{
+	return json_jsmn_number_uint64(js + t->start, t->end - t->start, value);
+}
+static inline int json_jsmn_token_double(const char *js, const json_jsmn_token_t *t, double *value)
+{
+	return json_jsmn_number_double(js + t->start, t->end - t->start, value);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JSON_JSMN_NUMBER_H_ */
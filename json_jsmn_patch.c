@@ -0,0 +1,382 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "json_jsmn_patch.h"
+
+#ifdef JSON_JSMN_DEBUG_ENABLED
+#ifndef debugPrintf
+#define debugPrintf    				printf
+#define debugPrintln(fmt,args...)   debugPrintf(fmt "%s", ## args, "\r\n")
+#else
+#define debugPrintln(fmt,args...)   debugPrintf(fmt "%s", ## args, "\r\n")
+#endif
+#else
+#define debugPrintf(...)
+#define debugPrintln(...)
+#endif
+
+// separators of inserted members: ",\"" or "\"" before the key, "\":" after it
+static const char patch_key_open[] = ",\"";
+static const char patch_key_close[] = "\":";
+
+struct patch_edit
+{
+	const json_jsmn_patch_t *patch;
+	json_jsmn_patch_op_t op;				// INSERT of a key present becomes REPLACE
+	const json_jsmn_token_t *container;		// DELETE and INSERT
+	const json_jsmn_token_t *item;			// DELETE: key of the member or the element
+	unsigned int from;						// js[from..to) is replaced
+	unsigned int to;
+	int comma;								// INSERT: follows another member or element
+};
+
+// string tokens exclude their quotes
+static unsigned int patch_token_start(const json_jsmn_token_t *t)
+{
+	return t->type == JSMN_STRING ? t->start - 1 : t->start;
+}
+
+static unsigned int patch_token_end(const json_jsmn_token_t *t)
+{
+	return t->type == JSMN_STRING ? t->end + 1 : t->end;
+}
+
+// member (key and value) or element starting at k
+static unsigned int patch_item_end(const json_jsmn_token_t *container, const json_jsmn_token_t *k)
+{
+	return patch_token_end(container->type == JSMN_OBJECT ? k + 1 : k);
+}
+
+// container holding item (a key or an element), walked down from the root by spans
+static const json_jsmn_token_t *patch_parent(const json_jsmn_t *jjs, const json_jsmn_token_t *item)
+{
+	const json_jsmn_token_t *c, *k, *end;
+
+	c = jjs->tokens;
+	while(c->type == JSMN_OBJECT || c->type == JSMN_ARRAY)
+	{
+		for(k = c + 1, end = c + json_jsmn_span(jjs, c); k < end; k += json_jsmn_span(jjs, k))
+		{
+			if(k == item)
+			{
+				return c;
+			}
+			if(item < k + json_jsmn_span(jjs, k))
+			{
+				break;
+			}
+		}
+		if(k >= end)
+		{
+			break;
+		}
+		// item is below k: in the value of a member or inside element k
+		c = c->type == JSMN_OBJECT ? k + 1 : k;
+	}
+	return NULL;
+}
+
+// key token of the member key[0..len) of object c, NULL when absent
+static const json_jsmn_token_t *patch_member
+	(
+		const json_jsmn_t *jjs,
+		const json_jsmn_token_t *c,
+		const char *key, size_t len
+	)
+{
+	const json_jsmn_token_t *k, *end;
+
+	for(k = c + 1, end = c + json_jsmn_span(jjs, c); k + 1 < end; k += json_jsmn_span(jjs, k))
+	{
+		if((size_t)(k->end - k->start) == len && !memcmp(jjs->js + k->start, key, len))
+		{
+			return k;
+		}
+	}
+	return NULL;
+}
+
+static int patch_deleted(const struct patch_edit *edits, int edits_count, const json_jsmn_token_t *item)
+{
+	int i;
+
+	for(i = 0; i < edits_count; i++)
+	{
+		if(edits[i].op == JSON_JSMN_PATCH_DELETE && edits[i].item == item)
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// does container c keep any of its members or elements
+static int patch_survivors
+	(
+		const json_jsmn_t *jjs,
+		const struct patch_edit *edits, int edits_count,
+		const json_jsmn_token_t *c
+	)
+{
+	const json_jsmn_token_t *k, *end;
+
+	for(k = c + 1, end = c + json_jsmn_span(jjs, c); k < end; k += json_jsmn_span(jjs, k))
+	{
+		if(!patch_deleted(edits, edits_count, k))
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * A deleted item takes the comma that follows it up to the next item when
+ * something survives after it, otherwise the comma before it from the end
+ * of the previous item. Neighbours deleted as well extend the range
+ * seamlessly, so the ranges of one container never overlap.
+ */
+static void patch_delete_range
+	(
+		const json_jsmn_t *jjs,
+		const struct patch_edit *edits, int edits_count,
+		struct patch_edit *e
+	)
+{
+	const json_jsmn_token_t *c = e->container;
+	const json_jsmn_token_t *k, *end, *prev, *next;
+	int before, after, found;
+
+	for(
+			k = c + 1, end = c + json_jsmn_span(jjs, c), prev = next = NULL, before = after = found = 0;
+			k < end && !after;
+			k += json_jsmn_span(jjs, k)
+		)
+	{
+		if(k == e->item)
+		{
+			found = 1;
+		}
+		else if(!found)
+		{
+			prev = k;
+			before |= !patch_deleted(edits, edits_count, k);
+		}
+		else
+		{
+			next = next ? next : k;
+			after = !patch_deleted(edits, edits_count, k);
+		}
+	}
+
+	if(next && (after || !before))
+	{
+		e->from = patch_token_start(e->item);
+		e->to = patch_token_start(next);
+	}
+	else if(before)
+	{
+		e->from = patch_item_end(c, prev);
+		e->to = patch_item_end(c, e->item);
+	}
+	else
+	{
+		e->from = patch_token_start(e->item);
+		e->to = patch_item_end(c, e->item);
+	}
+}
+
+static int patch_resolve
+	(
+		const json_jsmn_t *jjs,
+		const json_jsmntok_t *result,
+		struct patch_edit *e
+	)
+{
+	const json_jsmn_patch_t *patch = e->patch;
+	const json_jsmn_token_t *t = result->t_value;
+
+	if(!t)
+	{
+		debugPrintln("patch: %s not found", patch->path);
+		return JSMN_ERROR_INVAL;
+	}
+
+	e->op = patch->op;
+	e->container = NULL;
+	e->item = NULL;
+	e->comma = 0;
+	switch(patch->op)
+	{
+	case JSON_JSMN_PATCH_INSERT:
+		if(!patch->value)
+		{
+			return JSMN_ERROR_INVAL;
+		}
+		if(t->type == JSMN_OBJECT && patch->key)
+		{
+			e->item = patch_member(jjs, t, patch->key, strlen(patch->key));
+			if(e->item)
+			{
+				// upsert: the member's value is replaced instead
+				e->op = JSON_JSMN_PATCH_REPLACE;
+				e->from = patch_token_start(e->item + 1);
+				e->to = patch_token_end(e->item + 1);
+				e->item = NULL;
+				return 0;
+			}
+		}
+		else if(t->type != JSMN_ARRAY || patch->key)
+		{
+			return JSMN_ERROR_INVAL;
+		}
+		// before the closing bracket
+		e->container = t;
+		e->from = e->to = t->end - 1;
+		return 0;
+
+	case JSON_JSMN_PATCH_REPLACE:
+		if(!patch->value)
+		{
+			return JSMN_ERROR_INVAL;
+		}
+		e->from = patch_token_start(t);
+		e->to = patch_token_end(t);
+		return 0;
+
+	case JSON_JSMN_PATCH_DELETE:
+		// the root cannot go
+		e->item = result->t_key ? result->t_key : t;
+		e->container = t == jjs->tokens ? NULL : patch_parent(jjs, e->item);
+		return e->container ? 0 : JSMN_ERROR_INVAL;
+	}
+	return JSMN_ERROR_INVAL;
+}
+
+// append js[0..len) to slices, count stays negative once an error is met
+static int patch_slice(json_jsmn_slice_t *slices, int count, int slices_count, const char *s, size_t len)
+{
+	if(count < 0 || !len)
+	{
+		return count;
+	}
+	if(count >= slices_count)
+	{
+		return JSMN_ERROR_NOMEM;
+	}
+	slices[count].iov_base = (void *)s;
+	slices[count].iov_len = len;
+	return count + 1;
+}
+
+int json_jsmn_patch
+	(
+		const json_jsmn_t *jjs, size_t jslen,
+		const json_jsmn_patch_t *edits, int edits_count,
+		json_jsmn_slice_t *slices, int slices_count
+	)
+{
+	struct patch_edit e[JSON_JSMN_PATCH_MAX];
+	struct patch_edit *order[JSON_JSMN_PATCH_MAX], *p;
+	const char *paths[JSON_JSMN_PATCH_MAX];
+	json_jsmntok_t results[JSON_JSMN_PATCH_MAX];
+	unsigned int pos;
+	int i, j, n, rc;
+
+	if(edits_count < 0 || edits_count > JSON_JSMN_PATCH_MAX || !jjs->token_count)
+	{
+		return JSMN_ERROR_INVAL;
+	}
+
+	for(i = 0; i < edits_count; i++)
+	{
+		paths[i] = edits[i].path;
+	}
+	// one walk resolves every path
+	json_jsmn_path_query(jjs, paths, edits_count, results);
+	for(i = 0; i < edits_count; i++)
+	{
+		e[i].patch = &edits[i];
+		rc = patch_resolve(jjs, &results[i], &e[i]);
+		if(rc)
+		{
+			return rc;
+		}
+	}
+
+	// separators depend on what survives, so every edit is resolved first
+	for(i = 0; i < edits_count; i++)
+	{
+		if(e[i].op == JSON_JSMN_PATCH_DELETE)
+		{
+			patch_delete_range(jjs, e, edits_count, &e[i]);
+		}
+		else if(e[i].op == JSON_JSMN_PATCH_INSERT)
+		{
+			for(j = 0; j < i && !e[i].comma; j++)
+			{
+				e[i].comma = e[j].op == JSON_JSMN_PATCH_INSERT && e[j].container == e[i].container;
+			}
+			e[i].comma = e[i].comma || patch_survivors(jjs, e, edits_count, e[i].container);
+		}
+	}
+
+	// stable insertion sort by range, inserts at one place keep their order
+	for(i = 0; i < edits_count; i++)
+	{
+		p = &e[i];
+		for(j = i; j > 0 && (order[j - 1]->from > p->from || (order[j - 1]->from == p->from && order[j - 1]->to > p->to)); j--)
+		{
+			order[j] = order[j - 1];
+		}
+		order[j] = p;
+	}
+
+	for(i = 1; i < edits_count; i++)
+	{
+		if(order[i]->from < order[i - 1]->to)
+		{
+			debugPrintln("patch: %s overlaps %s", order[i]->patch->path, order[i - 1]->patch->path);
+			return JSMN_ERROR_INVAL;
+		}
+	}
+	if(edits_count && order[edits_count - 1]->to > jslen)
+	{
+		return JSMN_ERROR_INVAL;
+	}
+
+	for(i = 0, pos = 0, n = 0; i < edits_count; i++)
+	{
+		p = order[i];
+		n = patch_slice(slices, n, slices_count, jjs->js + pos, p->from - pos);
+		if(p->op == JSON_JSMN_PATCH_INSERT && p->container->type == JSMN_OBJECT)
+		{
+			n = patch_slice(slices, n, slices_count, patch_key_open + !p->comma, sizeof(patch_key_open) - 1 - !p->comma);
+			n = patch_slice(slices, n, slices_count, p->patch->key, strlen(p->patch->key));
+			n = patch_slice(slices, n, slices_count, patch_key_close, sizeof(patch_key_close) - 1);
+		}
+		else if(p->op == JSON_JSMN_PATCH_INSERT && p->comma)
+		{
+			n = patch_slice(slices, n, slices_count, patch_key_open, 1);
+		}
+		if(p->op != JSON_JSMN_PATCH_DELETE)
+		{
+			n = patch_slice(slices, n, slices_count, p->patch->value, p->patch->value_len);
+		}
+		pos = p->to;
+	}
+	return patch_slice(slices, n, slices_count, jjs->js + pos, jslen - pos);
+}
+
+size_t json_jsmn_slices_length(const json_jsmn_slice_t *slices, int slices_count)
+{
+	size_t len = 0;
+	int i;
+
+	for(i = 0; i < slices_count; i++)
+	{
+		len += slices[i].iov_len;
+	}
+	return len;
+}
@@ -0,0 +1,84 @@
+#ifndef __JSON_JSMN_PATCH_H_
+#define __JSON_JSMN_PATCH_H_
+
+#include <stddef.h>
+#include "json_jsmn.h"
+#include "json_jsmn_path.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/uio.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// edits applied by one json_jsmn_patch() call, paths are resolved together
+#define JSON_JSMN_PATCH_MAX			JSON_JSMN_PATH_MAX
+
+// slices json_jsmn_patch() may need for count edits
+#define JSON_JSMN_PATCH_SLICES(count)	(5 * (count) + 1)
+
+// one piece of the output, a struct iovec where there is one: writev() ready
+#if defined(__unix__) || defined(__APPLE__)
+typedef struct iovec json_jsmn_slice_t;
+#else
+typedef struct
+{
+	void *iov_base;
+	size_t iov_len;
+}json_jsmn_slice_t;
+#endif
+
+typedef enum
+{
+	JSON_JSMN_PATCH_REPLACE,		// value at path becomes value
+	JSON_JSMN_PATCH_DELETE,			// member or element at path is removed, comma included
+	JSON_JSMN_PATCH_INSERT			// member key: value added to the object at path (replaced when
+									// present), or value appended to the array at path (key NULL)
+}json_jsmn_patch_op_t;
+
+/*
+ * One edit. path is a JSON pointer (see json_jsmn_path_query()). value is
+ * the new value already serialized (e.g. by json_jsmn_writer), key the body
+ * of the new member's name, escapes included; both are referenced by the
+ * output, not copied.
+ */
+typedef struct
+{
+	json_jsmn_patch_op_t op;
+	const char *path;
+	const char *key;
+	const char *value;
+	size_t value_len;
+}json_jsmn_patch_t;
+
+/*
+ * Patch the tokenized document jjs (js[0..jslen)) without re-serializing it:
+ * slices receives the patched document as runs of js left untouched (and
+ * their whitespace) interleaved with the new values and the few separators
+ * the edits need. Nothing is copied or allocated, the slices point into js,
+ * the edits and static storage, so they are valid as long as those are.
+ * Edits may come in any order but must not overlap: an edit inside a value
+ * another edit replaces or deletes fails. Inserts into the same container
+ * keep their order.
+ * Returns the number of slices, JSMN_ERROR_INVAL when a path does not
+ * resolve, an edit does not fit its target or edits overlap, or
+ * JSMN_ERROR_NOMEM when slices_count is short (JSON_JSMN_PATCH_SLICES()
+ * always suffices).
+ */
+int json_jsmn_patch
+	(
+		const json_jsmn_t *jjs, size_t jslen,
+		const json_jsmn_patch_t *edits, int edits_count,
+		json_jsmn_slice_t *slices, int slices_count
+	);
+
+// bytes covered by slices
+size_t json_jsmn_slices_length(const json_jsmn_slice_t *slices, int slices_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JSON_JSMN_PATCH_H_ */
@@ -0,0 +1,428 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "json_jsmn_path.h"
+
+#ifdef JSON_JSMN_DEBUG_ENABLED
+#ifndef debugPrintf
+#define debugPrintf    				printf
+#define debugPrintln(fmt,args...)   debugPrintf(fmt "%s", ## args, "\r\n")
+#else
+#define debugPrintln(fmt,args...)   debugPrintf(fmt "%s", ## args, "\r\n")
+#endif
+#else
+#define debugPrintf(...)
+#define debugPrintln(...)
+#endif
+
+struct path_query
+{
+	const json_jsmn_t *jjs;
+	const char **paths;
+	const char *cursor[JSON_JSMN_PATH_MAX];		// '/' starting the segment of the current level
+	json_jsmntok_t *results;
+	uint32_t pending;
+};
+
+static const char *path_segment_end(const char *segment)
+{
+	// segment points at its leading '/'
+	segment++;
+	while(*segment && *segment != '/')
+	{
+		segment++;
+	}
+	return segment;
+}
+
+static const char *path_segment_start(const char *path, const char *segment)
+{
+	// '/' introducing the segment preceding segment
+	do
+	{
+		segment--;
+	}while(segment > path && *segment != '/');
+	return segment;
+}
+
+static int path_segment_strcmp(const char *segment, const char *js, const json_jsmn_token_t *t)
+{
+	const char *s = js + t->start;
+	const char *end = js + t->end;
+	char c;
+
+	for(segment++; *segment && *segment != '/'; segment++, s++)
+	{
+		c = *segment;
+		if(c == '~')
+		{
+			if(segment[1] == '0')
+			{
+				c = '~';
+				segment++;
+			}
+			else if(segment[1] == '1')
+			{
+				c = '/';
+				segment++;
+			}
+		}
+
+		if(s >= end || *s != c)
+		{
+			return 1;
+		}
+	}
+	return s != end;
+}
+
+static int path_segment_index(const char *segment)
+{
+	int index = 0;
+
+	segment++;
+	if(!*segment || *segment == '/' || (*segment == '0' && segment[1] && segment[1] != '/'))
+	{
+		// empty or leading zero
+		return -1;
+	}
+
+	for(; *segment && *segment != '/'; segment++)
+	{
+		if(*segment < '0' || *segment > '9' || index > (INT32_MAX - 9) / 10)
+		{
+			return -1;
+		}
+		index = index * 10 + (*segment - '0');
+	}
+	return index;
+}
+
+static void path_descend(struct path_query *q, uint32_t mask)
+{
+	int p;
+
+	for(p = 0; mask; p++, mask >>= 1)
+	{
+		if(mask & 1)
+		{
+			q->cursor[p] = path_segment_end(q->cursor[p]);
+		}
+	}
+}
+
+static void path_ascend(struct path_query *q, uint32_t mask)
+{
+	int p;
+
+	for(p = 0; mask; p++, mask >>= 1)
+	{
+		if(mask & 1)
+		{
+			q->cursor[p] = path_segment_start(q->paths[p], q->cursor[p]);
+		}
+	}
+}
+
+static void path_walk
+	(
+		struct path_query *q,
+		const json_jsmn_token_t *key,
+		const json_jsmn_token_t *t,
+		uint32_t mask
+	)
+{
+	const json_jsmn_t *jjs = q->jjs;
+	const json_jsmn_token_t *end, *k;
+	uint32_t submask, bit;
+	int p, index;
+
+	// paths ending at this level resolve to t
+	for(p = 0, bit = 1; p < JSON_JSMN_PATH_MAX; p++, bit <<= 1)
+	{
+		if((mask & bit) && !*q->cursor[p])
+		{
+			q->results[p].t_key = (json_jsmn_token_t *)key;
+			q->results[p].t_value = (json_jsmn_token_t *)t;
+			q->results[p].t_value_type = t->type;
+			q->results[p].t_count = json_jsmn_span(jjs, t);
+			q->pending &= ~bit;
+			mask &= ~bit;
+		}
+	}
+
+	if(!mask || (t->type != JSMN_OBJECT && t->type != JSMN_ARRAY))
+	{
+		return;
+	}
+
+	end = t + json_jsmn_span(jjs, t);
+	for(k = t + 1, index = 0; k < end && q->pending; index++)
+	{
+		// paths resolved in an earlier sibling are done, a duplicate key must not win
+		mask &= q->pending;
+		submask = 0;
+		for(p = 0, bit = 1; p < JSON_JSMN_PATH_MAX; p++, bit <<= 1)
+		{
+			if(!(mask & bit))
+			{
+				continue;
+			}
+
+			if(t->type == JSMN_OBJECT ?
+				0 == path_segment_strcmp(q->cursor[p], jjs->js, k) :
+				index == path_segment_index(q->cursor[p]))
+			{
+				submask |= bit;
+			}
+		}
+
+		if(t->type == JSMN_OBJECT)
+		{
+			if(submask)
+			{
+				debugPrintln("path: %.*s", k->end - k->start, jjs->js + k->start);
+				path_descend(q, submask);
+				path_walk(q, k, k + 1, submask);
+				path_ascend(q, submask);
+			}
+			k += json_jsmn_span(jjs, k);
+		}
+		else
+		{
+			if(submask)
+			{
+				path_descend(q, submask);
+				path_walk(q, NULL, k, submask);
+				path_ascend(q, submask);
+			}
+			k += json_jsmn_span(jjs, k);
+		}
+	}
+}
+
+int json_jsmn_path_query
+	(
+		const json_jsmn_t *jjs,
+		const char **paths, int paths_count,
+		json_jsmntok_t *results
+	)
+{
+	struct path_query q;
+	int p, n;
+
+	if(paths_count > JSON_JSMN_PATH_MAX)
+	{
+		return JSMN_ERROR_INVAL;
+	}
+
+	q.jjs = jjs;
+	q.paths = paths;
+	q.results = results;
+	q.pending = 0;
+	for(p = 0; p < paths_count; p++)
+	{
+		results[p].t_value_type = JSMN_UNDEFINED;
+		results[p].t_key = NULL;
+		results[p].t_value = NULL;
+		results[p].t_count = 0;
+
+		// "" selects the root, anything else must be a pointer
+		if(paths[p] && (!*paths[p] || *paths[p] == '/'))
+		{
+			q.cursor[p] = paths[p];
+			q.pending |= (uint32_t)1 << p;
+		}
+	}
+
+	if(jjs->token_count)
+	{
+		path_walk(&q, NULL, jjs->tokens, q.pending);
+	}
+
+	for(n = 0, p = 0; p < paths_count; p++)
+	{
+		if(results[p].t_value)
+		{
+			n++;
+		}
+	}
+	return n;
+}
+
+int json_jsmn_path_get
+	(
+		const json_jsmn_t *jjs,
+		const char *path,
+		json_jsmntok_t *result
+	)
+{
+	return json_jsmn_path_query(jjs, &path, 1, result);
+}
+
+static int path_segment_equal(const char *a, const char *b)
+{
+	const char *a_end = path_segment_end(a);
+
+	return (a_end - a) == (path_segment_end(b) - b) && 0 == memcmp(a, b, a_end - a);
+}
+
+static int matcher_node_add
+	(
+		json_jsmn_matcher_t *matcher,
+		int parent, const char *segment
+	)
+{
+	json_jsmn_matcher_node_t *node;
+	int i;
+
+	for(i = matcher->nodes[parent].child; i != -1; i = matcher->nodes[i].sibling)
+	{
+		if(path_segment_equal(matcher->nodes[i].segment, segment))
+		{
+			return i;
+		}
+	}
+
+	if(matcher->node_count >= matcher->node_max)
+	{
+		return JSMN_ERROR_NOMEM;
+	}
+
+	i = matcher->node_count++;
+	node = &matcher->nodes[i];
+	node->segment = segment;
+	node->child = -1;
+	node->object = -1;
+	node->sibling = matcher->nodes[parent].child;
+	matcher->nodes[parent].child = i;
+	return i;
+}
+
+int json_jsmn_matcher_init
+	(
+		json_jsmn_matcher_t *matcher,
+		json_jsmn_matcher_node_t *nodes, int node_max,
+		json_jsmn_object_t *objs, int objs_count
+	)
+{
+	const char *segment;
+	int i, node;
+
+	if(node_max < 1)
+	{
+		return JSMN_ERROR_NOMEM;
+	}
+
+	matcher->nodes = nodes;
+	matcher->node_max = node_max;
+	matcher->node_count = 1;
+	matcher->objs = objs;
+	matcher->objs_count = objs_count;
+	nodes[0].segment = NULL;
+	nodes[0].child = -1;
+	nodes[0].sibling = -1;
+	nodes[0].object = -1;
+
+	for(i = 0; i < objs_count; i++)
+	{
+		segment = objs[i].key;
+		if(*segment && *segment != '/')
+		{
+			return JSMN_ERROR_INVAL;
+		}
+
+		for(node = 0; *segment; segment = path_segment_end(segment))
+		{
+			node = matcher_node_add(matcher, node, segment);
+			if(node < 0)
+			{
+				return node;
+			}
+		}
+
+		if(nodes[node].object != -1)
+		{
+			// the same path twice
+			return JSMN_ERROR_INVAL;
+		}
+		nodes[node].object = i;
+	}
+
+	return matcher->node_count;
+}
+
+struct matcher_walk
+{
+	const json_jsmn_matcher_t *matcher;
+	const json_jsmn_t *jjs;
+	int remaining;
+};
+
+static void matcher_walk
+	(
+		struct matcher_walk *w,
+		int node,
+		const json_jsmn_token_t *t
+	)
+{
+	const json_jsmn_matcher_node_t *nodes = w->matcher->nodes;
+	const json_jsmn_token_t *k, *end;
+	json_jsmn_object_t *jobj;
+	int child, index, span;
+
+	span = json_jsmn_span(w->jjs, t);
+	if(nodes[node].object != -1)
+	{
+		jobj = &w->matcher->objs[nodes[node].object];
+		if(jobj->status != JSON_JSMN_VALID && json_jsmn_object_set(jobj, w->jjs->js, t, span))
+		{
+			w->remaining--;
+		}
+	}
+
+	if(nodes[node].child == -1 || (t->type != JSMN_OBJECT && t->type != JSMN_ARRAY))
+	{
+		return;
+	}
+
+	for(k = t + 1, end = t + span, index = 0; k < end && w->remaining; index++)
+	{
+		for(child = nodes[node].child; child != -1; child = nodes[child].sibling)
+		{
+			if(t->type == JSMN_OBJECT ?
+				0 == path_segment_strcmp(nodes[child].segment, w->jjs->js, k) :
+				index == path_segment_index(nodes[child].segment))
+			{
+				matcher_walk(w, child, t->type == JSMN_OBJECT ? k + 1 : k);
+				break;
+			}
+		}
+		k += json_jsmn_span(w->jjs, k);
+	}
+}
+
+int json_jsmn_matcher_parse
+	(
+		const json_jsmn_matcher_t *matcher,
+		const json_jsmn_t *jjs
+	)
+{
+	struct matcher_walk w;
+	int i;
+
+	for(i = 0; i < matcher->objs_count; i++)
+	{
+		matcher->objs[i].status = JSON_JSMN_EMPTY;
+	}
+
+	w.matcher = matcher;
+	w.jjs = jjs;
+	w.remaining = matcher->objs_count;
+	if(jjs->token_count)
+	{
+		matcher_walk(&w, 0, jjs->tokens);
+	}
+	return matcher->objs_count - w.remaining;
+}
@@ -0,0 +1,79 @@
+#ifndef __JSON_JSMN_PATH_H_
+#define __JSON_JSMN_PATH_H_
+
+#include "json_jsmn.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// maximum number of paths resolved by one json_jsmn_path_query() call
+#define JSON_JSMN_PATH_MAX		32
+
+/*
+ * Resolve JSON Pointer style paths ("/telemetry/battery/voltage", "/list/0")
+ * against an already tokenized document in a single forward walk: common
+ * prefixes are visited once and every member that no path goes through is
+ * skipped by its span. "~0" and "~1" decode to '~' and '/' as in RFC 6901,
+ * the empty path "" selects the root.
+ *
+ * results[i] receives the match of paths[i] (t_key is NULL for the root and
+ * array elements); unresolved paths get t_value == NULL. Returns the number
+ * of resolved paths or a negative JSMN_ERROR_* code.
+ */
+int json_jsmn_path_query
+	(
+		const json_jsmn_t *jjs,
+		const char **paths, int paths_count,
+		json_jsmntok_t *results
+	);
+
+int json_jsmn_path_get
+	(
+		const json_jsmn_t *jjs,
+		const char *path,
+		json_jsmntok_t *result
+	);
+
+/*
+ * Multi-path matcher: json_jsmn_object_t destinations whose key is a path
+ * ("/telemetry/battery/voltage") compiled once into a trie. Each message is
+ * then decoded by json_jsmn_matcher_parse() in one walk of its tokens, which
+ * ends as soon as every destination is filled. nodes is caller storage, at
+ * most one node per path segment plus the root is needed.
+ */
+typedef struct
+{
+	const char *segment;	// leading '/' of the segment inside a key, NULL for the root
+	short child;			// first child node, -1 when none
+	short sibling;			// next node with the same parent, -1 when none
+	short object;			// destination index, -1 for inner nodes
+}json_jsmn_matcher_node_t;
+
+typedef struct
+{
+	json_jsmn_matcher_node_t *nodes;
+	int node_count;
+	int node_max;
+	json_jsmn_object_t *objs;
+	int objs_count;
+}json_jsmn_matcher_t;
+
+int json_jsmn_matcher_init
+	(
+		json_jsmn_matcher_t *matcher,
+		json_jsmn_matcher_node_t *nodes, int node_max,
+		json_jsmn_object_t *objs, int objs_count
+	);
+
+int json_jsmn_matcher_parse
+	(
+		const json_jsmn_matcher_t *matcher,
+		const json_jsmn_t *jjs
+	);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JSON_JSMN_PATH_H_ */
@@ -0,0 +1,369 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "json_jsmn_project.h"
+#include "json_jsmn_path.h"
+#include "json_jsmn_stats.h"
+
+#ifdef JSON_JSMN_DEBUG_ENABLED
+#ifndef debugPrintf
+#define debugPrintf    				printf
+#define debugPrintln(fmt,args...)   debugPrintf(fmt "%s", ## args, "\r\n")
+#else
+#define debugPrintln(fmt,args...)   debugPrintf(fmt "%s", ## args, "\r\n")
+#endif
+#else
+#define debugPrintf(...)
+#define debugPrintln(...)
+#endif
+
+// nesting limit of slices output, the same as the writer's
+#define PROJECT_DEPTH				JSON_JSMN_WRITER_DEPTH
+
+struct project_walk
+{
+	const json_jsmn_t *jjs;
+	json_jsmn_project_out_t *out;
+	const json_jsmn_token_t *targets[JSON_JSMN_PATH_MAX];	// key of a member or element selected
+	int targets_count;
+};
+
+static void project_slice(json_jsmn_project_out_t *out, const char *s, size_t len)
+{
+	if(out->error)
+	{
+		return;
+	}
+	if(out->count >= out->slices_count)
+	{
+		out->error = JSMN_ERROR_NOMEM;
+		return;
+	}
+	out->slices[out->count].iov_base = (void *)s;
+	out->slices[out->count].iov_len = len;
+	out->count++;
+}
+
+// comma before every member or element but the first, nothing after a key
+static void project_separator(json_jsmn_project_out_t *out)
+{
+	if(out->after_key)
+	{
+		out->after_key = 0;
+	}
+	else if(out->members & (1u << out->depth))
+	{
+		project_slice(out, ",", 1);
+	}
+	else
+	{
+		out->members |= 1u << out->depth;
+	}
+}
+
+static void project_begin(json_jsmn_project_out_t *out, const json_jsmn_token_t *c)
+{
+	if(out->w)
+	{
+		if(c->type == JSMN_OBJECT)
+		{
+			json_jsmn_write_object_begin(out->w);
+		}
+		else
+		{
+			json_jsmn_write_array_begin(out->w);
+		}
+		return;
+	}
+
+	project_separator(out);
+	if(out->depth + 1 >= PROJECT_DEPTH)
+	{
+		out->error = out->error ? out->error : JSMN_ERROR_INVAL;
+		return;
+	}
+	project_slice(out, c->type == JSMN_OBJECT ? "{" : "[", 1);
+	out->depth++;
+	out->members &= ~(1u << out->depth);
+}
+
+static void project_end(json_jsmn_project_out_t *out, const json_jsmn_token_t *c)
+{
+	if(out->w)
+	{
+		if(c->type == JSMN_OBJECT)
+		{
+			json_jsmn_write_object_end(out->w);
+		}
+		else
+		{
+			json_jsmn_write_array_end(out->w);
+		}
+		return;
+	}
+
+	if(out->error)
+	{
+		// depth may not match any more, nothing is added anyway
+		return;
+	}
+	out->depth--;
+	project_slice(out, c->type == JSMN_OBJECT ? "}" : "]", 1);
+}
+
+// key token k, its escapes kept
+static void project_key(json_jsmn_project_out_t *out, const char *js, const json_jsmn_token_t *k)
+{
+	if(out->w)
+	{
+		json_jsmn_write_key_raw(out->w, js + k->start, k->end - k->start);
+		return;
+	}
+
+	project_separator(out);
+	// the key with its quotes, then the colon
+	project_slice(out, js + k->start - 1, k->end - k->start + 2);
+	project_slice(out, ":", 1);
+	out->after_key = 1;
+}
+
+// the value token t as it is in js
+static void project_value(json_jsmn_project_out_t *out, const char *js, const json_jsmn_token_t *t)
+{
+	const char *s = js + t->start;
+	size_t len = t->end - t->start;
+
+	if(t->type == JSMN_STRING)
+	{
+		s--;
+		len += 2;
+	}
+
+	if(out->w)
+	{
+		json_jsmn_write_raw(out->w, s, len);
+		return;
+	}
+	project_separator(out);
+	project_slice(out, s, len);
+}
+
+static int project_result(const json_jsmn_project_out_t *out, int n)
+{
+	if(out->w)
+	{
+		return out->w->error ? out->w->error : n;
+	}
+	return out->error ? out->error : n;
+}
+
+static int project_match
+	(
+		const char *js, const json_jsmn_token_t *k,
+		const char **keys_filter_list,
+		const json_jsmn_keyset_t *keyset
+	)
+{
+	if(keyset)
+	{
+		JSON_JSMN_STAT_ADD(key_compares, 1);
+		return json_jsmn_keyset_find(keyset, js, k) >= 0;
+	}
+	for(; *keys_filter_list; keys_filter_list++)
+	{
+		JSON_JSMN_STAT_ADD(key_compares, 1);
+		if(!jsmntok_strcmp(js, k, *keys_filter_list))
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static int project_keys
+	(
+		const json_jsmn_t *jjs,
+		const char **keys_filter_list,
+		const json_jsmn_keyset_t *keyset,
+		json_jsmn_project_out_t *out
+	)
+{
+	const json_jsmn_token_t *root, *k, *end;
+	int n;
+
+	if(!jjs->token_count || jjs->tokens[0].type != JSMN_OBJECT)
+	{
+		return JSMN_ERROR_INVAL;
+	}
+
+	root = jjs->tokens;
+	project_begin(out, root);
+	// a key spans its value too, k always lands on the next key
+	for(
+			k = root + 1, end = root + json_jsmn_span(jjs, root), n = 0;
+			k + 1 < end;
+			k += json_jsmn_span(jjs, k)
+		)
+	{
+		JSON_JSMN_STAT_ADD(keys, 1);
+		if(project_match(jjs->js, k, keys_filter_list, keyset))
+		{
+			JSON_JSMN_STAT_ADD(matches, 1);
+			project_key(out, jjs->js, k);
+			project_value(out, jjs->js, k + 1);
+			n++;
+		}
+	}
+	project_end(out, root);
+	return project_result(out, n);
+}
+
+void json_jsmn_project_out_writer(json_jsmn_project_out_t *out, json_jsmn_writer_t *w)
+{
+	memset(out, 0, sizeof(*out));
+	out->w = w;
+}
+
+void json_jsmn_project_out_slices
+	(
+		json_jsmn_project_out_t *out,
+		json_jsmn_slice_t *slices, int slices_count
+	)
+{
+	memset(out, 0, sizeof(*out));
+	out->slices = slices;
+	out->slices_count = slices_count;
+}
+
+int json_jsmn_project
+	(
+		const json_jsmn_t *jjs,
+		const char **keys_filter_list,
+		json_jsmn_project_out_t *out
+	)
+{
+	const char *none[] = { NULL };
+
+	return project_keys(jjs, keys_filter_list ? keys_filter_list : none, NULL, out);
+}
+
+int json_jsmn_project_keyset
+	(
+		const json_jsmn_t *jjs,
+		const json_jsmn_keyset_t *keyset,
+		json_jsmn_project_out_t *out
+	)
+{
+	return project_keys(jjs, NULL, keyset, out);
+}
+
+// 1 when t is selected, -1 when a selection lies below it, 0 otherwise
+static int project_target(const struct project_walk *pw, const json_jsmn_token_t *t)
+{
+	const json_jsmn_token_t *end = t + json_jsmn_span(pw->jjs, t);
+	int i, below;
+
+	for(i = 0, below = 0; i < pw->targets_count; i++)
+	{
+		if(pw->targets[i] == t)
+		{
+			return 1;
+		}
+		below |= pw->targets[i] > t && pw->targets[i] < end;
+	}
+	return -below;
+}
+
+// container c with only the selected members or elements and the paths to them
+static int project_walk(struct project_walk *pw, const json_jsmn_token_t *c)
+{
+	const json_jsmn_t *jjs = pw->jjs;
+	const json_jsmn_token_t *k, *v, *end;
+	int object = c->type == JSMN_OBJECT;
+	int n, selected;
+
+	project_begin(pw->out, c);
+	for(
+			k = c + 1, end = c + json_jsmn_span(jjs, c), n = 0;
+			k + object < end;
+			k += json_jsmn_span(jjs, k)
+		)
+	{
+		selected = project_target(pw, k);
+		if(!selected)
+		{
+			continue;
+		}
+
+		// the value of a member, the element itself in arrays
+		v = object ? k + 1 : k;
+		if(selected < 0 && v->type != JSMN_OBJECT && v->type != JSMN_ARRAY)
+		{
+			continue;
+		}
+		if(object)
+		{
+			project_key(pw->out, jjs->js, k);
+		}
+		if(selected > 0)
+		{
+			project_value(pw->out, jjs->js, v);
+			n++;
+		}
+		else
+		{
+			n += project_walk(pw, v);
+		}
+	}
+	project_end(pw->out, c);
+	return n;
+}
+
+int json_jsmn_project_paths
+	(
+		const json_jsmn_t *jjs,
+		const char **paths, int paths_count,
+		json_jsmn_project_out_t *out
+	)
+{
+	json_jsmntok_t results[JSON_JSMN_PATH_MAX];
+	struct project_walk pw;
+	int i, rc;
+
+	if(!jjs->token_count || paths_count > JSON_JSMN_PATH_MAX)
+	{
+		return JSMN_ERROR_INVAL;
+	}
+
+	// one walk resolves every path
+	rc = json_jsmn_path_query(jjs, paths, paths_count, results);
+	if(rc < 0)
+	{
+		return rc;
+	}
+
+	pw.jjs = jjs;
+	pw.out = out;
+	pw.targets_count = 0;
+	for(i = 0; i < paths_count; i++)
+	{
+		if(!results[i].t_value)
+		{
+			continue;
+		}
+		if(results[i].t_value == jjs->tokens)
+		{
+			// the whole document
+			project_value(out, jjs->js, jjs->tokens);
+			return project_result(out, 1);
+		}
+		pw.targets[pw.targets_count++] = results[i].t_key ? results[i].t_key : results[i].t_value;
+	}
+
+	if(jjs->tokens[0].type != JSMN_OBJECT && jjs->tokens[0].type != JSMN_ARRAY)
+	{
+		return JSMN_ERROR_INVAL;
+	}
+	return project_result(out, project_walk(&pw, jjs->tokens));
+}
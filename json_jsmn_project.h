@@ -0,0 +1,81 @@
+#ifndef __JSON_JSMN_PROJECT_H_
+#define __JSON_JSMN_PROJECT_H_
+
+#include <stdint.h>
+#include "json_jsmn.h"
+#include "json_jsmn_patch.h"
+#include "json_jsmn_writer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Destination of a projection, set up by one of the init functions below:
+ * - a writer: the projection is written as compact JSON (see
+ *   json_jsmn_writer.h for fixed, chunked and growable buffers)
+ * - slices: nothing is copied, slices reference js and static separators,
+ *   ready for writev() like the output of json_jsmn_patch()
+ */
+typedef struct
+{
+	json_jsmn_writer_t *w;
+	json_jsmn_slice_t *slices;
+	int slices_count;
+	int count;							// slices filled
+	int error;
+	int depth;
+	int after_key;
+	uint32_t members;					// bit n: the container at depth n has a member already
+}json_jsmn_project_out_t;
+
+void json_jsmn_project_out_writer(json_jsmn_project_out_t *out, json_jsmn_writer_t *w);
+
+void json_jsmn_project_out_slices
+	(
+		json_jsmn_project_out_t *out,
+		json_jsmn_slice_t *slices, int slices_count
+	);
+
+/*
+ * Trimmed copy of the root object of jjs holding only the members whose key
+ * is in keys_filter_list (NULL terminated, as for json_jsmn_parse()), in
+ * document order. Each kept member is copied as the raw bytes of its key and
+ * value in a single walk; nothing is decoded or re-encoded. Returns the
+ * number of members kept, JSMN_ERROR_INVAL when the root is not an object,
+ * or the error of the output (JSMN_ERROR_NOMEM when slices run short).
+ */
+int json_jsmn_project
+	(
+		const json_jsmn_t *jjs,
+		const char **keys_filter_list,
+		json_jsmn_project_out_t *out
+	);
+
+// same with a precompiled key set
+int json_jsmn_project_keyset
+	(
+		const json_jsmn_t *jjs,
+		const json_jsmn_keyset_t *keyset,
+		json_jsmn_project_out_t *out
+	);
+
+/*
+ * Projection on JSON pointers (see json_jsmn_path_query()): the objects and
+ * arrays leading to each selected value are kept with those values only,
+ * e.g. "/a/b" and "/c/1" give {"a":{"b":...},"c":[...]}; array elements are
+ * renumbered. The empty path keeps the whole document, unresolved paths are
+ * ignored. Returns the number of values kept or an error as above.
+ */
+int json_jsmn_project_paths
+	(
+		const json_jsmn_t *jjs,
+		const char **paths, int paths_count,
+		json_jsmn_project_out_t *out
+	);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JSON_JSMN_PROJECT_H_ */
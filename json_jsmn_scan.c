@@ -0,0 +1,1885 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "json_jsmn_scan.h"
+#include "json_jsmn_thread.h"
+
+#if !defined(JSON_JSMN_SCAN_SCALAR) && (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define JSON_JSMN_SCAN_X86
+#include <immintrin.h>
+#endif
+
+/*
+ * Stage one scanners: return the first position in [pos, len) holding
+ * '"', '\\' or '\0' (string body), the first non whitespace byte, or the
+ * first byte a JSON string cannot hold as is ('"', '\\' or below 0x20, for
+ * the writer). len when there is none.
+ */
+typedef size_t (*json_jsmn_scan_find_t)(const char *js, size_t pos, size_t len);
+
+struct json_jsmn_scan_ops
+{
+	const char *name;
+	json_jsmn_scan_find_t string;
+	json_jsmn_scan_find_t space;
+	json_jsmn_scan_find_t escape;
+};
+
+static size_t scan_string_scalar(const char *js, size_t pos, size_t len)
+{
+	char c;
+
+	for(; pos < len; pos++)
+	{
+		c = js[pos];
+		if(c == '\"' || c == '\\' || c == '\0')
+		{
+			break;
+		}
+	}
+	return pos;
+}
+
+static size_t scan_space_scalar(const char *js, size_t pos, size_t len)
+{
+	char c;
+
+	for(; pos < len; pos++)
+	{
+		c = js[pos];
+		if(c != ' ' && c != '\t' && c != '\r' && c != '\n')
+		{
+			break;
+		}
+	}
+	return pos;
+}
+
+static size_t scan_escape_scalar(const char *js, size_t pos, size_t len)
+{
+	unsigned char c;
+
+	for(; pos < len; pos++)
+	{
+		c = js[pos];
+		if(c == '\"' || c == '\\' || c < 0x20)
+		{
+			break;
+		}
+	}
+	return pos;
+}
+
+static const struct json_jsmn_scan_ops scan_scalar =
+{
+	"scalar", scan_string_scalar, scan_space_scalar, scan_escape_scalar
+};
+
+#ifdef JSON_JSMN_SCAN_X86
+__attribute__((target("sse2")))
+static size_t scan_string_sse2(const char *js, size_t pos, size_t len)
+{
+	const __m128i quote = _mm_set1_epi8('\"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	const __m128i zero = _mm_setzero_si128();
+	__m128i v;
+	unsigned int mask;
+
+	for(; pos + 16 <= len; pos += 16)
+	{
+		v = _mm_loadu_si128((const __m128i *)(js + pos));
+		mask = _mm_movemask_epi8
+				(
+					_mm_or_si128
+					(
+						_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+						_mm_cmpeq_epi8(v, zero)
+					)
+				);
+		if(mask)
+		{
+			return pos + __builtin_ctz(mask);
+		}
+	}
+	return scan_string_scalar(js, pos, len);
+}
+
+__attribute__((target("sse2")))
+static size_t scan_space_sse2(const char *js, size_t pos, size_t len)
+{
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i tab = _mm_set1_epi8('\t');
+	const __m128i cr = _mm_set1_epi8('\r');
+	const __m128i lf = _mm_set1_epi8('\n');
+	__m128i v;
+	unsigned int mask;
+
+	for(; pos + 16 <= len; pos += 16)
+	{
+		v = _mm_loadu_si128((const __m128i *)(js + pos));
+		mask = _mm_movemask_epi8
+				(
+					_mm_or_si128
+					(
+						_mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab)),
+						_mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, lf))
+					)
+				);
+		mask = ~mask & 0xffff;
+		if(mask)
+		{
+			return pos + __builtin_ctz(mask);
+		}
+	}
+	return scan_space_scalar(js, pos, len);
+}
+
+__attribute__((target("sse2")))
+static size_t scan_escape_sse2(const char *js, size_t pos, size_t len)
+{
+	const __m128i quote = _mm_set1_epi8('\"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	const __m128i control = _mm_set1_epi8(0x1f);
+	const __m128i zero = _mm_setzero_si128();
+	__m128i v;
+	unsigned int mask;
+
+	for(; pos + 16 <= len; pos += 16)
+	{
+		v = _mm_loadu_si128((const __m128i *)(js + pos));
+		// v <= 0x1f unsigned: nothing left once 0x1f is subtracted
+		mask = _mm_movemask_epi8
+				(
+					_mm_or_si128
+					(
+						_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+						_mm_cmpeq_epi8(_mm_subs_epu8(v, control), zero)
+					)
+				);
+		if(mask)
+		{
+			return pos + __builtin_ctz(mask);
+		}
+	}
+	return scan_escape_scalar(js, pos, len);
+}
+
+__attribute__((target("avx2")))
+static size_t scan_string_avx2(const char *js, size_t pos, size_t len)
+{
+	const __m256i quote = _mm256_set1_epi8('\"');
+	const __m256i backslash = _mm256_set1_epi8('\\');
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i v;
+	unsigned int mask;
+
+	for(; pos + 32 <= len; pos += 32)
+	{
+		v = _mm256_loadu_si256((const __m256i *)(js + pos));
+		mask = _mm256_movemask_epi8
+				(
+					_mm256_or_si256
+					(
+						_mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)),
+						_mm256_cmpeq_epi8(v, zero)
+					)
+				);
+		if(mask)
+		{
+			return pos + __builtin_ctz(mask);
+		}
+	}
+	return scan_string_sse2(js, pos, len);
+}
+
+__attribute__((target("avx2")))
+static size_t scan_space_avx2(const char *js, size_t pos, size_t len)
+{
+	const __m256i space = _mm256_set1_epi8(' ');
+	const __m256i tab = _mm256_set1_epi8('\t');
+	const __m256i cr = _mm256_set1_epi8('\r');
+	const __m256i lf = _mm256_set1_epi8('\n');
+	__m256i v;
+	unsigned int mask;
+
+	for(; pos + 32 <= len; pos += 32)
+	{
+		v = _mm256_loadu_si256((const __m256i *)(js + pos));
+		mask = _mm256_movemask_epi8
+				(
+					_mm256_or_si256
+					(
+						_mm256_or_si256(_mm256_cmpeq_epi8(v, space), _mm256_cmpeq_epi8(v, tab)),
+						_mm256_or_si256(_mm256_cmpeq_epi8(v, cr), _mm256_cmpeq_epi8(v, lf))
+					)
+				);
+		mask = ~mask;
+		if(mask)
+		{
+			return pos + __builtin_ctz(mask);
+		}
+	}
+	return scan_space_sse2(js, pos, len);
+}
+
+__attribute__((target("avx2")))
+static size_t scan_escape_avx2(const char *js, size_t pos, size_t len)
+{
+	const __m256i quote = _mm256_set1_epi8('\"');
+	const __m256i backslash = _mm256_set1_epi8('\\');
+	const __m256i control = _mm256_set1_epi8(0x1f);
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i v;
+	unsigned int mask;
+
+	for(; pos + 32 <= len; pos += 32)
+	{
+		v = _mm256_loadu_si256((const __m256i *)(js + pos));
+		mask = _mm256_movemask_epi8
+				(
+					_mm256_or_si256
+					(
+						_mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)),
+						_mm256_cmpeq_epi8(_mm256_subs_epu8(v, control), zero)
+					)
+				);
+		if(mask)
+		{
+			return pos + __builtin_ctz(mask);
+		}
+	}
+	return scan_escape_sse2(js, pos, len);
+}
+
+static const struct json_jsmn_scan_ops scan_sse2 =
+{
+	"sse2", scan_string_sse2, scan_space_sse2, scan_escape_sse2
+};
+
+static const struct json_jsmn_scan_ops scan_avx2 =
+{
+	"avx2", scan_string_avx2, scan_space_avx2, scan_escape_avx2
+};
+#endif // JSON_JSMN_SCAN_X86
+
+static const struct json_jsmn_scan_ops *json_jsmn_scan_ops;
+
+static const struct json_jsmn_scan_ops *json_jsmn_scan_select(void)
+{
+	const struct json_jsmn_scan_ops *ops = json_jsmn_scan_ops;
+
+	if(!ops)
+	{
+		ops = &scan_scalar;
+#ifdef JSON_JSMN_SCAN_X86
+		__builtin_cpu_init();
+		if(__builtin_cpu_supports("avx2"))
+		{
+			ops = &scan_avx2;
+		}
+		else if(__builtin_cpu_supports("sse2"))
+		{
+			ops = &scan_sse2;
+		}
+#endif
+		// every thread selects the same implementation, the race is benign
+		json_jsmn_scan_ops = ops;
+	}
+	return ops;
+}
+
+const char *json_jsmn_scan_impl(void)
+{
+	return json_jsmn_scan_select()->name;
+}
+
+size_t json_jsmn_scan_string_stop(const char *js, size_t pos, size_t len)
+{
+	return json_jsmn_scan_select()->string(js, pos, len);
+}
+
+size_t json_jsmn_scan_escape_stop(const char *s, size_t pos, size_t len)
+{
+	return json_jsmn_scan_select()->escape(s, pos, len);
+}
+
+/*
+ * Extent scanners shared by both token layouts. On success parser->pos is
+ * left on the last byte of the token (closing quote, last primitive byte),
+ * on error it is restored to the token start like jsmn does.
+ */
+static int scan_primitive_extent
+	(
+		jsmn_parser *parser,
+		const char *js, size_t len,
+		int *end
+	)
+{
+	int start;
+
+	start = parser->pos;
+
+	for(; parser->pos < len && js[parser->pos] != '\0'; parser->pos++)
+	{
+		switch(js[parser->pos])
+		{
+#ifndef JSMN_STRICT
+		case ':':
+#endif
+		case '\t':
+		case '\r':
+		case '\n':
+		case ' ':
+		case ',':
+		case ']':
+		case '}':
+			goto found;
+		default:
+			break;
+		}
+		if(js[parser->pos] < 32 || js[parser->pos] >= 127)
+		{
+			parser->pos = start;
+			return JSMN_ERROR_INVAL;
+		}
+	}
+#ifdef JSMN_STRICT
+	parser->pos = start;
+	return JSMN_ERROR_PART;
+#endif
+
+found:
+	*end = parser->pos;
+	parser->pos--;
+	return 0;
+}
+
+/*
+ * With state, a string the end of the input cut is resumed where its body
+ * was checked up to instead of from its opening quote.
+ */
+static int scan_string_extent
+	(
+		const struct json_jsmn_scan_ops *ops,
+		jsmn_parser *parser,
+		json_jsmn_scan_state_t *state,
+		const char *js, size_t len
+	)
+{
+	int start = parser->pos;
+	int i;
+	int escape = -1;						// escape not complete yet
+	char c;
+
+	parser->pos++;
+	if(state && state->string == (unsigned int)start)
+	{
+		parser->pos = state->checked;
+	}
+	for(; (parser->pos = ops->string(js, parser->pos, len)) < len; parser->pos++)
+	{
+		c = js[parser->pos];
+		if(c == '\0')
+		{
+			break;
+		}
+
+		if(c == '\"')
+		{
+			return 0;
+		}
+
+		// backslash
+		escape = parser->pos;
+		if(parser->pos + 1 < len)
+		{
+			parser->pos++;
+			switch(js[parser->pos])
+			{
+			case '\"':
+			case '/':
+			case '\\':
+			case 'b':
+			case 'f':
+			case 'r':
+			case 'n':
+			case 't':
+				escape = -1;
+				break;
+			case 'u':
+				parser->pos++;
+				for(i = 0; i < 4 && parser->pos < len && js[parser->pos] != '\0'; i++)
+				{
+					c = js[parser->pos];
+					if(!((c >= '0' && c <= '9') || (c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f')))
+					{
+						parser->pos = start;
+						return JSMN_ERROR_INVAL;
+					}
+					parser->pos++;
+				}
+				if(i == 4)
+				{
+					escape = -1;
+				}
+				parser->pos--;
+				break;
+			default:
+				parser->pos = start;
+				return JSMN_ERROR_INVAL;
+			}
+		}
+	}
+	if(state)
+	{
+		state->string = start;
+		state->checked = escape >= 0 ? (unsigned int)escape : parser->pos;
+	}
+	parser->pos = start;
+	return JSMN_ERROR_PART;
+}
+
+// tokens walked back to find an open container before the stack is built
+#ifndef JSON_JSMN_SCAN_WALK
+#define JSON_JSMN_SCAN_WALK			64
+#endif
+
+#define SCAN_OPEN_NONE				(-1)	// depth not known
+
+/*
+ * Open containers, outermost first. Without parent links jsmn finds the
+ * container a bracket closes (or a ',' returns to) by walking back over
+ * every token in between, which is quadratic for wide arrays and objects.
+ * json_jsmn_scan() starts each call without the stack and builds it from
+ * the tokens so far once such a walk gets long; json_jsmn_scan_resume()
+ * keeps it from the first byte. Containers nested deeper than
+ * JSON_JSMN_SCAN_DEPTH are only counted and found by walking back.
+ */
+void json_jsmn_scan_state_init(json_jsmn_scan_state_t *state)
+{
+	state->depth = 0;
+	state->string = (unsigned int)-1;
+	state->checked = 0;
+}
+
+static void scan_open_push(json_jsmn_scan_state_t *open, int i)
+{
+	if(open->depth < 0)
+	{
+		return;
+	}
+	if(open->depth < JSON_JSMN_SCAN_DEPTH)
+	{
+		open->open[open->depth] = i;
+	}
+	open->depth++;
+}
+
+// containers are the only tokens left with end == -1
+#define scan_open_build(open, tokens, toknext)							\
+do{																		\
+	int _i;																\
+	if((open)->depth == SCAN_OPEN_NONE)									\
+	{																	\
+		for((open)->depth = 0, _i = 0; _i < (int)(toknext); _i++)		\
+		{																\
+			if((tokens)[_i].start != -1 && (tokens)[_i].end == -1)		\
+			{															\
+				scan_open_push(open, _i);								\
+			}															\
+		}																\
+	}																	\
+}while(0)
+
+// innermost open container of a known stack, -1 at the top level
+#define scan_open_top(open, tokens, toknext, top)							\
+do{																			\
+	if((open)->depth <= JSON_JSMN_SCAN_DEPTH)								\
+	{																		\
+		(top) = (open)->depth ? (open)->open[(open)->depth - 1] : -1;		\
+		break;																\
+	}																		\
+	for((top) = (int)(toknext) - 1; (top) >= 0; (top)--)					\
+	{																		\
+		if((tokens)[top].start != -1 && (tokens)[top].end == -1)			\
+		{																	\
+			break;															\
+		}																	\
+	}																		\
+}while(0)
+
+/*
+ * The tokenizer below follows jsmn_parse() step by step, only the loops over
+ * string bodies and whitespace are replaced by the stage one scanners.
+ */
+static jsmntok_t *scan_alloc_token
+	(
+		jsmn_parser *parser,
+		jsmntok_t *tokens, size_t num_tokens
+	)
+{
+	jsmntok_t *tok;
+
+	if(parser->toknext >= num_tokens)
+	{
+		return NULL;
+	}
+	tok = &tokens[parser->toknext++];
+	tok->start = tok->end = -1;
+	tok->size = 0;
+#ifdef JSMN_PARENT_LINKS
+	tok->parent = -1;
+#endif
+	return tok;
+}
+
+static void scan_fill_token(jsmntok_t *token, jsmntype_t type, int start, int end)
+{
+	token->type = type;
+	token->start = start;
+	token->end = end;
+	token->size = 0;
+}
+
+static int scan_primitive
+	(
+		jsmn_parser *parser,
+		const char *js, size_t len,
+		jsmntok_t *tokens, size_t num_tokens
+	)
+{
+	jsmntok_t *token;
+	int start, end, r;
+
+	start = parser->pos;
+	r = scan_primitive_extent(parser, js, len, &end);
+	if(r < 0 || tokens == NULL)
+	{
+		return r;
+	}
+	token = scan_alloc_token(parser, tokens, num_tokens);
+	if(token == NULL)
+	{
+		parser->pos = start;
+		return JSMN_ERROR_NOMEM;
+	}
+	scan_fill_token(token, JSMN_PRIMITIVE, start, end);
+#ifdef JSMN_PARENT_LINKS
+	token->parent = parser->toksuper;
+#endif
+	return 0;
+}
+
+static int scan_string
+	(
+		const struct json_jsmn_scan_ops *ops,
+		jsmn_parser *parser,
+		json_jsmn_scan_state_t *open,
+		const char *js, size_t len,
+		jsmntok_t *tokens, size_t num_tokens
+	)
+{
+	jsmntok_t *token;
+	int start, r;
+
+	start = parser->pos;
+	r = scan_string_extent(ops, parser, open, js, len);
+	if(r < 0 || tokens == NULL)
+	{
+		return r;
+	}
+	token = scan_alloc_token(parser, tokens, num_tokens);
+	if(token == NULL)
+	{
+		parser->pos = start;
+		return JSMN_ERROR_NOMEM;
+	}
+	scan_fill_token(token, JSMN_STRING, start + 1, parser->pos);
+#ifdef JSMN_PARENT_LINKS
+	token->parent = parser->toksuper;
+#endif
+	return 0;
+}
+
+static int scan_tokens
+	(
+		jsmn_parser *parser,
+		json_jsmn_scan_state_t *open,
+		const char *js, size_t len,
+		jsmntok_t *tokens, unsigned int num_tokens
+	)
+{
+	const struct json_jsmn_scan_ops *ops = json_jsmn_scan_select();
+	int r;
+	int i;
+	jsmntok_t *token;
+	int count = parser->toknext;
+	char c;
+	jsmntype_t type;
+
+	for(; parser->pos < len && js[parser->pos] != '\0'; parser->pos++)
+	{
+		c = js[parser->pos];
+		switch(c)
+		{
+		case '{':
+		case '[':
+			count++;
+			if(tokens == NULL)
+			{
+				break;
+			}
+			token = scan_alloc_token(parser, tokens, num_tokens);
+			if(token == NULL)
+			{
+				return JSMN_ERROR_NOMEM;
+			}
+			if(parser->toksuper != -1)
+			{
+				jsmntok_t *t = &tokens[parser->toksuper];
+#ifdef JSMN_STRICT
+				if(t->type == JSMN_OBJECT)
+				{
+					return JSMN_ERROR_INVAL;
+				}
+#endif
+				t->size++;
+#ifdef JSMN_PARENT_LINKS
+				token->parent = parser->toksuper;
+#endif
+			}
+			token->type = (c == '{' ? JSMN_OBJECT : JSMN_ARRAY);
+			token->start = parser->pos;
+			parser->toksuper = parser->toknext - 1;
+			scan_open_push(open, parser->toksuper);
+			break;
+
+		case '}':
+		case ']':
+			if(tokens == NULL)
+			{
+				break;
+			}
+			type = (c == '}' ? JSMN_OBJECT : JSMN_ARRAY);
+#ifdef JSMN_PARENT_LINKS
+			if(parser->toknext < 1)
+			{
+				return JSMN_ERROR_INVAL;
+			}
+			token = &tokens[parser->toknext - 1];
+			for(;;)
+			{
+				if(token->start != -1 && token->end == -1)
+				{
+					if(token->type != type)
+					{
+						return JSMN_ERROR_INVAL;
+					}
+					token->end = parser->pos + 1;
+					parser->toksuper = token->parent;
+					if(open->depth > 0)
+					{
+						open->depth--;
+					}
+					break;
+				}
+				if(token->parent == -1)
+				{
+					if(token->type != type || parser->toksuper == -1)
+					{
+						return JSMN_ERROR_INVAL;
+					}
+					break;
+				}
+				token = &tokens[token->parent];
+			}
+#else
+			if(open->depth >= 0)
+			{
+				// the innermost open container is the one being closed
+				scan_open_top(open, tokens, parser->toknext, i);
+				if(i == -1 || tokens[i].type != type)
+				{
+					return JSMN_ERROR_INVAL;
+				}
+				tokens[i].end = parser->pos + 1;
+				open->depth--;
+				scan_open_top(open, tokens, parser->toknext, parser->toksuper);
+				break;
+			}
+			for(i = parser->toknext - 1; i >= 0; i--)
+			{
+				token = &tokens[i];
+				if(token->start != -1 && token->end == -1)
+				{
+					if(token->type != type)
+					{
+						return JSMN_ERROR_INVAL;
+					}
+					parser->toksuper = -1;
+					token->end = parser->pos + 1;
+					break;
+				}
+			}
+			// unmatched closing bracket
+			if(i == -1)
+			{
+				return JSMN_ERROR_INVAL;
+			}
+			for(; i >= 0; i--)
+			{
+				token = &tokens[i];
+				if(token->start != -1 && token->end == -1)
+				{
+					parser->toksuper = i;
+					break;
+				}
+			}
+			if((int)parser->toknext - i > JSON_JSMN_SCAN_WALK)
+			{
+				scan_open_build(open, tokens, parser->toknext);
+			}
+#endif
+			break;
+
+		case '\"':
+			r = scan_string(ops, parser, open, js, len, tokens, num_tokens);
+			if(r < 0)
+			{
+				return r;
+			}
+			count++;
+			if(parser->toksuper != -1 && tokens != NULL)
+			{
+				tokens[parser->toksuper].size++;
+			}
+			break;
+
+		case '\t':
+		case '\r':
+		case '\n':
+		case ' ':
+			// land on the last blank, the loop steps over it
+			parser->pos = ops->space(js, parser->pos, len) - 1;
+			break;
+
+		case ':':
+			parser->toksuper = parser->toknext - 1;
+			break;
+
+		case ',':
+			if(tokens != NULL && parser->toksuper != -1 &&
+				tokens[parser->toksuper].type != JSMN_ARRAY &&
+				tokens[parser->toksuper].type != JSMN_OBJECT)
+			{
+#ifdef JSMN_PARENT_LINKS
+				parser->toksuper = tokens[parser->toksuper].parent;
+#else
+				if(open->depth >= 0)
+				{
+					if(open->depth)
+					{
+						scan_open_top(open, tokens, parser->toknext, parser->toksuper);
+					}
+					break;
+				}
+				for(i = parser->toknext - 1; i >= 0; i--)
+				{
+					if(tokens[i].type == JSMN_ARRAY || tokens[i].type == JSMN_OBJECT)
+					{
+						if(tokens[i].start != -1 && tokens[i].end == -1)
+						{
+							parser->toksuper = i;
+							break;
+						}
+					}
+				}
+				if((int)parser->toknext - i > JSON_JSMN_SCAN_WALK)
+				{
+					scan_open_build(open, tokens, parser->toknext);
+				}
+#endif
+			}
+			break;
+
+#ifdef JSMN_STRICT
+		// in strict mode primitives are numbers and booleans
+		case '-':
+		case '0':
+		case '1':
+		case '2':
+		case '3':
+		case '4':
+		case '5':
+		case '6':
+		case '7':
+		case '8':
+		case '9':
+		case 't':
+		case 'f':
+		case 'n':
+			// and they must not be keys of the object
+			if(tokens != NULL && parser->toksuper != -1)
+			{
+				const jsmntok_t *t = &tokens[parser->toksuper];
+				if(t->type == JSMN_OBJECT || (t->type == JSMN_STRING && t->size != 0))
+				{
+					return JSMN_ERROR_INVAL;
+				}
+			}
+#else
+		// in non-strict mode every unquoted value is a primitive
+		default:
+#endif
+			r = scan_primitive(parser, js, len, tokens, num_tokens);
+			if(r < 0)
+			{
+				return r;
+			}
+			count++;
+			if(parser->toksuper != -1 && tokens != NULL)
+			{
+				tokens[parser->toksuper].size++;
+			}
+			break;
+
+#ifdef JSMN_STRICT
+		// unexpected char in strict mode
+		default:
+			return JSMN_ERROR_INVAL;
+#endif
+		}
+	}
+
+	if(tokens != NULL)
+	{
+		if(open->depth > 0)
+		{
+			return JSMN_ERROR_PART;
+		}
+		for(i = parser->toknext - 1; open->depth < 0 && i >= 0; i--)
+		{
+			// unmatched opened object or array
+			if(tokens[i].start != -1 && tokens[i].end == -1)
+			{
+				return JSMN_ERROR_PART;
+			}
+		}
+	}
+
+	return count;
+}
+
+int json_jsmn_scan
+	(
+		jsmn_parser *parser,
+		const char *js, size_t len,
+		jsmntok_t *tokens, unsigned int num_tokens
+	)
+{
+	json_jsmn_scan_state_t open;
+
+	open.depth = SCAN_OPEN_NONE;
+	open.string = (unsigned int)-1;
+	return scan_tokens(parser, &open, js, len, tokens, num_tokens);
+}
+
+#ifdef JSON_JSMN_COMPACT_TOKENS
+static json_jsmn_token_t *scan_alloc_compact
+	(
+		jsmn_parser *parser,
+		json_jsmn_token_t *tokens, size_t num_tokens
+	)
+{
+	json_jsmn_token_t *tok;
+
+	if(parser->toknext >= num_tokens)
+	{
+		return NULL;
+	}
+	tok = &tokens[parser->toknext++];
+	tok->start = tok->end = -1;
+	tok->type = JSMN_UNDEFINED;
+	tok->span = 0;
+	return tok;
+}
+
+#define scan_compact_container(t)	((t)->type == JSMN_OBJECT || (t)->type == JSMN_ARRAY)
+
+/*
+ * Add a scalar to the document: a member of an object is a key and waits for
+ * its value (span 0), a value hanging from a key extends the key's span.
+ */
+static int scan_compact_scalar
+	(
+		jsmn_parser *parser,
+		json_jsmn_token_t *tokens, size_t num_tokens,
+		jsmntype_t type, int start, int end
+	)
+{
+	json_jsmn_token_t *token, *super;
+
+	token = scan_alloc_compact(parser, tokens, num_tokens);
+	if(token == NULL)
+	{
+		return JSMN_ERROR_NOMEM;
+	}
+	token->type = type;
+	token->start = start;
+	token->end = end;
+	token->span = 1;
+	if(parser->toksuper != -1)
+	{
+		super = &tokens[parser->toksuper];
+		if(super->type == JSMN_OBJECT)
+		{
+			token->span = 0;
+		}
+		else if(!scan_compact_container(super))
+		{
+			super->span = (super->span ? super->span : 1) + 1;
+		}
+	}
+	return 0;
+}
+
+static int scan_compact_tokens
+	(
+		jsmn_parser *parser,
+		json_jsmn_scan_state_t *open,
+		const char *js, size_t len,
+		json_jsmn_token_t *tokens, unsigned int num_tokens
+	)
+{
+	const struct json_jsmn_scan_ops *ops = json_jsmn_scan_select();
+	int r;
+	int i, start, end, key;
+	json_jsmn_token_t *token;
+	char c;
+	jsmntype_t type;
+
+	for(; parser->pos < len && js[parser->pos] != '\0'; parser->pos++)
+	{
+		c = js[parser->pos];
+		switch(c)
+		{
+		case '{':
+		case '[':
+			token = scan_alloc_compact(parser, tokens, num_tokens);
+			if(token == NULL)
+			{
+				return JSMN_ERROR_NOMEM;
+			}
+			if(parser->toksuper != -1)
+			{
+				json_jsmn_token_t *t = &tokens[parser->toksuper];
+#ifdef JSMN_STRICT
+				if(t->type == JSMN_OBJECT)
+				{
+					return JSMN_ERROR_INVAL;
+				}
+#endif
+				if(!scan_compact_container(t))
+				{
+					// the key's span is known once this value closes
+					t->span = 0;
+				}
+			}
+			token->type = (c == '{' ? JSMN_OBJECT : JSMN_ARRAY);
+			token->start = parser->pos;
+			parser->toksuper = parser->toknext - 1;
+			scan_open_push(open, parser->toksuper);
+			break;
+
+		case '}':
+		case ']':
+			type = (c == '}' ? JSMN_OBJECT : JSMN_ARRAY);
+			if(open->depth >= 0)
+			{
+				scan_open_top(open, tokens, parser->toknext, i);
+				if(i == -1 || tokens[i].type != type)
+				{
+					return JSMN_ERROR_INVAL;
+				}
+				// closed before looking for the one it returns to
+				tokens[i].end = parser->pos + 1;
+				open->depth--;
+				scan_open_top(open, tokens, parser->toknext, parser->toksuper);
+				r = parser->toknext;
+			}
+			else
+			{
+				for(i = parser->toknext - 1; i >= 0; i--)
+				{
+					token = &tokens[i];
+					if(token->start != -1 && token->end == -1)
+					{
+						if(token->type != type)
+						{
+							return JSMN_ERROR_INVAL;
+						}
+						break;
+					}
+				}
+				// unmatched closing bracket
+				if(i == -1)
+				{
+					return JSMN_ERROR_INVAL;
+				}
+				for(parser->toksuper = -1, r = i - 1; r >= 0; r--)
+				{
+					if(tokens[r].start != -1 && tokens[r].end == -1)
+					{
+						parser->toksuper = r;
+						break;
+					}
+				}
+			}
+			token = &tokens[i];
+			token->end = parser->pos + 1;
+			key = i > 0 && !scan_compact_container(&token[-1]) && !token[-1].span;
+			if(parser->toknext - i + key > JSON_JSMN_SPAN_MAX)
+			{
+				// the span field cannot hold the subtree (or its key's)
+				return JSMN_ERROR_INVAL;
+			}
+			token->span = parser->toknext - i;
+			if(key)
+			{
+				token[-1].span = 1 + token->span;
+			}
+			if((int)parser->toknext - r > JSON_JSMN_SCAN_WALK)
+			{
+				scan_open_build(open, tokens, parser->toknext);
+			}
+			break;
+
+		case '\"':
+			start = parser->pos;
+			r = scan_string_extent(ops, parser, open, js, len);
+			if(r < 0)
+			{
+				return r;
+			}
+			r = scan_compact_scalar(parser, tokens, num_tokens, JSMN_STRING, start + 1, parser->pos);
+			if(r < 0)
+			{
+				parser->pos = start;
+				return r;
+			}
+			break;
+
+		case '\t':
+		case '\r':
+		case '\n':
+		case ' ':
+			parser->pos = ops->space(js, parser->pos, len) - 1;
+			break;
+
+		case ':':
+			parser->toksuper = parser->toknext - 1;
+			break;
+
+		case ',':
+			if(parser->toksuper != -1 && !scan_compact_container(&tokens[parser->toksuper]))
+			{
+				if(open->depth >= 0)
+				{
+					if(open->depth)
+					{
+						scan_open_top(open, tokens, parser->toknext, parser->toksuper);
+					}
+					break;
+				}
+				for(i = parser->toknext - 1; i >= 0; i--)
+				{
+					if(scan_compact_container(&tokens[i]) && tokens[i].start != -1 && tokens[i].end == -1)
+					{
+						parser->toksuper = i;
+						break;
+					}
+				}
+				if((int)parser->toknext - i > JSON_JSMN_SCAN_WALK)
+				{
+					scan_open_build(open, tokens, parser->toknext);
+				}
+			}
+			break;
+
+#ifdef JSMN_STRICT
+		case '-':
+		case '0':
+		case '1':
+		case '2':
+		case '3':
+		case '4':
+		case '5':
+		case '6':
+		case '7':
+		case '8':
+		case '9':
+		case 't':
+		case 'f':
+		case 'n':
+			if(parser->toksuper != -1)
+			{
+				const json_jsmn_token_t *t = &tokens[parser->toksuper];
+				// a key already holding a value spans more than itself
+				if(t->type == JSMN_OBJECT || (t->type == JSMN_STRING && t->span > 1))
+				{
+					return JSMN_ERROR_INVAL;
+				}
+			}
+#else
+		default:
+#endif
+			start = parser->pos;
+			r = scan_primitive_extent(parser, js, len, &end);
+			if(r < 0)
+			{
+				return r;
+			}
+			r = scan_compact_scalar(parser, tokens, num_tokens, JSMN_PRIMITIVE, start, end);
+			if(r < 0)
+			{
+				parser->pos = start;
+				return r;
+			}
+			break;
+
+#ifdef JSMN_STRICT
+		default:
+			return JSMN_ERROR_INVAL;
+#endif
+		}
+	}
+
+	if(open->depth > 0)
+	{
+		return JSMN_ERROR_PART;
+	}
+	for(i = parser->toknext - 1; open->depth < 0 && i >= 0; i--)
+	{
+		// unmatched opened object or array
+		if(tokens[i].start != -1 && tokens[i].end == -1)
+		{
+			return JSMN_ERROR_PART;
+		}
+	}
+
+	return parser->toknext;
+}
+
+int json_jsmn_scan_compact
+	(
+		jsmn_parser *parser,
+		const char *js, size_t len,
+		json_jsmn_token_t *tokens, unsigned int num_tokens
+	)
+{
+	json_jsmn_scan_state_t open;
+
+	open.depth = SCAN_OPEN_NONE;
+	open.string = (unsigned int)-1;
+	if(tokens == NULL)
+	{
+		// counting does not depend on the layout
+		return scan_tokens(parser, &open, js, len, NULL, 0);
+	}
+	return scan_compact_tokens(parser, &open, js, len, tokens, num_tokens);
+}
+#endif // JSON_JSMN_COMPACT_TOKENS
+
+int json_jsmn_scan_resume
+	(
+		jsmn_parser *parser,
+		json_jsmn_scan_state_t *state,
+		const char *js, size_t len,
+		json_jsmn_token_t *tokens, unsigned int num_tokens
+	)
+{
+#ifdef JSON_JSMN_COMPACT_TOKENS
+	if(tokens != NULL)
+	{
+		return scan_compact_tokens(parser, state, js, len, tokens, num_tokens);
+	}
+	return scan_tokens(parser, state, js, len, NULL, 0);
+#else
+	return scan_tokens(parser, state, js, len, tokens, num_tokens);
+#endif
+}
+
+/*
+ * Parallel tokenizer. A quote parity prepass gives the string state at every
+ * JSON_JSMN_SCAN_CHUNK boundary; each chunk is then moved to just after the
+ * first ',' outside a string, so no token and no key/value pair straddles
+ * two chunks. Chunks are tokenized independently: members and closing
+ * brackets of containers opened in an earlier chunk are recorded instead of
+ * applied. A serial pass over those records resolves them to global token
+ * indices, the tokens are copied in place in parallel and the records
+ * applied. Anything this model cannot express (NUL bytes, quotes inside
+ * primitives, several top-level values, malformed nesting) is handed to the
+ * serial tokenizer, which also provides the exact error code.
+ */
+#if !defined(JSMN_STRICT) && !defined(JSMN_PARENT_LINKS)
+
+#ifndef JSON_JSMN_SCAN_CHUNK
+#define JSON_JSMN_SCAN_CHUNK		(1024 * 1024)
+#endif
+
+#define SCAN_OUTER					(-2)	// toksuper: container opened before the chunk
+#define SCAN_FALLBACK				(-100)	// chunk needs the serial tokenizer
+
+#define scan_container(t)			((t)->type == JSMN_OBJECT || (t)->type == JSMN_ARRAY)
+
+// closing bracket of a container opened before the chunk
+struct scan_close
+{
+	int end;
+	unsigned int toknext;		// chunk tokens before the bracket
+	int size;					// members added by the chunk
+	jsmntype_t type;
+	int global;					// container token, set while stitching
+};
+
+struct scan_chunk
+{
+	size_t begin, end;
+	int in_string;				// quote parity, then string state at the coarse start
+	int rc;
+	json_jsmn_token_t *tokens;
+	unsigned int toknext, tokmax;
+	int *open;					// containers still open, innermost last
+	unsigned int open_count, open_max;
+	struct scan_close *closes;
+	unsigned int close_count, close_max;
+	int outer_size;				// members added to the innermost outer container left open
+	int outer_global;
+	unsigned int colons;		// bit n: ':' in the outer container left after n closes
+	unsigned int offset;		// global index of tokens[0]
+};
+
+struct scan_container_ref
+{
+	int index;
+	jsmntype_t type;
+};
+
+struct scan_parallel
+{
+	const struct json_jsmn_scan_ops *ops;
+	const char *js;
+	size_t len;
+	struct scan_chunk *chunks;
+	unsigned long chunk_count;
+	unsigned long next;
+	json_jsmn_token_t *tokens;
+	unsigned int num_tokens;
+	int fallback;
+};
+
+static int scan_grow(void **items, unsigned int *max, size_t size)
+{
+	unsigned int n = *max ? *max * 2 : 16;
+	void *p;
+
+	p = realloc(*items, (size_t)n * size);
+	if(!p)
+	{
+		return JSMN_ERROR_NOMEM;
+	}
+	*items = p;
+	*max = n;
+	return 0;
+}
+
+// 1 when the byte at pos follows an odd run of backslashes
+static int scan_escaped(const char *js, size_t pos)
+{
+	size_t n;
+
+	for(n = 0; n < pos && js[pos - n - 1] == '\\'; n++);
+	return n & 1;
+}
+
+static void scan_parallel_parity(void *ctx, int id)
+{
+	struct scan_parallel *sp = ctx;
+	unsigned long k, quotes;
+	size_t p, end;
+
+	(void)id;
+	while((k = json_jsmn_thread_fetch_add(&sp->next, 1)) < sp->chunk_count)
+	{
+		p = k * JSON_JSMN_SCAN_CHUNK;
+		end = p + JSON_JSMN_SCAN_CHUNK < sp->len ? p + JSON_JSMN_SCAN_CHUNK : sp->len;
+		p += scan_escaped(sp->js, p);
+		for(quotes = 0; p < end && (p = sp->ops->string(sp->js, p, end)) < end; )
+		{
+			if(sp->js[p] == '\"')
+			{
+				quotes++;
+				p++;
+			}
+			else if(sp->js[p] == '\\')
+			{
+				p += 2;
+			}
+			else
+			{
+				// NUL ends the document for jsmn
+				__atomic_store_n(&sp->fallback, 1, __ATOMIC_RELAXED);
+				break;
+			}
+		}
+		sp->chunks[k].in_string = quotes & 1;
+	}
+}
+
+static void scan_parallel_boundary(void *ctx, int id)
+{
+	struct scan_parallel *sp = ctx;
+	struct scan_chunk *chunk;
+	unsigned long k;
+	size_t p;
+	int in_string;
+
+	(void)id;
+	while((k = json_jsmn_thread_fetch_add(&sp->next, 1)) < sp->chunk_count)
+	{
+		chunk = &sp->chunks[k];
+		if(!k)
+		{
+			chunk->begin = 0;
+			continue;
+		}
+
+		p = k * JSON_JSMN_SCAN_CHUNK;
+		in_string = chunk->in_string;
+		if(in_string)
+		{
+			p += scan_escaped(sp->js, p);
+		}
+		for(chunk->begin = sp->len; p < sp->len; )
+		{
+			if(in_string)
+			{
+				// closing quote or escape, NUL was ruled out by the prepass
+				p = sp->ops->string(sp->js, p, sp->len);
+				if(p < sp->len && sp->js[p] == '\"')
+				{
+					in_string = 0;
+					p++;
+				}
+				else
+				{
+					p += 2;
+				}
+			}
+			else if(sp->js[p++] == '\"')
+			{
+				in_string = 1;
+			}
+			else if(sp->js[p - 1] == ',')
+			{
+				chunk->begin = p;
+				break;
+			}
+		}
+	}
+}
+
+static json_jsmn_token_t *scan_chunk_alloc(struct scan_chunk *chunk)
+{
+	json_jsmn_token_t *tok;
+
+	if(chunk->toknext == chunk->tokmax && scan_grow((void **)&chunk->tokens, &chunk->tokmax, sizeof(*chunk->tokens)))
+	{
+		return NULL;
+	}
+	tok = &chunk->tokens[chunk->toknext++];
+	tok->start = tok->end = -1;
+#ifdef JSON_JSMN_COMPACT_TOKENS
+	tok->type = JSMN_UNDEFINED;
+	tok->span = 0;
+#else
+	tok->size = 0;
+#endif
+	return tok;
+}
+
+static int scan_chunk_scalar
+	(
+		struct scan_chunk *chunk,
+		int toksuper,
+		jsmntype_t type, int start, int end
+	)
+{
+	json_jsmn_token_t *token, *super;
+
+	token = scan_chunk_alloc(chunk);
+	if(token == NULL)
+	{
+		return JSMN_ERROR_NOMEM;
+	}
+	token->type = type;
+	token->start = start;
+	token->end = end;
+#ifdef JSON_JSMN_COMPACT_TOKENS
+	// under an outer object a key is its own span until its value, in this chunk too
+	token->span = 1;
+	if(toksuper >= 0)
+	{
+		super = &chunk->tokens[toksuper];
+		if(super->type == JSMN_OBJECT)
+		{
+			token->span = 0;
+		}
+		else if(!scan_container(super))
+		{
+			super->span = (super->span ? super->span : 1) + 1;
+		}
+	}
+#else
+	(void)super;
+	if(toksuper >= 0)
+	{
+		chunk->tokens[toksuper].size++;
+	}
+	else
+	{
+		chunk->outer_size++;
+	}
+#endif
+	return 0;
+}
+
+/*
+ * json_jsmn_scan() over [chunk->begin, chunk->end) starting inside an
+ * unknown number of open containers. The first chunk starts at the top
+ * level instead, where jsmn has no container to fall back to.
+ */
+static int scan_chunk_tokens(const struct scan_parallel *sp, struct scan_chunk *chunk, int top)
+{
+	const char *js = sp->js;
+	jsmn_parser parser;
+	json_jsmn_token_t *token;
+	struct scan_close *close;
+	int toksuper = SCAN_OUTER;
+	int i, r, start, end;
+	jsmntype_t type;
+	char c;
+
+	jsmn_init(&parser);
+	for(parser.pos = chunk->begin; parser.pos < chunk->end; parser.pos++)
+	{
+		c = js[parser.pos];
+		switch(c)
+		{
+		case '{':
+		case '[':
+			token = scan_chunk_alloc(chunk);
+			if(token == NULL)
+			{
+				return JSMN_ERROR_NOMEM;
+			}
+			if(toksuper >= 0)
+			{
+#ifdef JSON_JSMN_COMPACT_TOKENS
+				if(!scan_container(&chunk->tokens[toksuper]))
+				{
+					chunk->tokens[toksuper].span = 0;
+				}
+#else
+				chunk->tokens[toksuper].size++;
+#endif
+			}
+			else
+			{
+				chunk->outer_size++;
+			}
+			token->type = (c == '{' ? JSMN_OBJECT : JSMN_ARRAY);
+			token->start = parser.pos;
+			toksuper = chunk->toknext - 1;
+			if(chunk->open_count == chunk->open_max &&
+				scan_grow((void **)&chunk->open, &chunk->open_max, sizeof(*chunk->open)))
+			{
+				return JSMN_ERROR_NOMEM;
+			}
+			chunk->open[chunk->open_count++] = toksuper;
+			break;
+
+		case '}':
+		case ']':
+			type = (c == '}' ? JSMN_OBJECT : JSMN_ARRAY);
+			if(chunk->open_count)
+			{
+				i = chunk->open[chunk->open_count - 1];
+				token = &chunk->tokens[i];
+				if(token->type != type)
+				{
+					return JSMN_ERROR_INVAL;
+				}
+				chunk->open_count--;
+				token->end = parser.pos + 1;
+#ifdef JSON_JSMN_COMPACT_TOKENS
+				if(chunk->toknext - i >= JSON_JSMN_SPAN_MAX)
+				{
+					// too wide for the span field, the serial tokenizer reports it
+					return SCAN_FALLBACK;
+				}
+				token->span = chunk->toknext - i;
+				if(i > 0 && !scan_container(&token[-1]) && !token[-1].span)
+				{
+					token[-1].span = 1 + token->span;
+				}
+#endif
+				toksuper = chunk->open_count ? chunk->open[chunk->open_count - 1] : SCAN_OUTER;
+				break;
+			}
+			if(top)
+			{
+				// unmatched closing bracket
+				return JSMN_ERROR_INVAL;
+			}
+			if(chunk->close_count == chunk->close_max &&
+				scan_grow((void **)&chunk->closes, &chunk->close_max, sizeof(*chunk->closes)))
+			{
+				return JSMN_ERROR_NOMEM;
+			}
+			close = &chunk->closes[chunk->close_count++];
+			close->end = parser.pos + 1;
+			close->toknext = chunk->toknext;
+			close->size = chunk->outer_size;
+			close->type = type;
+			chunk->outer_size = 0;
+			toksuper = SCAN_OUTER;
+			break;
+
+		case '\"':
+			start = parser.pos;
+			r = scan_string_extent(sp->ops, &parser, NULL, js, chunk->end);
+			if(r < 0)
+			{
+				return r;
+			}
+			r = scan_chunk_scalar(chunk, toksuper, JSMN_STRING, start + 1, parser.pos);
+			if(r < 0)
+			{
+				return r;
+			}
+			break;
+
+		case '\t':
+		case '\r':
+		case '\n':
+		case ' ':
+			parser.pos = sp->ops->space(js, parser.pos, chunk->end) - 1;
+			break;
+
+		case ':':
+			if(!chunk->toknext)
+			{
+				// the key is in the previous chunk
+				return SCAN_FALLBACK;
+			}
+			if(chunk->open_count)
+			{
+				if(chunk->tokens[chunk->open[chunk->open_count - 1]].type != JSMN_OBJECT)
+				{
+					// jsmn hangs the values after it on the previous token
+					return SCAN_FALLBACK;
+				}
+			}
+			else if(top || chunk->close_count >= 32)
+			{
+				return SCAN_FALLBACK;
+			}
+			else
+			{
+				// the stitch checks the outer container is an object
+				chunk->colons |= 1u << chunk->close_count;
+			}
+			toksuper = chunk->toknext - 1;
+			break;
+
+		case ',':
+			if(toksuper >= 0 && !scan_container(&chunk->tokens[toksuper]))
+			{
+				if(chunk->open_count)
+				{
+					toksuper = chunk->open[chunk->open_count - 1];
+				}
+				else if(!top)
+				{
+					toksuper = SCAN_OUTER;
+				}
+			}
+			break;
+
+		default:
+			start = parser.pos;
+			r = scan_primitive_extent(&parser, js, chunk->end, &end);
+			if(r < 0)
+			{
+				return r;
+			}
+			if(memchr(js + start, '\"', end - start))
+			{
+				// the quote parity prepass took it for a string
+				return SCAN_FALLBACK;
+			}
+			r = scan_chunk_scalar(chunk, toksuper, JSMN_PRIMITIVE, start, end);
+			if(r < 0)
+			{
+				return r;
+			}
+			break;
+		}
+	}
+	return 0;
+}
+
+static void scan_parallel_tokens(void *ctx, int id)
+{
+	struct scan_parallel *sp = ctx;
+	unsigned long k;
+
+	(void)id;
+	while((k = json_jsmn_thread_fetch_add(&sp->next, 1)) < sp->chunk_count)
+	{
+		sp->chunks[k].rc = scan_chunk_tokens(sp, &sp->chunks[k], k == 0);
+	}
+}
+
+static void scan_parallel_copy(void *ctx, int id)
+{
+	struct scan_parallel *sp = ctx;
+	struct scan_chunk *chunk;
+	unsigned long k;
+
+	(void)id;
+	while((k = json_jsmn_thread_fetch_add(&sp->next, 1)) < sp->chunk_count)
+	{
+		chunk = &sp->chunks[k];
+		if(chunk->toknext)
+		{
+			memcpy(sp->tokens + chunk->offset, chunk->tokens, chunk->toknext * sizeof(*chunk->tokens));
+		}
+	}
+}
+
+/*
+ * Resolve the outer references of every chunk against the containers left
+ * open by the chunks before it. Returns the token count, JSMN_ERROR_PART or
+ * SCAN_FALLBACK.
+ */
+static int scan_parallel_stitch(struct scan_parallel *sp)
+{
+	struct scan_container_ref *stack = NULL;
+	unsigned int depth = 0, stack_max = 0;
+	struct scan_chunk *chunk;
+	unsigned long k;
+	unsigned int i, total = 0;
+	int rc = SCAN_FALLBACK;
+
+	for(k = 0; k < sp->chunk_count; k++)
+	{
+		chunk = &sp->chunks[k];
+		if(chunk->rc < 0 || (k && !depth))
+		{
+			goto done;
+		}
+		if(chunk->close_count >= depth && chunk->close_count &&
+			(chunk->close_count > depth || chunk->toknext > chunk->closes[chunk->close_count - 1].toknext))
+		{
+			// values after the document closed: several top-level values
+			goto done;
+		}
+
+		chunk->offset = total;
+		for(i = 0; i <= chunk->close_count && i < 32; i++)
+		{
+			if((chunk->colons >> i & 1) && (i >= depth || stack[depth - 1 - i].type != JSMN_OBJECT))
+			{
+				// ':' outside an object
+				goto done;
+			}
+		}
+		for(i = 0; i < chunk->close_count; i++)
+		{
+			depth--;
+			if(stack[depth].type != chunk->closes[i].type)
+			{
+				goto done;
+			}
+			chunk->closes[i].global = stack[depth].index;
+#ifdef JSON_JSMN_COMPACT_TOKENS
+			if(total + chunk->closes[i].toknext - stack[depth].index >= JSON_JSMN_SPAN_MAX)
+			{
+				goto done;
+			}
+#endif
+		}
+		chunk->outer_global = depth ? stack[depth - 1].index : -1;
+
+		for(i = 0; i < chunk->open_count; i++)
+		{
+			if(depth == stack_max && scan_grow((void **)&stack, &stack_max, sizeof(*stack)))
+			{
+				rc = JSMN_ERROR_NOMEM;
+				goto done;
+			}
+			stack[depth].index = total + chunk->open[i];
+			stack[depth].type = chunk->tokens[chunk->open[i]].type;
+			depth++;
+		}
+		total += chunk->toknext;
+	}
+
+	// the serial tokenizer runs out of tokens before it finds the end missing
+	rc = total > sp->num_tokens ? JSMN_ERROR_NOMEM : depth ? JSMN_ERROR_PART : (int)total;
+
+done:
+	free(stack);
+	return rc;
+}
+
+static void scan_parallel_apply(struct scan_parallel *sp)
+{
+	json_jsmn_token_t *tokens = sp->tokens;
+	struct scan_chunk *chunk;
+	struct scan_close *close;
+	unsigned long k;
+	unsigned int i;
+	int g;
+
+	for(k = 0; k < sp->chunk_count; k++)
+	{
+		chunk = &sp->chunks[k];
+		for(i = 0; i < chunk->close_count; i++)
+		{
+			close = &chunk->closes[i];
+			g = close->global;
+			tokens[g].end = close->end;
+#ifdef JSON_JSMN_COMPACT_TOKENS
+			tokens[g].span = chunk->offset + close->toknext - g;
+			if(g > 0 && !scan_container(&tokens[g - 1]) && !tokens[g - 1].span)
+			{
+				tokens[g - 1].span = 1 + tokens[g].span;
+			}
+#else
+			tokens[g].size += close->size;
+#endif
+		}
+#ifndef JSON_JSMN_COMPACT_TOKENS
+		if(chunk->outer_global >= 0)
+		{
+			tokens[chunk->outer_global].size += chunk->outer_size;
+		}
+#endif
+	}
+}
+#endif // !JSMN_STRICT && !JSMN_PARENT_LINKS
+
+static int scan_serial
+	(
+		const char *js, size_t len,
+		json_jsmn_token_t *tokens, unsigned int num_tokens
+	)
+{
+	jsmn_parser parser;
+
+	jsmn_init(&parser);
+#ifdef JSON_JSMN_COMPACT_TOKENS
+	return json_jsmn_scan_compact(&parser, js, len, tokens, num_tokens);
+#else
+	return json_jsmn_scan(&parser, js, len, tokens, num_tokens);
+#endif
+}
+
+int json_jsmn_scan_parallel
+	(
+		const char *js, size_t len,
+		json_jsmn_token_t *tokens, unsigned int num_tokens,
+		int threads
+	)
+{
+#if !defined(JSMN_STRICT) && !defined(JSMN_PARENT_LINKS)
+	struct scan_parallel sp;
+	unsigned long k;
+	int rc;
+
+	threads = json_jsmn_thread_count(threads);
+	if(tokens == NULL || threads < 2 || len < 2 * JSON_JSMN_SCAN_CHUNK)
+	{
+		return scan_serial(js, len, tokens, num_tokens);
+	}
+
+	memset(&sp, 0, sizeof(sp));
+	sp.ops = json_jsmn_scan_select();
+	sp.js = js;
+	sp.len = len;
+	sp.tokens = tokens;
+	sp.num_tokens = num_tokens;
+	sp.chunk_count = (len + JSON_JSMN_SCAN_CHUNK - 1) / JSON_JSMN_SCAN_CHUNK;
+	sp.chunks = calloc(sp.chunk_count, sizeof(*sp.chunks));
+	if(!sp.chunks)
+	{
+		return JSMN_ERROR_NOMEM;
+	}
+
+	json_jsmn_thread_run(threads, scan_parallel_parity, &sp);
+	if(sp.fallback)
+	{
+		rc = SCAN_FALLBACK;
+		goto done;
+	}
+	for(k = 0, rc = 0; k < sp.chunk_count; k++)
+	{
+		// string state at the start of each chunk
+		rc ^= sp.chunks[k].in_string;
+		sp.chunks[k].in_string = rc ^ sp.chunks[k].in_string;
+	}
+
+	sp.next = 0;
+	json_jsmn_thread_run(threads, scan_parallel_boundary, &sp);
+	for(k = 0; k < sp.chunk_count; k++)
+	{
+		sp.chunks[k].end = k + 1 < sp.chunk_count ? sp.chunks[k + 1].begin : len;
+		if(sp.chunks[k].end < sp.chunks[k].begin)
+		{
+			sp.chunks[k].end = sp.chunks[k].begin;
+		}
+		sp.chunks[k].tokmax = 0;
+	}
+
+	sp.next = 0;
+	json_jsmn_thread_run(threads, scan_parallel_tokens, &sp);
+	rc = scan_parallel_stitch(&sp);
+	if(rc >= 0)
+	{
+		sp.next = 0;
+		json_jsmn_thread_run(threads, scan_parallel_copy, &sp);
+		scan_parallel_apply(&sp);
+	}
+
+done:
+	for(k = 0; k < sp.chunk_count; k++)
+	{
+		free(sp.chunks[k].tokens);
+		free(sp.chunks[k].open);
+		free(sp.chunks[k].closes);
+	}
+	free(sp.chunks);
+	if(rc == SCAN_FALLBACK)
+	{
+		rc = scan_serial(js, len, tokens, num_tokens);
+	}
+	return rc;
+#else
+	// strict checks and parent links need the enclosing container: serial only
+	(void)threads;
+	return scan_serial(js, len, tokens, num_tokens);
+#endif
+}
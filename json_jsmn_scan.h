@@ -0,0 +1,119 @@
+#ifndef __JSON_JSMN_SCAN_H_
+#define __JSON_JSMN_SCAN_H_
+
+#include <stddef.h>
+#include "jsmn/jsmn.h"
+#include "json_jsmn.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Drop-in replacement for jsmn_parse(): same parser state, same tokens, same
+ * return codes (including resuming after JSMN_ERROR_PART/JSMN_ERROR_NOMEM and
+ * the tokens == NULL counting mode), honouring JSMN_STRICT and
+ * JSMN_PARENT_LINKS like jsmn itself. String bodies and whitespace runs are
+ * scanned 16/32 bytes at a time with SSE2/AVX2 when the CPU has them, chosen
+ * at run time; other targets use a scalar loop. Define JSON_JSMN_SCAN_SCALAR
+ * to force the scalar loop.
+ */
+int json_jsmn_scan
+	(
+		jsmn_parser *parser,
+		const char *js, size_t len,
+		jsmntok_t *tokens, unsigned int num_tokens
+	);
+
+#ifdef JSON_JSMN_COMPACT_TOKENS
+/*
+ * Same tokenizer emitting json_jsmn_token_t: spans are filled in as
+ * containers close and keys receive their values, so the document needs no
+ * separate index. Parent links are never kept in this layout.
+ */
+int json_jsmn_scan_compact
+	(
+		jsmn_parser *parser,
+		const char *js, size_t len,
+		json_jsmn_token_t *tokens, unsigned int num_tokens
+	);
+#endif
+
+// open containers json_jsmn_scan_state_t tracks without walking back over tokens
+#ifndef JSON_JSMN_SCAN_DEPTH
+#define JSON_JSMN_SCAN_DEPTH		32
+#endif
+
+/*
+ * What json_jsmn_scan_resume() keeps between calls on one parser, so a call
+ * costs the bytes added since the previous one: the open containers, which
+ * a closing bracket, a ',' and the end of the input would otherwise find by
+ * walking back over every token, and how far the body of a string the end
+ * of the input cut was checked, which would otherwise be read again from
+ * its opening quote. Nesting deeper than JSON_JSMN_SCAN_DEPTH walks back
+ * over the tokens of the deepest containers only.
+ */
+typedef struct
+{
+	int depth;								// open containers, -1 while unknown
+	int open[JSON_JSMN_SCAN_DEPTH];			// token index of the outermost ones
+	unsigned int string;					// opening quote of the cut string
+	unsigned int checked;					// its body is valid up to there
+}json_jsmn_scan_state_t;
+
+// to be called together with jsmn_init()
+void json_jsmn_scan_state_init(json_jsmn_scan_state_t *state);
+
+/*
+ * json_jsmn_scan() (json_jsmn_scan_compact() with compact tokens) for input
+ * arriving in pieces: each call gets the whole input so far, js may move
+ * between calls but its content is only ever appended to.
+ */
+int json_jsmn_scan_resume
+	(
+		jsmn_parser *parser,
+		json_jsmn_scan_state_t *state,
+		const char *js, size_t len,
+		json_jsmn_token_t *tokens, unsigned int num_tokens
+	);
+
+/*
+ * Tokenize a whole document on up to threads workers (see json_jsmn_thread.h)
+ * into json_jsmn_token_t, as json_jsmn_scan() or json_jsmn_scan_compact()
+ * would from a fresh parser. The input is cut into
+ * JSON_JSMN_SCAN_CHUNK (1MB) pieces realigned on commas outside strings;
+ * smaller inputs, JSMN_STRICT and JSMN_PARENT_LINKS builds, and input the
+ * chunks cannot be stitched back from (most malformed documents) are
+ * tokenized serially. Returns the token count or the serial error code, the
+ * tokens are undefined on error. With compact tokens, the spans of object
+ * members lacking a value in documents jsmn accepts anyway may differ.
+ */
+int json_jsmn_scan_parallel
+	(
+		const char *js, size_t len,
+		json_jsmn_token_t *tokens, unsigned int num_tokens,
+		int threads
+	);
+
+/*
+ * First position in [pos, len) holding '"', '\\' or '\0', len when there is
+ * none. This is the string body scanner the tokenizer uses, exported for the
+ * string accessors.
+ */
+size_t json_jsmn_scan_string_stop(const char *js, size_t pos, size_t len);
+
+/*
+ * First position in [pos, len) holding a byte a JSON string must escape:
+ * '"', '\\' or a control character below 0x20. len when there is none.
+ * Used by the writer.
+ */
+size_t json_jsmn_scan_escape_stop(const char *s, size_t pos, size_t len);
+
+// name of the selected implementation: "avx2", "sse2" or "scalar"
+const char *json_jsmn_scan_impl(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JSON_JSMN_SCAN_H_ */
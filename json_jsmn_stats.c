@@ -0,0 +1,54 @@
+#include <string.h>
+#include "json_jsmn_stats.h"
+
+#define STATS_COUNT		(sizeof(json_jsmn_stats_t) / sizeof(uint64_t))
+
+#ifdef JSON_JSMN_STATS_ENABLED
+__thread json_jsmn_stats_t json_jsmn_stats_thread;
+#endif
+
+void json_jsmn_stats_get(json_jsmn_stats_t *stats)
+{
+#ifdef JSON_JSMN_STATS_ENABLED
+	*stats = json_jsmn_stats_thread;
+#else
+	memset(stats, 0, sizeof(*stats));
+#endif
+}
+
+void json_jsmn_stats_reset(void)
+{
+#ifdef JSON_JSMN_STATS_ENABLED
+	memset(&json_jsmn_stats_thread, 0, sizeof(json_jsmn_stats_thread));
+#endif
+}
+
+// the counters are all uint64_t, walked as an array
+void json_jsmn_stats_since(const json_jsmn_stats_t *mark, json_jsmn_stats_t *delta)
+{
+	json_jsmn_stats_t now;
+	const uint64_t *a, *b;
+	uint64_t *d;
+	unsigned int i;
+
+	json_jsmn_stats_get(&now);
+	a = (const uint64_t *)&now;
+	b = (const uint64_t *)mark;
+	d = (uint64_t *)delta;
+	for(i = 0; i < STATS_COUNT; i++)
+	{
+		d[i] = a[i] - b[i];
+	}
+}
+
+void json_jsmn_stats_add(json_jsmn_stats_t *total, const json_jsmn_stats_t *stats)
+{
+	const uint64_t *s = (const uint64_t *)stats;
+	uint64_t *t = (uint64_t *)total;
+	unsigned int i;
+
+	for(i = 0; i < STATS_COUNT; i++)
+	{
+		t[i] += s[i];
+	}
+}
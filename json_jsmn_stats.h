@@ -0,0 +1,98 @@
+#ifndef __JSON_JSMN_STATS_H_
+#define __JSON_JSMN_STATS_H_
+
+#include <stdint.h>
+#include "json_jsmn.h"
+
+#ifdef JSON_JSMN_STATS_ENABLED
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Hot path counters, built with JSON_JSMN_STATS_ENABLED only. Every thread
+ * accumulates into its own counters, nothing is shared or locked; the
+ * workers of a parallel call hand theirs to the calling thread when it
+ * returns. Other builds compile the counting out and report zeros. Timings
+ * are in TSC cycles on x86, in nanoseconds elsewhere.
+ */
+typedef struct
+{
+	uint64_t tokenize_calls;
+	uint64_t bytes;						// input consumed by the tokenizer
+	uint64_t tokens;					// tokens produced
+	uint64_t errors[4];					// tokenizer failures by -JSMN_ERROR_*: [1] NOMEM, [2] INVAL, [3] PART
+	uint64_t match_calls;				// json_jsmn_parse*() walks of a document
+	uint64_t keys;						// keys handed to a key matcher
+	uint64_t key_compares;				// string compares or hash probes spent on them
+	uint64_t matches;					// keys accepted
+	uint64_t tokens_skipped;			// value tokens stepped over for unwanted keys
+	uint64_t values;					// values stored or converted
+	uint64_t cycles_tokenize;
+	uint64_t cycles_match;				// walk and key matching, conversion excluded
+	uint64_t cycles_convert;
+}json_jsmn_stats_t;
+
+// counters of the calling thread since it started or its last reset
+void json_jsmn_stats_get(json_jsmn_stats_t *stats);
+
+void json_jsmn_stats_reset(void);
+
+/*
+ * Per call figures: take mark with json_jsmn_stats_get() before the call,
+ * delta receives what the call added on this thread.
+ */
+void json_jsmn_stats_since(const json_jsmn_stats_t *mark, json_jsmn_stats_t *delta);
+
+// add stats into total, e.g. to aggregate what each worker thread reports
+void json_jsmn_stats_add(json_jsmn_stats_t *total, const json_jsmn_stats_t *stats);
+
+#ifdef JSON_JSMN_STATS_ENABLED
+extern __thread json_jsmn_stats_t json_jsmn_stats_thread;
+
+static inline uint64_t json_jsmn_stats_clock(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+#endif
+}
+
+// declaration, keep it last in its block's declarations
+#define JSON_JSMN_STAT_CLOCK(var)			uint64_t var = json_jsmn_stats_clock()
+#define JSON_JSMN_STAT_ADD(field, n)		(json_jsmn_stats_thread.field += (n))
+#define JSON_JSMN_STAT_CYCLES(field, since)	(json_jsmn_stats_thread.field += json_jsmn_stats_clock() - (since))
+// charge the time since lap to field and restart lap, splits a loop into stages
+#define JSON_JSMN_STAT_LAP(field, lap)						\
+	do														\
+	{														\
+		uint64_t now = json_jsmn_stats_clock();				\
+		json_jsmn_stats_thread.field += now - (lap);		\
+		(lap) = now;										\
+	}while(0)
+#define JSON_JSMN_STAT_ERROR(rc)							\
+	((void)((rc) < 0 && (rc) >= JSMN_ERROR_PART ? json_jsmn_stats_thread.errors[-(rc)]++ : 0))
+#else
+#define JSON_JSMN_STAT_CLOCK(var)
+#define JSON_JSMN_STAT_ADD(field, n)		((void)0)
+#define JSON_JSMN_STAT_CYCLES(field, since)	((void)0)
+#define JSON_JSMN_STAT_LAP(field, lap)		((void)0)
+#define JSON_JSMN_STAT_ERROR(rc)			((void)0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JSON_JSMN_STATS_H_ */
@@ -0,0 +1,272 @@
+#include <stdint.h>
+#include <string.h>
+#include "json_jsmn_string.h"
+#include "json_jsmn_scan.h"
+
+// substituted for unpaired UTF-16 surrogates
+#define STRING_REPLACEMENT			0xfffd
+
+static int string_hex4(const char *p, const char *end, uint32_t *u)
+{
+	int i;
+	char c;
+
+	if(end - p < 4)
+	{
+		return -1;
+	}
+	for(*u = 0, i = 0; i < 4; i++)
+	{
+		c = p[i];
+		if(c >= '0' && c <= '9')
+		{
+			c -= '0';
+		}
+		else if((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+		{
+			c = (c | 0x20) - 'a' + 10;
+		}
+		else
+		{
+			return -1;
+		}
+		*u = (*u << 4) | (uint32_t)c;
+	}
+	return 0;
+}
+
+static int string_utf8(uint32_t u, char *buf)
+{
+	if(u < 0x80)
+	{
+		buf[0] = (char)u;
+		return 1;
+	}
+	if(u < 0x800)
+	{
+		buf[0] = (char)(0xc0 | (u >> 6));
+		buf[1] = (char)(0x80 | (u & 0x3f));
+		return 2;
+	}
+	if(u < 0x10000)
+	{
+		buf[0] = (char)(0xe0 | (u >> 12));
+		buf[1] = (char)(0x80 | ((u >> 6) & 0x3f));
+		buf[2] = (char)(0x80 | (u & 0x3f));
+		return 3;
+	}
+	buf[0] = (char)(0xf0 | (u >> 18));
+	buf[1] = (char)(0x80 | ((u >> 12) & 0x3f));
+	buf[2] = (char)(0x80 | ((u >> 6) & 0x3f));
+	buf[3] = (char)(0x80 | (u & 0x3f));
+	return 4;
+}
+
+/*
+ * Decode the escape sequence starting at the backslash s[*pos] into buf and
+ * move *pos past it. Returns the number of bytes in buf, -1 when malformed.
+ */
+static int string_escape(const char *s, size_t len, size_t *pos, char *buf)
+{
+	size_t p = *pos + 1;
+	uint32_t u, lo;
+
+	if(p >= len)
+	{
+		return -1;
+	}
+
+	switch(s[p])
+	{
+	case '\"':
+	case '/':
+	case '\\':
+		buf[0] = s[p];
+		break;
+	case 'b':
+		buf[0] = '\b';
+		break;
+	case 'f':
+		buf[0] = '\f';
+		break;
+	case 'r':
+		buf[0] = '\r';
+		break;
+	case 'n':
+		buf[0] = '\n';
+		break;
+	case 't':
+		buf[0] = '\t';
+		break;
+	case 'u':
+		if(string_hex4(s + p + 1, s + len, &u))
+		{
+			return -1;
+		}
+		p += 5;
+		if(u >= 0xd800 && u <= 0xdbff)
+		{
+			if(
+				p + 6 <= len && s[p] == '\\' && s[p + 1] == 'u' &&
+				0 == string_hex4(s + p + 2, s + len, &lo) &&
+				lo >= 0xdc00 && lo <= 0xdfff
+			)
+			{
+				u = 0x10000 + ((u - 0xd800) << 10) + (lo - 0xdc00);
+				p += 6;
+			}
+			else
+			{
+				u = STRING_REPLACEMENT;
+			}
+		}
+		else if(u >= 0xdc00 && u <= 0xdfff)
+		{
+			u = STRING_REPLACEMENT;
+		}
+		*pos = p;
+		return string_utf8(u, buf);
+	default:
+		return -1;
+	}
+	*pos = p + 1;
+	return 1;
+}
+
+/*
+ * Number of bytes of s[0..len) that fit in room without cutting a UTF-8
+ * sequence in two.
+ */
+static size_t string_fit(const char *s, size_t len, size_t room)
+{
+	if(len <= room)
+	{
+		return len;
+	}
+	while(room && (s[room] & 0xc0) == 0x80)
+	{
+		room--;
+	}
+	return room;
+}
+
+/*
+ * Decode s[0..len) into out, writing at most cap bytes (*written of them).
+ * The write position never passes the read position, so out may be s.
+ * Returns the full decoded length.
+ */
+static int string_unescape
+	(
+		const char *s, size_t len,
+		char *out, size_t cap,
+		size_t *written
+	)
+{
+	size_t pos, stop, run, k;
+	size_t n = 0, w = 0;
+	int full = 0;
+	int blen;
+	char buf[4];
+
+	for(pos = 0; pos < len; )
+	{
+		stop = json_jsmn_scan_string_stop(s, pos, len);
+		if(stop < len && s[stop] != '\\')
+		{
+			// quote or NUL, never seen in a token body: taken as is
+			stop++;
+		}
+
+		run = stop - pos;
+		if(run && !full)
+		{
+			k = string_fit(s + pos, run, cap - w);
+			full = k < run;
+			if(out + w != s + pos)
+			{
+				memmove(out + w, s + pos, k);
+			}
+			w += k;
+		}
+		n += run;
+		pos = stop;
+
+		if(pos < len && s[pos] == '\\')
+		{
+			blen = string_escape(s, len, &pos, buf);
+			if(blen < 0)
+			{
+				*written = w;
+				return JSMN_ERROR_INVAL;
+			}
+			if(!full && cap - w >= (size_t)blen)
+			{
+				memcpy(out + w, buf, blen);
+				w += blen;
+			}
+			else
+			{
+				full = 1;
+			}
+			n += blen;
+		}
+	}
+
+	*written = w;
+	return (int)n;
+}
+
+int json_jsmn_token_string
+	(
+		const char *js, const json_jsmn_token_t *t,
+		json_jsmn_string_t *str
+	)
+{
+	if(t->type != JSMN_STRING)
+	{
+		return JSMN_ERROR_INVAL;
+	}
+
+	str->ptr = js + t->start;
+	str->len = t->end - t->start;
+	str->needs_unescape = json_jsmn_scan_string_stop(str->ptr, 0, str->len) < str->len;
+	return 0;
+}
+
+int json_jsmn_unescape(const char *s, size_t len, char *out, size_t size)
+{
+	size_t w;
+	int n;
+
+	n = string_unescape(s, len, out, size ? size - 1 : 0, &w);
+	if(size)
+	{
+		out[w] = '\0';
+	}
+	return n;
+}
+
+int json_jsmn_unescape_inplace(char *s, size_t len)
+{
+	size_t w;
+
+	return string_unescape(s, len, s, len, &w);
+}
+
+int json_jsmn_string_copy(const json_jsmn_string_t *str, char *out, size_t size)
+{
+	size_t k;
+
+	if(str->needs_unescape)
+	{
+		return json_jsmn_unescape(str->ptr, str->len, out, size);
+	}
+
+	if(size)
+	{
+		k = string_fit(str->ptr, str->len, size - 1);
+		memcpy(out, str->ptr, k);
+		out[k] = '\0';
+	}
+	return (int)str->len;
+}
@@ -0,0 +1,62 @@
+#ifndef __JSON_JSMN_STRING_H_
+#define __JSON_JSMN_STRING_H_
+
+#include <stddef.h>
+#include "json_jsmn.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * View of a string token inside js, no copy made. ptr/len cover the body
+ * between the quotes; needs_unescape is set when the body holds at least one
+ * escape sequence and must go through json_jsmn_unescape() before use.
+ */
+typedef struct
+{
+	const char *ptr;
+	size_t len;
+	int needs_unescape;
+} json_jsmn_string_t;
+
+/*
+ * Fill str from the string token t. Returns 0, or JSMN_ERROR_INVAL when t is
+ * not a string.
+ */
+int json_jsmn_token_string
+	(
+		const char *js, const json_jsmn_token_t *t,
+		json_jsmn_string_t *str
+	);
+
+/*
+ * Decode the escapes of s[0..len) into out (size bytes) as UTF-8, surrogate
+ * pairs combined and unpaired surrogates replaced by U+FFFD. Escape free runs
+ * are located with the tokenizer's SSE2/AVX2 string scanner and copied in one
+ * go. Only whole characters are written and out is always NUL terminated when
+ * size is not 0, like strlcpy(). out may be s itself: the decoded text is
+ * never longer than its source.
+ * Returns the full decoded length (>= size means truncated) or
+ * JSMN_ERROR_INVAL on a malformed escape.
+ */
+int json_jsmn_unescape(const char *s, size_t len, char *out, size_t size);
+
+/*
+ * Decode s[0..len) over itself, without NUL terminator. Returns the decoded
+ * length or JSMN_ERROR_INVAL.
+ */
+int json_jsmn_unescape_inplace(char *s, size_t len);
+
+/*
+ * Copy the string view into out (size bytes), NUL terminated: a plain copy
+ * when there is nothing to unescape, json_jsmn_unescape() otherwise. Same
+ * return values as json_jsmn_unescape().
+ */
+int json_jsmn_string_copy(const json_jsmn_string_t *str, char *out, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JSON_JSMN_STRING_H_ */
@@ -0,0 +1,206 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "json_jsmn_struct.h"
+#include "json_jsmn_number.h"
+#include "json_jsmn_string.h"
+
+struct struct_walk
+{
+	const json_jsmn_t *jjs;
+	int depth;
+};
+
+static int struct_decode_object
+	(
+		struct struct_walk *w,
+		const json_jsmn_struct_t *st,
+		const json_jsmn_token_t *t,
+		char *base
+	);
+
+// decode the single value t of field into dst, returns the values stored
+static int struct_decode_value
+	(
+		struct struct_walk *w,
+		const json_jsmn_field_t *field,
+		const json_jsmn_token_t *t,
+		char *dst
+	)
+{
+	json_jsmn_string_t str;
+	int n;
+
+	if(t->type != field->type)
+	{
+		return 0;
+	}
+
+	switch(t->type)
+	{
+	case JSMN_STRING:
+		json_jsmn_token_string(w->jjs->js, t, &str);
+		return 0 <= json_jsmn_string_copy(&str, dst, field->size);
+
+	case JSMN_PRIMITIVE:
+		return 0 <= json_jsmn_number_decode
+				(
+					w->jjs->js + t->start, t->end - t->start,
+					field->vtype,
+					dst, field->size
+				);
+
+	case JSMN_OBJECT:
+		if(!field->nested || w->depth >= JSON_JSMN_STRUCT_DEPTH)
+		{
+			return 0;
+		}
+		w->depth++;
+		n = struct_decode_object(w, field->nested, t, dst);
+		w->depth--;
+		return n;
+
+	default:
+		return 0;
+	}
+}
+
+/*
+ * Elements keep their position in the JSON array: one that does not decode
+ * leaves its slot untouched but is still counted.
+ */
+static int struct_decode_array
+	(
+		struct struct_walk *w,
+		const json_jsmn_field_t *field,
+		const json_jsmn_token_t *t,
+		char *base
+	)
+{
+	const json_jsmn_token_t *k, *end;
+	int count, n;
+
+	if(t->type != JSMN_ARRAY)
+	{
+		return 0;
+	}
+
+	for(
+			k = t + 1, end = t + json_jsmn_span(w->jjs, t), count = 0, n = 0;
+			k < end && count < field->capacity;
+			k += json_jsmn_span(w->jjs, k), count++
+		)
+	{
+		n += struct_decode_value(w, field, k, base + field->offset + (size_t)count * field->size);
+	}
+
+	if(field->count_offset != JSON_JSMN_FIELD_NO_COUNT)
+	{
+		*(int *)(base + field->count_offset) = count;
+	}
+	return n;
+}
+
+static int struct_decode_object
+	(
+		struct struct_walk *w,
+		const json_jsmn_struct_t *st,
+		const json_jsmn_token_t *t,
+		char *base
+	)
+{
+	const json_jsmn_token_t *k, *end;
+	const json_jsmn_field_t *field;
+	int index, n;
+
+	// a key spans its value too, k always lands on the next key
+	for(
+			k = t + 1, end = t + json_jsmn_span(w->jjs, t), n = 0;
+			k + 1 < end;
+			k += json_jsmn_span(w->jjs, k)
+		)
+	{
+		index = json_jsmn_keyset_find(&st->keyset, w->jjs->js, k);
+		if(index < 0)
+		{
+			continue;
+		}
+
+		field = &st->fields[index];
+		if(field->capacity > 0)
+		{
+			n += struct_decode_array(w, field, k + 1, base);
+		}
+		else
+		{
+			n += struct_decode_value(w, field, k + 1, base + field->offset);
+		}
+	}
+	return n;
+}
+
+int json_jsmn_struct_compile
+	(
+		json_jsmn_struct_t *st,
+		json_jsmn_keyset_slot_t *slots, unsigned int slot_count
+	)
+{
+	const char *none[] = { NULL };
+	unsigned int used;
+	int i, rc;
+
+	if(st->keyset.slots)
+	{
+		// nested descriptor shared by several fields (or itself): built already
+		return 0;
+	}
+
+	used = 2 * st->field_count + 1;
+	if(used > slot_count)
+	{
+		return JSMN_ERROR_NOMEM;
+	}
+
+	json_jsmn_keyset_init(&st->keyset, slots, used, none);
+	for(i = 0; i < st->field_count; i++)
+	{
+		rc = json_jsmn_keyset_add(&st->keyset, st->fields[i].key, i);
+		if(rc)
+		{
+			return rc;
+		}
+	}
+
+	for(i = 0; i < st->field_count; i++)
+	{
+		if(st->fields[i].nested)
+		{
+			rc = json_jsmn_struct_compile(st->fields[i].nested, slots + used, slot_count - used);
+			if(rc < 0)
+			{
+				return rc;
+			}
+			used += rc;
+		}
+	}
+	return used;
+}
+
+int json_jsmn_struct_decode
+	(
+		const json_jsmn_struct_t *st,
+		const json_jsmn_t *jjs,
+		void *base
+	)
+{
+	struct struct_walk w;
+
+	if(!jjs->token_count || jjs->tokens[0].type != JSMN_OBJECT)
+	{
+		return JSMN_ERROR_INVAL;
+	}
+
+	w.jjs = jjs;
+	w.depth = 0;
+	return struct_decode_object(&w, st, jjs->tokens, (char *)base);
+}
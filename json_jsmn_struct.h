@@ -0,0 +1,99 @@
+#ifndef __JSON_JSMN_STRUCT_H_
+#define __JSON_JSMN_STRUCT_H_
+
+#include <stddef.h>
+#include "json_jsmn.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// nesting limit of json_jsmn_struct_decode(), deeper members are skipped
+#ifndef JSON_JSMN_STRUCT_DEPTH
+#define JSON_JSMN_STRUCT_DEPTH		16
+#endif
+
+// count_offset of a field that is not an array or keeps no element count
+#define JSON_JSMN_FIELD_NO_COUNT	((size_t)-1)
+
+typedef struct json_jsmn_struct json_jsmn_struct_t;
+
+/*
+ * One member of a bound C struct. type is the JSON type of the member or,
+ * for arrays (capacity > 0), of each element:
+ * - JSMN_STRING: copied with escapes decoded into a char buffer of size bytes
+ * - JSMN_PRIMITIVE: decoded as vtype into size bytes (see json_jsmn_number.h)
+ * - JSMN_OBJECT: decoded through the nested descriptor
+ * Array elements are stored size bytes apart, at most capacity of them; the
+ * number stored is written to the int at count_offset.
+ */
+typedef struct
+{
+	const char *key;
+	size_t offset;
+	jsmntype_t type;
+	json_jsmn_vtype_t vtype;
+	int size;
+	json_jsmn_struct_t *nested;
+	int capacity;
+	size_t count_offset;
+}json_jsmn_field_t;
+
+struct json_jsmn_struct
+{
+	const json_jsmn_field_t *fields;
+	int field_count;
+	json_jsmn_keyset_t keyset;		// filled by json_jsmn_struct_compile()
+};
+
+#define JSON_JSMN_MEMBER_SIZE(st, member)	sizeof(((st *)0)->member)
+
+// string or primitive member
+#define JSON_JSMN_FIELD(st, member, key, type, vtype)	\
+	{ key, offsetof(st, member), type, vtype, JSON_JSMN_MEMBER_SIZE(st, member), NULL, 0, JSON_JSMN_FIELD_NO_COUNT }
+
+// struct member described by nested
+#define JSON_JSMN_FIELD_OBJECT(st, member, key, nested)	\
+	{ key, offsetof(st, member), JSMN_OBJECT, JSON_JSMN_VTYPE_AUTO, JSON_JSMN_MEMBER_SIZE(st, member), nested, 0, JSON_JSMN_FIELD_NO_COUNT }
+
+// fixed-size array member, count (an int member) receives the element count
+#define JSON_JSMN_FIELD_ARRAY(st, member, key, type, vtype, nested, count)	\
+	{																		\
+		key, offsetof(st, member), type, vtype,								\
+		JSON_JSMN_MEMBER_SIZE(st, member[0]), nested,						\
+		JSON_JSMN_MEMBER_SIZE(st, member) / JSON_JSMN_MEMBER_SIZE(st, member[0]),	\
+		offsetof(st, count)													\
+	}
+
+/*
+ * Build the key matcher of st and, recursively, of its nested descriptors.
+ * Done once: descriptors are then shared by every message and thread.
+ * slots is caller storage, 2 * field_count + 1 slots are used per
+ * descriptor. Returns the number of slots used or JSMN_ERROR_NOMEM.
+ */
+int json_jsmn_struct_compile
+	(
+		json_jsmn_struct_t *st,
+		json_jsmn_keyset_slot_t *slots, unsigned int slot_count
+	);
+
+/*
+ * Decode the root object of jjs straight into the struct at base in a
+ * single walk of the tokens: members without a field are skipped by their
+ * span, fields whose value has another type or does not decode are left
+ * untouched. Returns the number of values stored, members of nested objects
+ * and array elements included, or JSMN_ERROR_INVAL when the root is not an
+ * object.
+ */
+int json_jsmn_struct_decode
+	(
+		const json_jsmn_struct_t *st,
+		const json_jsmn_t *jjs,
+		void *base
+	);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JSON_JSMN_STRUCT_H_ */
@@ -0,0 +1,290 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "json_jsmn_thread.h"
+#include "json_jsmn_stats.h"
+
+#ifdef JSON_JSMN_DEBUG_ENABLED
+#ifndef debugPrintf
+#define debugPrintf    				printf
+#define debugPrintln(fmt,args...)   debugPrintf(fmt "%s", ## args, "\r\n")
+#else
+#define debugPrintln(fmt,args...)   debugPrintf(fmt "%s", ## args, "\r\n")
+#endif
+#else
+#define debugPrintf(...)
+#define debugPrintln(...)
+#endif
+
+#ifndef JSON_JSMN_THREADS_MAX
+#define JSON_JSMN_THREADS_MAX		64
+#endif
+
+int json_jsmn_thread_count(int threads)
+{
+#ifdef JSON_JSMN_THREADS_ENABLED
+	if(threads < 1)
+	{
+		return 1;
+	}
+	return threads > JSON_JSMN_THREADS_MAX ? JSON_JSMN_THREADS_MAX : threads;
+#else
+	return 1;
+#endif
+}
+
+#ifdef JSON_JSMN_THREADS_ENABLED
+/*
+ * Pool thread id waits for the next job, runs it when id is below the
+ * job's thread count and reports back. One json_jsmn_thread_run() owns the
+ * pool at a time; threads above limit exit.
+ */
+static struct
+{
+	pthread_mutex_t lock;
+	pthread_cond_t start;							// new job or lower limit
+	pthread_cond_t done;							// job finished or pool released
+	pthread_t thread[JSON_JSMN_THREADS_MAX];
+	unsigned long seen[JSON_JSMN_THREADS_MAX];		// last job of each thread
+	unsigned long job;
+	int started;									// pool threads, ids 1 .. started
+	int limit;
+	int busy;
+	json_jsmn_thread_worker_t worker;
+	void *ctx;
+	int threads;									// ids of the job
+	int running;									// pool threads still in it
+#ifdef JSON_JSMN_STATS_ENABLED
+	json_jsmn_stats_t stats;						// counted by the pool threads for the job
+#endif
+}json_jsmn_pool =
+{
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.start = PTHREAD_COND_INITIALIZER,
+	.done = PTHREAD_COND_INITIALIZER
+};
+
+static void *json_jsmn_thread_main(void *args)
+{
+	int id = (int)(intptr_t)args;
+	json_jsmn_thread_worker_t worker;
+	void *ctx;
+#ifdef JSON_JSMN_STATS_ENABLED
+	json_jsmn_stats_t mark, delta;
+#endif
+
+	pthread_mutex_lock(&json_jsmn_pool.lock);
+	for(;;)
+	{
+		while(json_jsmn_pool.seen[id] == json_jsmn_pool.job && id <= json_jsmn_pool.limit)
+		{
+			pthread_cond_wait(&json_jsmn_pool.start, &json_jsmn_pool.lock);
+		}
+		if(id > json_jsmn_pool.limit)
+		{
+			break;
+		}
+
+		json_jsmn_pool.seen[id] = json_jsmn_pool.job;
+		if(id < json_jsmn_pool.threads)
+		{
+			worker = json_jsmn_pool.worker;
+			ctx = json_jsmn_pool.ctx;
+			pthread_mutex_unlock(&json_jsmn_pool.lock);
+#ifdef JSON_JSMN_STATS_ENABLED
+			json_jsmn_stats_get(&mark);
+#endif
+			worker(ctx, id);
+#ifdef JSON_JSMN_STATS_ENABLED
+			json_jsmn_stats_since(&mark, &delta);
+#endif
+			pthread_mutex_lock(&json_jsmn_pool.lock);
+#ifdef JSON_JSMN_STATS_ENABLED
+			// handed to the caller, its thread counts the whole call
+			json_jsmn_stats_add(&json_jsmn_pool.stats, &delta);
+#endif
+			if(!--json_jsmn_pool.running)
+			{
+				pthread_cond_broadcast(&json_jsmn_pool.done);
+			}
+		}
+	}
+	pthread_mutex_unlock(&json_jsmn_pool.lock);
+	return NULL;
+}
+
+// with the lock held and the pool owned: threads workers, caller included
+static void json_jsmn_pool_resize(int threads)
+{
+	int i;
+
+	json_jsmn_pool.limit = threads - 1;
+	if(json_jsmn_pool.started > json_jsmn_pool.limit)
+	{
+		pthread_cond_broadcast(&json_jsmn_pool.start);
+		pthread_mutex_unlock(&json_jsmn_pool.lock);
+		for(i = json_jsmn_pool.limit + 1; i <= json_jsmn_pool.started; i++)
+		{
+			pthread_join(json_jsmn_pool.thread[i], NULL);
+		}
+		pthread_mutex_lock(&json_jsmn_pool.lock);
+		json_jsmn_pool.started = json_jsmn_pool.limit;
+	}
+
+	for(i = json_jsmn_pool.started + 1; i <= json_jsmn_pool.limit; i++)
+	{
+		json_jsmn_pool.seen[i] = json_jsmn_pool.job;
+		if(pthread_create(&json_jsmn_pool.thread[i], NULL, json_jsmn_thread_main, (void *)(intptr_t)i))
+		{
+			debugPrintln("json_jsmn_thread_pool: pthread_create failed after %d threads", i);
+			break;
+		}
+		json_jsmn_pool.started = i;
+	}
+	json_jsmn_pool.limit = json_jsmn_pool.started;
+}
+
+// the pool is only resized or handed a job by its owner
+static void json_jsmn_pool_acquire(void)
+{
+	while(json_jsmn_pool.busy)
+	{
+		pthread_cond_wait(&json_jsmn_pool.done, &json_jsmn_pool.lock);
+	}
+	json_jsmn_pool.busy = 1;
+}
+
+static void json_jsmn_pool_release(void)
+{
+	json_jsmn_pool.busy = 0;
+	pthread_cond_broadcast(&json_jsmn_pool.done);
+}
+#endif
+
+int json_jsmn_thread_pool(int threads)
+{
+#ifdef JSON_JSMN_THREADS_ENABLED
+	pthread_mutex_lock(&json_jsmn_pool.lock);
+	json_jsmn_pool_acquire();
+	json_jsmn_pool_resize(json_jsmn_thread_count(threads));
+	threads = json_jsmn_pool.started + 1;
+	json_jsmn_pool_release();
+	pthread_mutex_unlock(&json_jsmn_pool.lock);
+	return threads;
+#else
+	(void)threads;
+	return 1;
+#endif
+}
+
+int json_jsmn_thread_run
+	(
+		int threads,
+		json_jsmn_thread_worker_t worker, void *ctx
+	)
+{
+#ifdef JSON_JSMN_THREADS_ENABLED
+	int i, pooled;
+
+	threads = json_jsmn_thread_count(threads);
+	pthread_mutex_lock(&json_jsmn_pool.lock);
+	if(threads < 2 || json_jsmn_pool.busy)
+	{
+		// nested or concurrent call: no thread to spare
+		pthread_mutex_unlock(&json_jsmn_pool.lock);
+		for(i = 0; i < threads; i++)
+		{
+			worker(ctx, i);
+		}
+		return 1;
+	}
+
+	json_jsmn_pool.busy = 1;
+	if(json_jsmn_pool.started < threads - 1)
+	{
+		json_jsmn_pool_resize(threads);
+	}
+	pooled = json_jsmn_pool.started + 1 < threads ? json_jsmn_pool.started + 1 : threads;
+	json_jsmn_pool.worker = worker;
+	json_jsmn_pool.ctx = ctx;
+	json_jsmn_pool.threads = pooled;
+	json_jsmn_pool.running = pooled - 1;
+#ifdef JSON_JSMN_STATS_ENABLED
+	memset(&json_jsmn_pool.stats, 0, sizeof(json_jsmn_pool.stats));
+#endif
+	json_jsmn_pool.job++;
+	pthread_cond_broadcast(&json_jsmn_pool.start);
+	pthread_mutex_unlock(&json_jsmn_pool.lock);
+
+	worker(ctx, 0);
+
+	pthread_mutex_lock(&json_jsmn_pool.lock);
+	while(json_jsmn_pool.running)
+	{
+		pthread_cond_wait(&json_jsmn_pool.done, &json_jsmn_pool.lock);
+	}
+#ifdef JSON_JSMN_STATS_ENABLED
+	json_jsmn_stats_add(&json_jsmn_stats_thread, &json_jsmn_pool.stats);
+#endif
+	json_jsmn_pool_release();
+	pthread_mutex_unlock(&json_jsmn_pool.lock);
+
+	// ids the pool has no thread for
+	for(i = pooled; i < threads; i++)
+	{
+		worker(ctx, i);
+	}
+	return pooled;
+#else
+	(void)threads;
+	worker(ctx, 0);
+	return 1;
+#endif
+}
+
+void json_jsmn_sequence_init(json_jsmn_sequence_t *seq)
+{
+	seq->next = 0;
+#ifdef JSON_JSMN_THREADS_ENABLED
+	pthread_mutex_init(&seq->lock, NULL);
+	pthread_cond_init(&seq->cond, NULL);
+#endif
+}
+
+void json_jsmn_sequence_wait(json_jsmn_sequence_t *seq, unsigned long n)
+{
+#ifdef JSON_JSMN_THREADS_ENABLED
+	pthread_mutex_lock(&seq->lock);
+	while(seq->next != n)
+	{
+		pthread_cond_wait(&seq->cond, &seq->lock);
+	}
+	pthread_mutex_unlock(&seq->lock);
+#else
+	(void)seq;
+	(void)n;
+#endif
+}
+
+void json_jsmn_sequence_next(json_jsmn_sequence_t *seq)
+{
+#ifdef JSON_JSMN_THREADS_ENABLED
+	pthread_mutex_lock(&seq->lock);
+	seq->next++;
+	pthread_cond_broadcast(&seq->cond);
+	pthread_mutex_unlock(&seq->lock);
+#else
+	seq->next++;
+#endif
+}
+
+void json_jsmn_sequence_destroy(json_jsmn_sequence_t *seq)
+{
+#ifdef JSON_JSMN_THREADS_ENABLED
+	pthread_cond_destroy(&seq->cond);
+	pthread_mutex_destroy(&seq->lock);
+#else
+	(void)seq;
+#endif
+}
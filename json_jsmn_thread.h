@@ -0,0 +1,74 @@
+#ifndef __JSON_JSMN_THREAD_H_
+#define __JSON_JSMN_THREAD_H_
+
+#ifdef JSON_JSMN_THREADS_ENABLED
+#include <pthread.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Minimal threading layer for the parallel entry points. Built with
+ * JSON_JSMN_THREADS_ENABLED it runs workers on a pool of pthreads started
+ * once and kept for later calls, otherwise every "parallel" call degrades to
+ * running a single worker on the caller thread.
+ */
+typedef void (*json_jsmn_thread_worker_t)(void *ctx, int id);
+
+typedef struct
+{
+	unsigned long next;
+#ifdef JSON_JSMN_THREADS_ENABLED
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+#endif
+}json_jsmn_sequence_t;
+
+/*
+ * Run worker(ctx, id) for id in [0, threads), id 0 on the caller thread and
+ * the others on the pool, which grows to threads - 1 threads on first use.
+ * While the pool serves another call (or from inside a worker) every id runs
+ * on the caller thread in turn. What the pool threads add to their
+ * json_jsmn_stats.h counters is added to the caller's before returning.
+ * Returns the number of threads used.
+ */
+int json_jsmn_thread_run
+	(
+		int threads,
+		json_jsmn_thread_worker_t worker, void *ctx
+	);
+
+/*
+ * Start the pool threads of threads workers ahead of the first call, or
+ * stop the ones above it, e.g. 1 to stop them all before fork() or exit.
+ * Waits for a running call to finish, so never from inside a worker.
+ * Returns the number of workers json_jsmn_thread_run() can now use without
+ * starting threads.
+ */
+int json_jsmn_thread_pool(int threads);
+
+// number of workers json_jsmn_thread_run() really starts for threads
+int json_jsmn_thread_count(int threads);
+
+// shared work counter: returns the previous value
+static inline unsigned long json_jsmn_thread_fetch_add(unsigned long *counter, unsigned long n)
+{
+	return __atomic_fetch_add(counter, n, __ATOMIC_RELAXED);
+}
+
+/*
+ * Sequencer used to hand results over in input order: the owner of item n
+ * waits until every item before it has been delivered.
+ */
+void json_jsmn_sequence_init(json_jsmn_sequence_t *seq);
+void json_jsmn_sequence_wait(json_jsmn_sequence_t *seq, unsigned long n);
+void json_jsmn_sequence_next(json_jsmn_sequence_t *seq);
+void json_jsmn_sequence_destroy(json_jsmn_sequence_t *seq);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JSON_JSMN_THREAD_H_ */
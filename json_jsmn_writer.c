@@ -0,0 +1,720 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "json_jsmn_writer.h"
+#include "json_jsmn_number.h"
+#include "json_jsmn_scan.h"
+
+#define WRITER_GROW_MIN				256
+
+// doubles below 2^53 are integers exactly, so are their decimal mantissas
+#define WRITER_EXACT				9007199254740992.0
+
+static const char writer_digits[] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+static const double writer_pow10[] =
+{
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8
+};
+
+static void writer_fail(json_jsmn_writer_t *w, int error)
+{
+	if(!w->error)
+	{
+		w->error = error;
+	}
+	// nothing fits any more
+	w->size = w->len;
+}
+
+// grow the buffer of a growable writer to hold n more bytes and the NUL
+static int writer_reserve(json_jsmn_writer_t *w, size_t n)
+{
+	size_t size;
+	char *buf;
+
+	size = w->buf ? w->size + 1 : WRITER_GROW_MIN;
+	while(size - 1 - w->len < n)
+	{
+		size *= 2;
+	}
+	buf = realloc(w->buf, size);
+	if(!buf)
+	{
+		writer_fail(w, JSMN_ERROR_NOMEM);
+		return JSMN_ERROR_NOMEM;
+	}
+	w->buf = buf;
+	w->size = size - 1;
+	return 0;
+}
+
+static void writer_put_slow(json_jsmn_writer_t *w, const char *data, size_t n)
+{
+	size_t room;
+	int rc;
+
+	if(w->error)
+	{
+		return;
+	}
+
+	if(w->grow)
+	{
+		if(!writer_reserve(w, n))
+		{
+			memcpy(w->buf + w->len, data, n);
+			w->len += n;
+		}
+		return;
+	}
+
+	room = w->size - w->len;
+	if(!w->flush)
+	{
+		memcpy(w->buf + w->len, data, room);
+		w->len += room;
+		writer_fail(w, JSMN_ERROR_NOMEM);
+		return;
+	}
+
+	while(n > room)
+	{
+		memcpy(w->buf + w->len, data, room);
+		w->len += room;
+		data += room;
+		n -= room;
+		rc = w->flush(w->flush_ctx, w->buf, w->len);
+		if(rc)
+		{
+			writer_fail(w, rc < 0 ? rc : JSMN_ERROR_NOMEM);
+			return;
+		}
+		w->len = 0;
+		room = w->size;
+	}
+	memcpy(w->buf + w->len, data, n);
+	w->len += n;
+}
+
+static inline void writer_put(json_jsmn_writer_t *w, const char *data, size_t n)
+{
+	w->total += n;
+	if(!n)
+	{
+		return;
+	}
+	if(w->size - w->len >= n)
+	{
+		memcpy(w->buf + w->len, data, n);
+		w->len += n;
+		return;
+	}
+	writer_put_slow(w, data, n);
+}
+
+static inline void writer_putc(json_jsmn_writer_t *w, char c)
+{
+	writer_put(w, &c, 1);
+}
+
+// comma before every member or element but the first, nothing after a key
+static void writer_value(json_jsmn_writer_t *w)
+{
+	if(w->after_key)
+	{
+		w->after_key = 0;
+	}
+	else if(w->members & (1u << w->depth))
+	{
+		writer_putc(w, ',');
+	}
+	else
+	{
+		w->members |= 1u << w->depth;
+	}
+}
+
+static void writer_begin(json_jsmn_writer_t *w, char c)
+{
+	writer_value(w);
+	if(w->depth + 1 >= JSON_JSMN_WRITER_DEPTH)
+	{
+		writer_fail(w, JSMN_ERROR_INVAL);
+		return;
+	}
+	writer_putc(w, c);
+	w->depth++;
+	w->members &= ~(1u << w->depth);
+}
+
+static void writer_end(json_jsmn_writer_t *w, char c)
+{
+	if(!w->depth || w->after_key)
+	{
+		// nothing open, or a key left without its value
+		writer_fail(w, JSMN_ERROR_INVAL);
+		return;
+	}
+	w->depth--;
+	writer_putc(w, c);
+}
+
+static void writer_string(json_jsmn_writer_t *w, const char *s, size_t len)
+{
+	static const char hex[] = "0123456789abcdef";
+	size_t pos, stop;
+	char esc[6];
+	unsigned char c;
+
+	writer_putc(w, '\"');
+	for(pos = 0; pos < len; pos = stop + 1)
+	{
+		stop = json_jsmn_scan_escape_stop(s, pos, len);
+		if(stop > pos)
+		{
+			writer_put(w, s + pos, stop - pos);
+		}
+		if(stop == len)
+		{
+			break;
+		}
+
+		c = s[stop];
+		esc[0] = '\\';
+		switch(c)
+		{
+		case '\"':
+		case '\\':
+			esc[1] = c;
+			break;
+		case '\b':
+			esc[1] = 'b';
+			break;
+		case '\f':
+			esc[1] = 'f';
+			break;
+		case '\n':
+			esc[1] = 'n';
+			break;
+		case '\r':
+			esc[1] = 'r';
+			break;
+		case '\t':
+			esc[1] = 't';
+			break;
+		default:
+			esc[1] = 'u';
+			esc[2] = '0';
+			esc[3] = '0';
+			esc[4] = hex[c >> 4];
+			esc[5] = hex[c & 0xf];
+			writer_put(w, esc, 6);
+			continue;
+		}
+		writer_put(w, esc, 2);
+	}
+	writer_putc(w, '\"');
+}
+
+// digits of v ending at end, two at a time; returns the count
+static int writer_format_uint(char *end, uint64_t v)
+{
+	char *p = end;
+
+	while(v >= 100)
+	{
+		p -= 2;
+		memcpy(p, writer_digits + (v % 100) * 2, 2);
+		v /= 100;
+	}
+	if(v >= 10)
+	{
+		p -= 2;
+		memcpy(p, writer_digits + v * 2, 2);
+	}
+	else
+	{
+		*--p = '0' + (char)v;
+	}
+	return end - p;
+}
+
+static void writer_uint(json_jsmn_writer_t *w, uint64_t v, int negative)
+{
+	char buf[24];
+	int n;
+
+	n = writer_format_uint(buf + sizeof(buf), v);
+	if(negative)
+	{
+		buf[sizeof(buf) - ++n] = '-';
+	}
+	writer_put(w, buf + sizeof(buf) - n, n);
+}
+
+/*
+ * m / 10^k with k decimals into out, when that decimal reads back as v
+ * (through a correctly rounding decoder: m and 10^k are exact, so is the
+ * rounding of their quotient). Returns the length or 0.
+ */
+static int writer_format_decimal(char *out, double v, int negative, int float_only)
+{
+	char digits[24];
+	double a = negative ? -v : v;
+	double s;
+	uint64_t m;
+	int k, n, len;
+
+	if(a >= WRITER_EXACT)
+	{
+		return 0;
+	}
+	for(k = 0; k < (int)(sizeof(writer_pow10) / sizeof(writer_pow10[0])); k++)
+	{
+		s = a * writer_pow10[k];
+		if(s >= WRITER_EXACT)
+		{
+			return 0;
+		}
+		m = (uint64_t)(s + 0.5);
+		if(float_only ? (float)((double)m / writer_pow10[k]) == (float)a : (double)m / writer_pow10[k] == a)
+		{
+			break;
+		}
+	}
+	if(k == (int)(sizeof(writer_pow10) / sizeof(writer_pow10[0])))
+	{
+		return 0;
+	}
+
+	n = writer_format_uint(digits + sizeof(digits), m);
+	len = 0;
+	if(negative)
+	{
+		out[len++] = '-';
+	}
+	if(n <= k)
+	{
+		// 0.00ddd
+		out[len++] = '0';
+		out[len++] = '.';
+		memset(out + len, '0', k - n);
+		len += k - n;
+		memcpy(out + len, digits + sizeof(digits) - n, n);
+		return len + n;
+	}
+	memcpy(out + len, digits + sizeof(digits) - n, n - k);
+	len += n - k;
+	if(k)
+	{
+		out[len++] = '.';
+		memcpy(out + len, digits + sizeof(digits) - k, k);
+		len += k;
+	}
+	return len;
+}
+
+// shortest %g that reads back as v, the decimal separator forced to '.'
+static int writer_format_printf(char *out, size_t size, double v, int first, int last, int is_float)
+{
+	double d;
+	float f;
+	int n, i, prec;
+
+	for(prec = first; ; prec++)
+	{
+		n = snprintf(out, size, "%.*g", prec, v);
+		for(i = 0; i < n; i++)
+		{
+			if(out[i] != '-' && out[i] != '+' && out[i] != 'e' && (out[i] < '0' || out[i] > '9'))
+			{
+				out[i] = '.';
+			}
+		}
+		if(prec == last)
+		{
+			return n;
+		}
+		if(is_float ? !json_jsmn_number_float(out, n, &f) && f == (float)v : !json_jsmn_number_double(out, n, &d) && d == v)
+		{
+			return n;
+		}
+	}
+}
+
+static void writer_double(json_jsmn_writer_t *w, double v, int is_float)
+{
+	char buf[40];
+	int n;
+
+	if(isnan(v) || isinf(v))
+	{
+		writer_put(w, "null", 4);
+		return;
+	}
+
+	n = writer_format_decimal(buf, v, signbit(v) != 0, is_float);
+	if(!n)
+	{
+		n = is_float ?
+			writer_format_printf(buf, sizeof(buf), v, 6, 9, 1) :
+			writer_format_printf(buf, sizeof(buf), v, 15, 17, 0);
+	}
+	writer_put(w, buf, n);
+}
+
+void json_jsmn_writer_init
+	(
+		json_jsmn_writer_t *w,
+		char *buf, size_t size,
+		json_jsmn_writer_flush_t flush, void *flush_ctx
+	)
+{
+	memset(w, 0, sizeof(*w));
+	w->flush = flush;
+	w->flush_ctx = flush_ctx;
+	if(!buf)
+	{
+		w->grow = 1;
+		if(size)
+		{
+			writer_reserve(w, size - 1);
+		}
+	}
+	else if(flush)
+	{
+		w->buf = buf;
+		w->size = size;
+		if(!size)
+		{
+			writer_fail(w, JSMN_ERROR_INVAL);
+		}
+	}
+	else if(size)
+	{
+		// room kept for the NUL
+		w->buf = buf;
+		w->size = size - 1;
+	}
+}
+
+long json_jsmn_writer_finish(json_jsmn_writer_t *w)
+{
+	int rc;
+
+	if(w->flush)
+	{
+		if(!w->error && w->len)
+		{
+			rc = w->flush(w->flush_ctx, w->buf, w->len);
+			if(rc)
+			{
+				writer_fail(w, rc < 0 ? rc : JSMN_ERROR_NOMEM);
+			}
+			w->len = 0;
+		}
+	}
+	else
+	{
+		if(w->grow && !w->buf)
+		{
+			writer_reserve(w, 0);
+		}
+		if(w->buf)
+		{
+			w->buf[w->len] = '\0';
+		}
+	}
+	if(!w->error && (w->depth || w->after_key))
+	{
+		// containers left open
+		w->error = JSMN_ERROR_PART;
+	}
+	return w->error ? w->error : (long)w->total;
+}
+
+void json_jsmn_writer_free(json_jsmn_writer_t *w)
+{
+	if(w->grow)
+	{
+		free(w->buf);
+		w->buf = NULL;
+		w->size = w->len = 0;
+	}
+}
+
+void json_jsmn_write_object_begin(json_jsmn_writer_t *w)
+{
+	writer_begin(w, '{');
+}
+
+void json_jsmn_write_object_end(json_jsmn_writer_t *w)
+{
+	writer_end(w, '}');
+}
+
+void json_jsmn_write_array_begin(json_jsmn_writer_t *w)
+{
+	writer_begin(w, '[');
+}
+
+void json_jsmn_write_array_end(json_jsmn_writer_t *w)
+{
+	writer_end(w, ']');
+}
+
+void json_jsmn_write_key(json_jsmn_writer_t *w, const char *key, size_t len)
+{
+	if(!w->depth || w->after_key)
+	{
+		writer_fail(w, JSMN_ERROR_INVAL);
+		return;
+	}
+	writer_value(w);
+	writer_string(w, key, len);
+	writer_putc(w, ':');
+	w->after_key = 1;
+}
+
+void json_jsmn_write_key_raw(json_jsmn_writer_t *w, const char *key, size_t len)
+{
+	if(!w->depth || w->after_key)
+	{
+		writer_fail(w, JSMN_ERROR_INVAL);
+		return;
+	}
+	writer_value(w);
+	writer_putc(w, '\"');
+	writer_put(w, key, len);
+	writer_put(w, "\":", 2);
+	w->after_key = 1;
+}
+
+void json_jsmn_write_string(json_jsmn_writer_t *w, const char *s, size_t len)
+{
+	writer_value(w);
+	writer_string(w, s, len);
+}
+
+void json_jsmn_write_int64(json_jsmn_writer_t *w, int64_t value)
+{
+	writer_value(w);
+	writer_uint(w, value < 0 ? 0 - (uint64_t)value : (uint64_t)value, value < 0);
+}
+
+void json_jsmn_write_uint64(json_jsmn_writer_t *w, uint64_t value)
+{
+	writer_value(w);
+	writer_uint(w, value, 0);
+}
+
+void json_jsmn_write_double(json_jsmn_writer_t *w, double value)
+{
+	writer_value(w);
+	writer_double(w, value, 0);
+}
+
+void json_jsmn_write_float(json_jsmn_writer_t *w, float value)
+{
+	writer_value(w);
+	writer_double(w, value, 1);
+}
+
+void json_jsmn_write_bool(json_jsmn_writer_t *w, int value)
+{
+	writer_value(w);
+	if(value)
+	{
+		writer_put(w, "true", 4);
+	}
+	else
+	{
+		writer_put(w, "false", 5);
+	}
+}
+
+void json_jsmn_write_null(json_jsmn_writer_t *w)
+{
+	writer_value(w);
+	writer_put(w, "null", 4);
+}
+
+void json_jsmn_write_raw(json_jsmn_writer_t *w, const char *s, size_t len)
+{
+	writer_value(w);
+	writer_put(w, s, len);
+}
+
+// integers are stored by size like json_jsmn_number_decode() does
+static int writer_load_int(const void *value, int size, int64_t *v)
+{
+	int8_t i8;
+	int16_t i16;
+	int32_t i32;
+
+	switch(size)
+	{
+	case sizeof(int64_t):
+		memcpy(v, value, size);
+		return 0;
+	case sizeof(int32_t):
+		memcpy(&i32, value, size);
+		*v = i32;
+		return 0;
+	case sizeof(int16_t):
+		memcpy(&i16, value, size);
+		*v = i16;
+		return 0;
+	case sizeof(int8_t):
+		memcpy(&i8, value, size);
+		*v = i8;
+		return 0;
+	default:
+		return JSMN_ERROR_INVAL;
+	}
+}
+
+static int writer_load_uint(const void *value, int size, uint64_t *v)
+{
+	uint8_t u8;
+	uint16_t u16;
+	uint32_t u32;
+
+	switch(size)
+	{
+	case sizeof(uint64_t):
+		memcpy(v, value, size);
+		return 0;
+	case sizeof(uint32_t):
+		memcpy(&u32, value, size);
+		*v = u32;
+		return 0;
+	case sizeof(uint16_t):
+		memcpy(&u16, value, size);
+		*v = u16;
+		return 0;
+	case sizeof(uint8_t):
+		memcpy(&u8, value, size);
+		*v = u8;
+		return 0;
+	default:
+		return JSMN_ERROR_INVAL;
+	}
+}
+
+static void writer_primitive(json_jsmn_writer_t *w, const json_jsmn_object_t *obj)
+{
+	int64_t i;
+	uint64_t u;
+	double d;
+	float f;
+
+	switch(obj->vtype)
+	{
+	case JSON_JSMN_VTYPE_AUTO:
+	case JSON_JSMN_VTYPE_INT8:
+	case JSON_JSMN_VTYPE_INT16:
+	case JSON_JSMN_VTYPE_INT32:
+	case JSON_JSMN_VTYPE_INT64:
+		if(writer_load_int(obj->value, obj->size, &i))
+		{
+			break;
+		}
+		json_jsmn_write_int64(w, i);
+		return;
+
+	case JSON_JSMN_VTYPE_UINT8:
+	case JSON_JSMN_VTYPE_UINT16:
+	case JSON_JSMN_VTYPE_UINT32:
+	case JSON_JSMN_VTYPE_UINT64:
+	case JSON_JSMN_VTYPE_BOOL:
+		if(writer_load_uint(obj->value, obj->size, &u))
+		{
+			break;
+		}
+		if(obj->vtype == JSON_JSMN_VTYPE_BOOL)
+		{
+			json_jsmn_write_bool(w, u != 0);
+		}
+		else
+		{
+			json_jsmn_write_uint64(w, u);
+		}
+		return;
+
+	case JSON_JSMN_VTYPE_FLOAT:
+		memcpy(&f, obj->value, sizeof(f));
+		json_jsmn_write_float(w, f);
+		return;
+
+	case JSON_JSMN_VTYPE_DOUBLE:
+		memcpy(&d, obj->value, sizeof(d));
+		json_jsmn_write_double(w, d);
+		return;
+	}
+	// size does not match the type
+	writer_fail(w, JSMN_ERROR_INVAL);
+}
+
+void json_jsmn_write_members
+	(
+		json_jsmn_writer_t *w,
+		const json_jsmn_object_t *objs, int objs_count,
+		unsigned int flags
+	)
+{
+	const json_jsmn_object_t *obj;
+	int i;
+
+	for(i = 0; i < objs_count && !w->error; i++)
+	{
+		obj = &objs[i];
+		if(!obj->key || !obj->value || ((flags & JSON_JSMN_WRITE_VALID) && obj->status != JSON_JSMN_VALID))
+		{
+			continue;
+		}
+
+		json_jsmn_write_key(w, obj->key, strlen(obj->key));
+		switch(obj->type)
+		{
+		case JSMN_STRING:
+			json_jsmn_write_string(w, (const char *)obj->value, strnlen((const char *)obj->value, obj->size));
+			break;
+		case JSMN_PRIMITIVE:
+			writer_primitive(w, obj);
+			break;
+		case JSMN_OBJECT:
+		case JSMN_ARRAY:
+			json_jsmn_write_raw(w, (const char *)obj->value, strnlen((const char *)obj->value, obj->size));
+			break;
+		default:
+			json_jsmn_write_null(w);
+			break;
+		}
+	}
+}
+
+void json_jsmn_write_object
+	(
+		json_jsmn_writer_t *w,
+		const json_jsmn_object_t *objs, int objs_count,
+		unsigned int flags
+	)
+{
+	json_jsmn_write_object_begin(w);
+	json_jsmn_write_members(w, objs, objs_count, flags);
+	json_jsmn_write_object_end(w);
+}
@@ -0,0 +1,129 @@
+#ifndef __JSON_JSMN_WRITER_H_
+#define __JSON_JSMN_WRITER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "json_jsmn.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// nesting limit of the writer, deeper containers fail with JSMN_ERROR_INVAL
+#ifndef JSON_JSMN_WRITER_DEPTH
+#define JSON_JSMN_WRITER_DEPTH		32
+#endif
+
+// json_jsmn_write_object() flag: only descriptors a parse marked JSON_JSMN_VALID
+#define JSON_JSMN_WRITE_VALID		0x01
+
+// receives each full buffer in chunked mode, non zero fails the writer
+typedef int (*json_jsmn_writer_flush_t)(void *ctx, const char *data, size_t len);
+
+/*
+ * JSON output into one of:
+ * - a fixed caller buffer (flush NULL): output that does not fit is dropped
+ *   and the writer fails with JSMN_ERROR_NOMEM, total still tells the size
+ *   needed, like snprintf()
+ * - a caller buffer handed to flush each time it fills up (chunked)
+ * - a heap buffer grown by doubling (buf NULL), see json_jsmn_writer_free()
+ * Commas and colons are inserted by the writer. Errors are sticky: after the
+ * first one every call is a no-op and json_jsmn_writer_finish() reports it.
+ */
+typedef struct
+{
+	char *buf;
+	size_t size;
+	size_t len;							// bytes held in buf
+	size_t total;						// bytes produced, flushed or dropped ones included
+	json_jsmn_writer_flush_t flush;
+	void *flush_ctx;
+	int grow;
+	int error;
+	int depth;
+	int after_key;
+	uint32_t members;					// bit n: the container at depth n has a member already
+}json_jsmn_writer_t;
+
+void json_jsmn_writer_init
+	(
+		json_jsmn_writer_t *w,
+		char *buf, size_t size,
+		json_jsmn_writer_flush_t flush, void *flush_ctx
+	);
+
+/*
+ * Flush what is left in chunked mode and NUL terminate the buffer when there
+ * is room (not counted). Returns the total length or the first error.
+ */
+long json_jsmn_writer_finish(json_jsmn_writer_t *w);
+
+// release the buffer of a growable writer
+void json_jsmn_writer_free(json_jsmn_writer_t *w);
+
+void json_jsmn_write_object_begin(json_jsmn_writer_t *w);
+void json_jsmn_write_object_end(json_jsmn_writer_t *w);
+void json_jsmn_write_array_begin(json_jsmn_writer_t *w);
+void json_jsmn_write_array_end(json_jsmn_writer_t *w);
+
+// member key, the next value written belongs to it
+void json_jsmn_write_key(json_jsmn_writer_t *w, const char *key, size_t len);
+
+// member key whose escapes are in place already, e.g. the body of a key token
+void json_jsmn_write_key_raw(json_jsmn_writer_t *w, const char *key, size_t len);
+
+/*
+ * s[0..len) as a JSON string: runs needing no escape are located with the
+ * tokenizer's SSE2/AVX2 scanner and copied in one go; '"', '\\' and control
+ * characters are escaped, other bytes (UTF-8) are copied as is.
+ */
+void json_jsmn_write_string(json_jsmn_writer_t *w, const char *s, size_t len);
+
+void json_jsmn_write_int64(json_jsmn_writer_t *w, int64_t value);
+void json_jsmn_write_uint64(json_jsmn_writer_t *w, uint64_t value);
+
+/*
+ * Shortest decimal that reads back as the same double (float) through
+ * json_jsmn_number_double() (json_jsmn_number_float()), locale independent.
+ * Values with up to 8 decimals are formatted without any printf; NaN and
+ * infinities are not JSON and are written as null.
+ */
+void json_jsmn_write_double(json_jsmn_writer_t *w, double value);
+void json_jsmn_write_float(json_jsmn_writer_t *w, float value);
+
+void json_jsmn_write_bool(json_jsmn_writer_t *w, int value);
+void json_jsmn_write_null(json_jsmn_writer_t *w);
+
+// s[0..len) as is, e.g. a value already serialized
+void json_jsmn_write_raw(json_jsmn_writer_t *w, const char *s, size_t len);
+
+/*
+ * The inverse of json_jsmn_parse_object(): each descriptor is written as a
+ * member, value read from value/size as type and vtype would decode it:
+ * - JSMN_STRING: the NUL terminated string in the size bytes at value
+ * - JSMN_PRIMITIVE: a number of vtype (AUTO: signed integer of size bytes),
+ *   JSON_JSMN_VTYPE_BOOL as true/false
+ * - JSMN_OBJECT/JSMN_ARRAY: value holds the member already serialized
+ * Descriptors without a value are skipped, so are those a parse did not
+ * fill when flags has JSON_JSMN_WRITE_VALID. json_jsmn_write_members()
+ * writes the members only, into the object currently open.
+ */
+void json_jsmn_write_object
+	(
+		json_jsmn_writer_t *w,
+		const json_jsmn_object_t *objs, int objs_count,
+		unsigned int flags
+	);
+
+void json_jsmn_write_members
+	(
+		json_jsmn_writer_t *w,
+		const json_jsmn_object_t *objs, int objs_count,
+		unsigned int flags
+	);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JSON_JSMN_WRITER_H_ */
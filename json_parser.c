@@ -1,13 +1,35 @@
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
 #include "json_parser.h"
+#include "json_jsmn_scan.h"
+#include "json_jsmn_path.h"
+#include "json_jsmn_thread.h"
+#include "json_jsmn_stats.h"
 
 #ifndef assert
 #define assert(c)
 #endif
 
+#ifndef JSON_PARSE_LAZY_CHUNK
+#define JSON_PARSE_LAZY_CHUNK		128
+#endif
+
+#ifndef JSON_TOKEN_ARENA_MIN
+#define JSON_TOKEN_ARENA_MIN		64
+#endif
+
+// input bytes per token assumed for the first parallel tokenization attempt
+#ifndef JSON_TOKEN_ARENA_BYTES
+#define JSON_TOKEN_ARENA_BYTES		8
+#endif
+
+#ifndef JSON_PARSE_RECORD_CHUNK
+#define JSON_PARSE_RECORD_CHUNK		4096
+#endif
+
 #ifdef JSON_JSMN_DEBUG_ENABLED
 #ifndef debugPrintf
 #define debugPrintf    				printf
@@ -20,7 +42,7 @@
 #define debugPrintln(...)
 #endif
 
-static void jsmntok_print(const char *js, jsmntok_t *tok)
+static void jsmntok_print(const char *js, const json_jsmn_token_t *tok)
 {
     int i;
     
@@ -35,19 +57,33 @@ do{	\
 	debugPrintf("\r\n");	\
 }while(0)
 
-#define array_element_print(js,index,key,value)	\
-do{	\
-	jsmntok_print(js, key);	\
-	debugPrintf("[%d] : ", index);	\
-	jsmntok_print(js, value);	\
-	debugPrintf("\r\n");	\
-}while(0)
  
-int json_parse_jsmn(jsmn_parser *parser, const char *js, unsigned int jslen, jsmntok_t *tokens, int tokcount)
+// state (optional) is kept by the caller between calls, see json_jsmn_scan_resume()
+static int json_parse_jsmn_state(jsmn_parser *parser, json_jsmn_scan_state_t *state, const char *js, unsigned int jslen, json_jsmn_token_t *tokens, int tokcount)
 {
     int rc;
+#ifdef JSON_JSMN_STATS_ENABLED
+    unsigned int pos = parser->pos, toknext = parser->toknext;
+#endif
+    JSON_JSMN_STAT_CLOCK(start);
     
-    rc = jsmn_parse(parser, js, jslen, tokens, tokcount);
+    if(state)
+    {
+        rc = json_jsmn_scan_resume(parser, state, js, jslen, tokens, tokcount);
+    }
+    else
+    {
+#ifdef JSON_JSMN_COMPACT_TOKENS
+        rc = json_jsmn_scan_compact(parser, js, jslen, tokens, tokcount);
+#else
+        rc = json_jsmn_scan(parser, js, jslen, tokens, tokcount);
+#endif
+    }
+    JSON_JSMN_STAT_CYCLES(cycles_tokenize, start);
+    JSON_JSMN_STAT_ADD(tokenize_calls, 1);
+    JSON_JSMN_STAT_ADD(bytes, parser->pos - pos);
+    JSON_JSMN_STAT_ADD(tokens, tokens ? parser->toknext - toknext : 0);
+    JSON_JSMN_STAT_ERROR(rc);
     if (0 > rc)
     {
         switch(rc)
@@ -75,31 +111,317 @@ int json_parse_jsmn(jsmn_parser *parser, const char *js, unsigned int jslen, jsm
     return rc;
 }
 
-int json_parse
+int json_parse_jsmn(jsmn_parser *parser, const char *js, unsigned int jslen, json_jsmn_token_t *tokens, int tokcount)
+{
+    return json_parse_jsmn_state(parser, NULL, js, jslen, tokens, tokcount);
+}
+
+// json_jsmn_scan_parallel() counted like json_parse_jsmn()
+static int json_parse_jsmn_parallel(const char *js, unsigned int jslen, json_jsmn_token_t *tokens, int tokcount, int threads)
+{
+	int rc;
+	JSON_JSMN_STAT_CLOCK(start);
+
+	rc = json_jsmn_scan_parallel(js, jslen, tokens, tokcount, threads);
+	JSON_JSMN_STAT_CYCLES(cycles_tokenize, start);
+	JSON_JSMN_STAT_ADD(tokenize_calls, 1);
+	JSON_JSMN_STAT_ADD(bytes, rc >= 0 ? jslen : 0);
+	JSON_JSMN_STAT_ADD(tokens, rc >= 0 ? rc : 0);
+	JSON_JSMN_STAT_ERROR(rc);
+	return rc;
+}
+
+int json_parse_document
 	(
+		json_jsmn_t *jjs,
 		const char *js, unsigned int jslen,
-		jsmntok_t *tokens, int tokcount,
-		const char **keys_filter_list,
-		json_jsmntok_t *json_jsmntok, int json_jsmntok_count
+		json_jsmn_token_t *tokens, int tokcount,
+		unsigned int *spans
 	)
 {
 	int rc;
 	jsmn_parser jsmn_parser_object;
-	json_jsmn_t jjs;
 
 	jsmn_init(&jsmn_parser_object);
 
-    rc = json_parse_jsmn(&jsmn_parser_object, js, jslen, tokens, tokcount);
-    if(0 > rc)
-    {
-        return rc;
-    }
+	rc = json_parse_jsmn(&jsmn_parser_object, js, jslen, tokens, tokcount);
+	if(0 > rc)
+	{
+		return rc;
+	}
+
+	debugPrintln("jsmn_parse(): token_count: %u", jsmn_parser_object.toknext);
+
+	json_jsmn_init(jjs, js, tokens, jsmn_parser_object.toknext);
+	if(spans)
+	{
+		json_jsmn_index(jjs, spans, tokcount);
+	}
+
+	return jsmn_parser_object.toknext;
+}
+
+int json_parse_document_parallel
+	(
+		json_jsmn_t *jjs,
+		const char *js, unsigned int jslen,
+		json_jsmn_token_t *tokens, int tokcount,
+		unsigned int *spans,
+		int threads
+	)
+{
+	int rc;
+
+	rc = json_parse_jsmn_parallel(js, jslen, tokens, tokcount, threads);
+	if(0 > rc)
+	{
+		return rc;
+	}
+
+	debugPrintln("json_jsmn_scan_parallel(): token_count: %d", rc);
+
+	json_jsmn_init(jjs, js, tokens, rc);
+	if(spans)
+	{
+		json_jsmn_index(jjs, spans, tokcount);
+	}
+
+	return rc;
+}
+
+int json_parse_count(const char *js, unsigned int jslen)
+{
+	jsmn_parser jsmn_parser_object;
+
+	jsmn_init(&jsmn_parser_object);
+	return json_jsmn_scan(&jsmn_parser_object, js, jslen, NULL, 0);
+}
+
+static void *json_token_arena_realloc(json_token_arena_t *arena, void *ptr, size_t size)
+{
+	if(arena->allocator)
+	{
+		return arena->allocator->reallocate(arena->allocator->ctx, ptr, size);
+	}
+	return realloc(ptr, size);
+}
+
+static void json_token_arena_release(json_token_arena_t *arena, void *ptr)
+{
+	if(!ptr)
+	{
+		return;
+	}
+	if(arena->allocator)
+	{
+		arena->allocator->release(arena->allocator->ctx, ptr);
+	}
+	else
+	{
+		free(ptr);
+	}
+}
+
+void json_token_arena_init
+	(
+		json_token_arena_t *arena,
+		int tokmax,
+		const json_token_allocator_t *allocator
+	)
+{
+	memset(arena, 0, sizeof(*arena));
+	arena->tokmax = tokmax;
+	arena->allocator = allocator;
+}
+
+int json_token_arena_reserve(json_token_arena_t *arena, int tokcount)
+{
+	json_jsmn_token_t *tokens;
+
+	if(tokcount <= arena->tokcount)
+	{
+		return 0;
+	}
+	if(arena->tokmax > 0 && tokcount > arena->tokmax)
+	{
+		return JSMN_ERROR_NOMEM;
+	}
+	if((size_t)tokcount > ((size_t)-1) / sizeof(json_jsmn_token_t))
+	{
+		return JSMN_ERROR_NOMEM;
+	}
+
+	tokens = json_token_arena_realloc(arena, arena->tokens, tokcount * sizeof(json_jsmn_token_t));
+	if(!tokens)
+	{
+		return JSMN_ERROR_NOMEM;
+	}
+	arena->tokens = tokens;
+	arena->tokcount = tokcount;
+	return 0;
+}
+
+void json_token_arena_free(json_token_arena_t *arena)
+{
+	json_token_arena_release(arena, arena->tokens);
+	json_token_arena_release(arena, arena->spans);
+	arena->tokens = NULL;
+	arena->tokcount = 0;
+	arena->spans = NULL;
+	arena->spancount = 0;
+}
+
+static int json_token_arena_grow(json_token_arena_t *arena)
+{
+	int tokcount;
+
+	if(arena->tokcount < JSON_TOKEN_ARENA_MIN)
+	{
+		tokcount = JSON_TOKEN_ARENA_MIN;
+	}
+	else if(arena->tokcount > 0x3fffffff)
+	{
+		return JSMN_ERROR_NOMEM;
+	}
+	else
+	{
+		tokcount = arena->tokcount * 2;
+	}
+	if(arena->tokmax > 0 && tokcount > arena->tokmax)
+	{
+		if(arena->tokcount >= arena->tokmax)
+		{
+			return JSMN_ERROR_NOMEM;
+		}
+		tokcount = arena->tokmax;
+	}
+	return json_token_arena_reserve(arena, tokcount);
+}
+
+// spans for the tokens of jjs, kept in the arena next to them
+static int json_token_arena_index(json_token_arena_t *arena, json_jsmn_t *jjs)
+{
+#ifndef JSON_JSMN_COMPACT_TOKENS
+	unsigned int *spans;
+
+	if(arena->spancount < arena->tokcount)
+	{
+		spans = json_token_arena_realloc(arena, arena->spans, arena->tokcount * sizeof(unsigned int));
+		if(!spans)
+		{
+			return JSMN_ERROR_NOMEM;
+		}
+		arena->spans = spans;
+		arena->spancount = arena->tokcount;
+	}
+	json_jsmn_index(jjs, arena->spans, arena->spancount);
+#endif
+	return 0;
+}
+
+int json_parse_document_arena
+	(
+		json_jsmn_t *jjs,
+		const char *js, unsigned int jslen,
+		json_token_arena_t *arena,
+		int index
+	)
+{
+	int rc;
+	jsmn_parser jsmn_parser_object;
+
+	jsmn_init(&jsmn_parser_object);
+
+	if(!arena->tokens && 0 > (rc = json_token_arena_grow(arena)))
+	{
+		return rc;
+	}
+
+	// jsmn keeps its position and token indexes, so a moved array resumes fine
+	while(JSMN_ERROR_NOMEM == (rc = json_parse_jsmn(&jsmn_parser_object, js, jslen, arena->tokens, arena->tokcount)))
+	{
+		if(0 > json_token_arena_grow(arena))
+		{
+			return JSMN_ERROR_NOMEM;
+		}
+	}
+	if(0 > rc)
+	{
+		return rc;
+	}
+
+	json_jsmn_init(jjs, js, arena->tokens, jsmn_parser_object.toknext);
+	if(index && 0 > (rc = json_token_arena_index(arena, jjs)))
+	{
+		return rc;
+	}
+
+	return jsmn_parser_object.toknext;
+}
+
+int json_parse_document_arena_parallel
+	(
+		json_jsmn_t *jjs,
+		const char *js, unsigned int jslen,
+		json_token_arena_t *arena,
+		int index,
+		int threads
+	)
+{
+	int rc, tokcount;
+
+	if(json_jsmn_thread_count(threads) < 2)
+	{
+		return json_parse_document_arena(jjs, js, jslen, arena, index);
+	}
+
+	// the parallel tokenizer does not resume: start from a guess, retry bigger
+	tokcount = jslen / JSON_TOKEN_ARENA_BYTES + JSON_TOKEN_ARENA_MIN;
+	if(arena->tokmax > 0 && tokcount > arena->tokmax)
+	{
+		tokcount = arena->tokmax;
+	}
+	if(0 > (rc = json_token_arena_reserve(arena, tokcount)))
+	{
+		return rc;
+	}
+	while(JSMN_ERROR_NOMEM == (rc = json_parse_jsmn_parallel(js, jslen, arena->tokens, arena->tokcount, threads)))
+	{
+		if(0 > json_token_arena_grow(arena))
+		{
+			return JSMN_ERROR_NOMEM;
+		}
+	}
+	if(0 > rc)
+	{
+		return rc;
+	}
+
+	json_jsmn_init(jjs, js, arena->tokens, rc);
+	if(index && 0 > json_token_arena_index(arena, jjs))
+	{
+		return JSMN_ERROR_NOMEM;
+	}
+
+	return rc;
+}
 
-    debugPrintln("jsmn_parse(): token_count: %u", jsmn_parser_object.toknext);
+int json_parse
+	(
+		const char *js, unsigned int jslen,
+		json_jsmn_token_t *tokens, int tokcount,
+		const char **keys_filter_list,
+		json_jsmntok_t *json_jsmntok, int json_jsmntok_count
+	)
+{
+	int rc;
+	json_jsmn_t jjs;
 
-    jjs.js = js;
-	jjs.tokens = tokens;
-	jjs.token_count = jsmn_parser_object.toknext;
+	rc = json_parse_document(&jjs, js, jslen, tokens, tokcount, NULL);
+	if(0 > rc)
+	{
+		return rc;
+	}
 
 	return json_jsmn_parse
 			(
@@ -112,25 +434,18 @@ int json_parse
 int json_parse_object
 	(
 		const char *js, unsigned int jslen,
-		jsmntok_t *tokens, int tokcount,
+		json_jsmn_token_t *tokens, int tokcount,
 		json_jsmn_object_t *json_jsmn_objects, int json_jsmn_object_count
 	)
 {
 	int i,rc;
-	jsmn_parser jsmn_parser_object;
 	json_jsmn_t jjs;
 
-	jsmn_init(&jsmn_parser_object);
-    
-    rc = json_parse_jsmn(&jsmn_parser_object, js, jslen, tokens, tokcount);
-    if(0 > rc)
-    {
-        return rc;
-    }
-    
-    jjs.js = js;
-    jjs.tokens = tokens;
-    jjs.token_count = jsmn_parser_object.toknext;
+	rc = json_parse_document(&jjs, js, jslen, tokens, tokcount, NULL);
+	if(0 > rc)
+	{
+		return rc;
+	}
 
 	rc=json_jsmn_parse_object(&jjs, json_jsmn_objects, json_jsmn_object_count);
 
@@ -156,106 +471,788 @@ int json_parse_object
 	return 0;
 }
 
-int json_parse_array
+struct parse_array_args
+{
+	json_array_element_callback_t callback;
+	void *callback_args;
+};
+static int parse_array_element_callback
 	(
-		const char *js, unsigned int jslen,
-		jsmntok_t *tokens, int tokcount,
+		int index,
+		const json_jsmn_t *element,
+		void *callback_args
+	)
+{
+	struct parse_array_args *args = callback_args;
+	const json_jsmn_token_t *t = element->tokens;
+
+	debugPrintf("[%d] : ", index);
+	jsmntok_print(element->js, t);
+	debugPrintf("\r\n");
+
+	if(!args->callback)
+	{
+		return 0;
+	}
+	return (*args->callback)
+			(
+				index,
+				t->type,
+				(void *)(element->js + t->start),
+				t->end - t->start,
+				args->callback_args
+			);
+}
+
+int json_jsmn_parse_array
+	(
+		json_jsmn_t *jjs,
 		const char *name,
 		json_array_element_callback_t callback, void *callback_args
 	)
 {
-	int i,j,rc;
-	jsmn_parser jsmn_parser_object;
+	int rc;
 	const char *json_jsmntok_keys[2];
 	json_jsmntok_t json_jsmntok;
-	json_jsmn_t jjs;
-
-	jsmn_init(&jsmn_parser_object);
-
-    rc = json_parse_jsmn(&jsmn_parser_object, js, jslen, tokens, tokcount);
-    if(0 > rc)
-    {
-        return rc;
-    }
-
-    jjs.js = js;
-    jjs.tokens = tokens;
-    jjs.token_count = jsmn_parser_object.toknext;
+	struct parse_array_args parse_array_args;
 
-	json_jsmntok_keys[0] = name;
-	json_jsmntok_keys[1] = NULL;
-	rc = json_jsmn_parse(&jjs, json_jsmntok_keys, &json_jsmntok, 1);
-
-	if(rc == 1 && json_jsmntok.t_value->type == JSMN_ARRAY)
-    {
-        if(json_jsmntok.t_count > 1)
-        {
-            for(rc=0,i=1;i<json_jsmntok.t_count;i++)
-            {
-                rc++;
-                if(callback)
-                {
-                    int r = (*callback)(i-1,
-                                        json_jsmntok.t_value[i].type,
-                                        (void *)(js + json_jsmntok.t_value[i].start),
-                                        json_jsmntok.t_value[i].end-json_jsmntok.t_value[i].start,
-                                        callback_args
-                                    );
-                    if(r)
-                    {
-                        // stop request from callback
-                        break;
-                    }
-                }
-                array_element_print(js, i-1, json_jsmntok.t_key, &json_jsmntok.t_value[i]);
-            }
-        }
-        else
-        {
-        	debugPrintln("jsmn_parse(): array is empty: %d", rc);
-            rc = 0;
-        }
-    }
+	if(!name)
+	{
+		// the root is the array
+		rc = jjs->token_count ? 1 : 0;
+		json_jsmntok.t_value = (json_jsmn_token_t *)jjs->tokens;
+	}
+	else if(name[0] == '/')
+	{
+		rc = json_jsmn_path_get(jjs, name, &json_jsmntok);
+		if(rc == 1 && !json_jsmntok.t_value)
+		{
+			rc = 0;
+		}
+	}
 	else
+	{
+		json_jsmntok_keys[0] = name;
+		json_jsmntok_keys[1] = NULL;
+		rc = json_jsmn_parse(jjs, json_jsmntok_keys, &json_jsmntok, 1);
+	}
+
+	if(rc != 1 || json_jsmntok.t_value->type != JSMN_ARRAY)
 	{
 		debugPrintln("jsmn_parse(): invalid jsmn array: %d", rc);
-		rc = -1;
+		return -1;
 	}
 
+	parse_array_args.callback = callback;
+	parse_array_args.callback_args = callback_args;
+	rc = json_jsmn_array_foreach
+			(
+				jjs,
+				json_jsmntok.t_value,
+				parse_array_element_callback,
+				&parse_array_args
+			);
+	if(!rc)
+	{
+		debugPrintln("jsmn_parse(): array is empty: %d", rc);
+	}
 	return rc;
 }
 
-
-#if __STDC_VERSION__ >= 199901L
-int json_parse_fmt
+int json_parse_array
 	(
 		const char *js, unsigned int jslen,
-		jsmntok_t *tokens, int tokcount,
-		const char **keys_filter_list,
-		int json_jsmntok_count, ...
+		json_jsmn_token_t *tokens, int tokcount,
+		const char *name,
+		json_array_element_callback_t callback, void *callback_args
 	)
 {
 	int rc;
-	jsmn_parser jsmn_parser_object;
 	json_jsmn_t jjs;
-	va_list args;
 
-	jsmn_init(&jsmn_parser_object);
+	rc = json_parse_document(&jjs, js, jslen, tokens, tokcount, NULL);
+	if(0 > rc)
+	{
+		return rc;
+	}
 
-    rc = json_parse_jsmn(&jsmn_parser_object, js, jslen, tokens, tokcount);
-    if(0 > rc)
-    {
-        return rc;
-    }
+	return json_jsmn_parse_array(&jjs, name, callback, callback_args);
+}
 
-    debugPrintln("jsmn_parse(): token_count: %u", jsmn_parser_object.toknext);
 
-    jjs.js = js;
-	jjs.tokens = tokens;
-	jjs.token_count = jsmn_parser_object.toknext;
+typedef int (*json_parse_member_t)
+		(
+			const char *js,
+			const json_jsmn_token_t *key,
+			const json_jsmn_token_t *value, int span,
+			void *args
+		);
 
-	va_start(args, json_jsmntok_count);
-	rc = json_jsmn_parse_va_list
+static int json_parse_delimiter(char c)
+{
+	switch(c)
+	{
+	case ',':
+	case ':':
+	case '[':
+	case ']':
+	case '{':
+	case '}':
+	case ' ':
+	case '\t':
+	case '\r':
+	case '\n':
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+// closing quote of the string opening at js[i], jslen when the input cuts it
+static unsigned int json_parse_string_end(const char *js, unsigned int jslen, unsigned int i)
+{
+	for(i++; i < jslen; i++)
+	{
+		i = json_jsmn_scan_string_stop(js, i, jslen);
+		if(i >= jslen || js[i] == '\"')
+		{
+			break;
+		}
+		if(js[i] == '\\')
+		{
+			// the escaped byte cannot close the string
+			i++;
+		}
+	}
+	return i < jslen ? i : jslen;
+}
+
+/*
+ * End of the next chunk fed to jsmn from js[from], which is outside any
+ * string: just after the last delimiter outside strings before limit, or
+ * after the first one past limit when a string or primitive runs over it.
+ * jsmn terminates a primitive at the end of its input, so a cut turning
+ * "1234" into "12" would produce a wrong token, and it rewinds to the
+ * opening quote of a string the end of its input cuts, so a cut inside a
+ * string would make no progress.
+ */
+static unsigned int json_parse_safe_length
+	(
+		const char *js, unsigned int jslen,
+		unsigned int from, unsigned int limit
+	)
+{
+	unsigned int i, cut;
+
+	if(limit >= jslen)
+	{
+		return jslen;
+	}
+
+	for(i = from, cut = from; i < jslen; i++)
+	{
+		if(cut > from && i >= limit)
+		{
+			return cut;
+		}
+		if(js[i] == '\"')
+		{
+			i = json_parse_string_end(js, jslen, i);
+		}
+		else if(json_parse_delimiter(js[i]))
+		{
+			cut = i + 1;
+		}
+	}
+	return jslen;
+}
+
+/*
+ * json_parse_safe_length() for records: the chunk also ends right after the
+ * root value, so jsmn never tokenizes the start of the next record. *depth
+ * is the nesting at js[from] and receives the one at the returned end.
+ */
+static unsigned int json_parse_record_length
+	(
+		const char *js, unsigned int jslen,
+		unsigned int from, unsigned int limit,
+		int *depth
+	)
+{
+	unsigned int i, cut;
+	int level;
+
+	for(i = from, cut = from, level = *depth; i < jslen; i++)
+	{
+		if(cut > from && i >= limit)
+		{
+			return cut;
+		}
+		switch(js[i])
+		{
+		case '\"':
+			i = json_parse_string_end(js, jslen, i);
+			if(!level)
+			{
+				// the root is a string
+				return i < jslen ? i + 1 : jslen;
+			}
+			continue;
+		case '{':
+		case '[':
+			level++;
+			break;
+		case '}':
+		case ']':
+			if(!--level)
+			{
+				return i + 1;
+			}
+			break;
+		default:
+			if(!level && !json_parse_delimiter(js[i]))
+			{
+				// the root is a primitive, jsmn ends it at the end of the chunk
+				while(i < jslen && !json_parse_delimiter(js[i]))
+				{
+					i++;
+				}
+				return i;
+			}
+			break;
+		}
+		if(json_parse_delimiter(js[i]))
+		{
+			cut = i + 1;
+			*depth = level;
+		}
+	}
+	return jslen;
+}
+
+/*
+ * Report the root members, starting with the key token at *member, whose
+ * value is closed. Returns 0 as soon as member_callback returns 0, non zero
+ * when more members are wanted.
+ */
+static int json_parse_members
+	(
+		const char *js,
+		json_jsmn_token_t *tokens, unsigned int toknext,
+		unsigned int *member,
+		json_parse_member_t member_callback, void *args
+	)
+{
+	json_jsmn_t jjs;
+	int span;
+
+	json_jsmn_init(&jjs, js, tokens, toknext);
+	while(*member + 1 < toknext)
+	{
+		if(tokens[*member + 1].end == -1)
+		{
+			// value still open
+			break;
+		}
+
+		span = json_jsmn_span(&jjs, &tokens[*member + 1]);
+		*member += 1 + span;
+		if(!member_callback(js, &tokens[*member - 1 - span], &tokens[*member - span], span, args))
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/*
+ * Interleave tokenization and matching: js is fed to jsmn JSON_PARSE_LAZY_CHUNK
+ * bytes at a time and every root member is handed to member_callback as soon
+ * as its value is closed. Tokenization stops when the callback reports that
+ * nothing is left to find.
+ */
+static int json_parse_lazy_core
+	(
+		const char *js, unsigned int jslen,
+		json_jsmn_token_t *tokens, int tokcount,
+		json_parse_member_t member_callback, void *args,
+		unsigned int *consumed
+	)
+{
+	int rc, remaining;
+	unsigned int pos, limit, member;
+	jsmn_parser jsmn_parser_object;
+
+	jsmn_init(&jsmn_parser_object);
+
+	for(rc = JSMN_ERROR_PART, member = 1, remaining = 1; remaining && rc == JSMN_ERROR_PART;)
+	{
+		pos = jsmn_parser_object.pos;
+		if(pos >= jslen)
+		{
+			// the whole input is scanned and the document is still open
+			return rc;
+		}
+
+		limit = json_parse_safe_length(js, jslen, pos, pos + JSON_PARSE_LAZY_CHUNK);
+		rc = json_parse_jsmn(&jsmn_parser_object, js, limit, tokens, tokcount);
+		if(0 > rc && (rc != JSMN_ERROR_PART || limit >= jslen || jsmn_parser_object.pos == pos))
+		{
+			// a string cut by the end of the input leaves pos behind jslen,
+			// jsmn stops for good at a NUL byte
+			return rc;
+		}
+
+		if(jsmn_parser_object.toknext && tokens[0].type != JSMN_OBJECT)
+		{
+			debugPrintln("Invalid object(%d): root element must be an object.", tokens[0].type);
+			return JSMN_ERROR_INVAL;
+		}
+
+		remaining = json_parse_members
+					(
+						js,
+						tokens, jsmn_parser_object.toknext,
+						&member,
+						member_callback, args
+					);
+	}
+
+	if(consumed)
+	{
+		*consumed = jsmn_parser_object.pos;
+	}
+	return 0;
+}
+
+struct json_parse_lazy_args
+{
+	const char **keys_filter_list;
+	json_jsmntok_t *json_jsmntok;
+	int json_jsmntok_count;
+	int index;
+	int remaining;
+	json_jsmn_object_t *objs;
+};
+
+static int json_parse_lazy_member
+	(
+		const char *js,
+		const json_jsmn_token_t *key,
+		const json_jsmn_token_t *value, int span,
+		void *args
+	)
+{
+	struct json_parse_lazy_args *largs = args;
+	const char **keys_filter_list = largs->keys_filter_list;
+	json_jsmntok_t *json_jsmntok;
+
+	if(keys_filter_list)
+	{
+		while(*keys_filter_list && jsmntok_strcmp(js, key, *keys_filter_list))
+		{
+			keys_filter_list++;
+		}
+		if(!*keys_filter_list)
+		{
+			return largs->remaining;
+		}
+	}
+
+	json_jsmntok = &largs->json_jsmntok[largs->index++];
+	json_jsmntok->t_key = (json_jsmn_token_t *)key;
+	json_jsmntok->t_value = (json_jsmn_token_t *)value;
+	json_jsmntok->t_value_type = value->type;
+	json_jsmntok->t_count = span;
+	object_print(js, key, value);
+
+	if(largs->index >= largs->json_jsmntok_count)
+	{
+		return 0;
+	}
+	return --largs->remaining;
+}
+
+int json_parse_lazy
+	(
+		const char *js, unsigned int jslen,
+		json_jsmn_token_t *tokens, int tokcount,
+		const char **keys_filter_list,
+		json_jsmntok_t *json_jsmntok, int json_jsmntok_count,
+		unsigned int *consumed
+	)
+{
+	int rc;
+	struct json_parse_lazy_args largs;
+
+	largs.keys_filter_list = keys_filter_list;
+	largs.json_jsmntok = json_jsmntok;
+	largs.json_jsmntok_count = json_jsmntok_count;
+	largs.index = 0;
+	largs.remaining = json_jsmntok_count;
+	if(keys_filter_list)
+	{
+		for(largs.remaining = 0; keys_filter_list[largs.remaining]; largs.remaining++);
+	}
+
+	if(!largs.remaining || !json_jsmntok_count)
+	{
+		if(consumed)
+		{
+			*consumed = 0;
+		}
+		return 0;
+	}
+
+	rc = json_parse_lazy_core
+			(
+				js, jslen,
+				tokens, tokcount,
+				json_parse_lazy_member, &largs,
+				consumed
+			);
+	return 0 > rc ? rc : largs.index;
+}
+
+static int json_parse_object_lazy_member
+	(
+		const char *js,
+		const json_jsmn_token_t *key,
+		const json_jsmn_token_t *value, int span,
+		void *args
+	)
+{
+	struct json_parse_lazy_args *largs = args;
+	int i;
+
+	for(i = 0; i < largs->json_jsmntok_count; i++)
+	{
+		if(largs->objs[i].status != JSON_JSMN_VALID && 0 == jsmntok_strcmp(js, key, largs->objs[i].key))
+		{
+			if(json_jsmn_object_set(&largs->objs[i], js, value, span))
+			{
+				largs->index++;
+				largs->remaining--;
+			}
+			break;
+		}
+	}
+	return largs->remaining;
+}
+
+int json_parse_object_lazy
+	(
+		const char *js, unsigned int jslen,
+		json_jsmn_token_t *tokens, int tokcount,
+		json_jsmn_object_t *json_jsmn_objects, int json_jsmn_object_count,
+		unsigned int *consumed
+	)
+{
+	int i, rc;
+	struct json_parse_lazy_args largs;
+
+	for(i = 0; i < json_jsmn_object_count; i++)
+	{
+		json_jsmn_objects[i].status = JSON_JSMN_EMPTY;
+	}
+
+	largs.objs = json_jsmn_objects;
+	largs.json_jsmntok_count = json_jsmn_object_count;
+	largs.index = 0;
+	largs.remaining = json_jsmn_object_count;
+
+	rc = json_parse_lazy_core
+			(
+				js, jslen,
+				tokens, tokcount,
+				json_parse_object_lazy_member, &largs,
+				consumed
+			);
+	return 0 > rc ? rc : largs.index;
+}
+
+void json_stream_init
+	(
+		json_stream_t *stream,
+		json_jsmn_token_t *tokens, int tokcount,
+		json_stream_member_callback_t callback, void *callback_args
+	)
+{
+	jsmn_init(&stream->parser);
+	json_jsmn_scan_state_init(&stream->scan);
+	stream->scanned = 0;
+	stream->limit = 0;
+	stream->tokens = tokens;
+	stream->tokcount = tokcount;
+	stream->member = 1;
+	stream->callback = callback;
+	stream->callback_args = callback_args;
+}
+
+static int json_stream_member
+	(
+		const char *js,
+		const json_jsmn_token_t *key,
+		const json_jsmn_token_t *value, int span,
+		void *args
+	)
+{
+	json_stream_t *stream = args;
+
+	object_print(js, key, value);
+	if((*stream->callback)(js, key, value, span, stream->callback_args))
+	{
+		// stop request from callback
+		stream->callback = NULL;
+		return 0;
+	}
+	return 1;
+}
+
+int json_stream_parse
+	(
+		json_stream_t *stream,
+		const char *js, unsigned int jslen,
+		json_jsmn_t *jjs
+	)
+{
+	int rc;
+	unsigned int limit;
+
+	// hold back a trailing primitive that more data could still extend, only the new bytes can end it
+	for(limit = jslen; limit > stream->scanned && !json_parse_delimiter(js[limit - 1]); limit--);
+	if(limit <= stream->scanned)
+	{
+		limit = stream->limit;
+	}
+	stream->scanned = jslen;
+	stream->limit = limit;
+
+	rc = json_parse_jsmn_state(&stream->parser, &stream->scan, js, limit, stream->tokens, stream->tokcount);
+	if(0 > rc && rc != JSMN_ERROR_PART)
+	{
+		return rc;
+	}
+
+	if(stream->callback && stream->parser.toknext && stream->tokens[0].type == JSMN_OBJECT)
+	{
+		json_parse_members
+			(
+				js,
+				stream->tokens, stream->parser.toknext,
+				&stream->member,
+				json_stream_member, stream
+			);
+	}
+
+	if(0 > rc || !stream->parser.toknext || stream->tokens[0].end == -1)
+	{
+		return JSMN_ERROR_PART;
+	}
+
+	if(jjs)
+	{
+		json_jsmn_init(jjs, js, stream->tokens, stream->parser.toknext);
+	}
+	return stream->parser.toknext;
+}
+
+/*
+ * Tokenize the record starting at js[0]: jsmn is fed JSON_PARSE_RECORD_CHUNK
+ * bytes at a time up to the end of the root value, so the token array never
+ * holds more than one record.
+ */
+static int json_parse_record
+	(
+		const char *js, size_t jslen,
+		json_jsmn_token_t *tokens, int tokcount,
+		json_jsmn_t *jjs
+	)
+{
+	int rc, depth;
+	unsigned int pos, limit;
+	jsmn_parser jsmn_parser_object;
+
+	jsmn_init(&jsmn_parser_object);
+	depth = 0;
+	do
+	{
+		pos = jsmn_parser_object.pos;
+		if(pos >= jslen)
+		{
+			return JSMN_ERROR_PART;
+		}
+
+		limit = json_parse_record_length(js, jslen, pos, pos + JSON_PARSE_RECORD_CHUNK, &depth);
+		rc = json_parse_jsmn(&jsmn_parser_object, js, limit, tokens, tokcount);
+		if(0 > rc && (rc != JSMN_ERROR_PART || limit >= jslen || jsmn_parser_object.pos == pos))
+		{
+			return rc;
+		}
+	}while(!jsmn_parser_object.toknext || tokens[0].end == -1);
+
+	json_jsmn_init(jjs, js, tokens, jsmn_parser_object.toknext);
+	return jsmn_parser_object.toknext;
+}
+
+static int json_parse_records_core
+	(
+		const char *js, size_t jslen,
+		json_jsmn_token_t *tokens, int tokcount,
+		const json_jsmn_keyset_t *keyset,
+		json_jsmntok_t *json_jsmntok, int json_jsmntok_count,
+		json_record_callback_t callback, void *callback_args,
+		unsigned long index,
+		size_t *consumed, int *stopped
+	)
+{
+	int rc, n;
+	size_t pos, end;
+	json_jsmn_t jjs;
+
+	for(pos = 0, n = 0;; n++)
+	{
+		while(pos < jslen && (js[pos] == ' ' || js[pos] == '\t' || js[pos] == '\r' || js[pos] == '\n'))
+		{
+			pos++;
+		}
+		if(consumed)
+		{
+			*consumed = pos;
+		}
+		if(pos >= jslen)
+		{
+			break;
+		}
+
+		rc = json_parse_record(js + pos, jslen - pos, tokens, tokcount, &jjs);
+		if(0 > rc)
+		{
+			if(rc == JSMN_ERROR_PART && consumed)
+			{
+				// incomplete last record: the caller appends data and retries
+				break;
+			}
+			return rc;
+		}
+		end = pos + tokens[0].end;
+
+		rc = 0;
+		if(keyset)
+		{
+			rc = json_jsmn_parse_keyset(&jjs, keyset, json_jsmntok, json_jsmntok_count);
+		}
+		pos = end;
+		if(callback && (*callback)(index + n, &jjs, json_jsmntok, rc, callback_args))
+		{
+			// stop request from callback
+			if(consumed)
+			{
+				*consumed = pos;
+			}
+			if(stopped)
+			{
+				*stopped = 1;
+			}
+			return n + 1;
+		}
+	}
+
+	return n;
+}
+
+int json_parse_records
+	(
+		const char *js, size_t jslen,
+		json_jsmn_token_t *tokens, int tokcount,
+		const json_jsmn_keyset_t *keyset,
+		json_jsmntok_t *json_jsmntok, int json_jsmntok_count,
+		json_record_callback_t callback, void *callback_args
+	)
+{
+	return json_parse_records_core
+			(
+				js, jslen,
+				tokens, tokcount,
+				keyset,
+				json_jsmntok, json_jsmntok_count,
+				callback, callback_args,
+				0, NULL, NULL
+			);
+}
+
+long json_parse_records_file
+	(
+		FILE *fp,
+		char *buffer, size_t buffer_size,
+		json_jsmn_token_t *tokens, int tokcount,
+		const json_jsmn_keyset_t *keyset,
+		json_jsmntok_t *json_jsmntok, int json_jsmntok_count,
+		json_record_callback_t callback, void *callback_args
+	)
+{
+	int rc, stopped;
+	long n;
+	size_t len, r, consumed;
+
+	for(n = 0, len = 0, stopped = 0;;)
+	{
+		r = fread(buffer + len, 1, buffer_size - len, fp);
+		len += r;
+
+		rc = json_parse_records_core
+				(
+					buffer, len,
+					tokens, tokcount,
+					keyset,
+					json_jsmntok, json_jsmntok_count,
+					callback, callback_args,
+					n, r ? &consumed : NULL, &stopped
+				);
+		if(0 > rc)
+		{
+			return rc;
+		}
+		n += rc;
+
+		if(!r || stopped)
+		{
+			// end of file: the last record was parsed without consumed
+			return ferror(fp) ? -1 : n;
+		}
+		if(!consumed && len == buffer_size)
+		{
+			debugPrintln("json_parse_records_file: record larger than %u bytes", (unsigned int)buffer_size);
+			return JSMN_ERROR_NOMEM;
+		}
+
+		// keep the incomplete record, its bytes are parsed again with more data
+		memmove(buffer, buffer + consumed, len - consumed);
+		len -= consumed;
+	}
+}
+
+#if __STDC_VERSION__ >= 199901L
+int json_parse_fmt
+	(
+		const char *js, unsigned int jslen,
+		json_jsmn_token_t *tokens, int tokcount,
+		const char **keys_filter_list,
+		int json_jsmntok_count, ...
+	)
+{
+	int rc;
+	json_jsmn_t jjs;
+	va_list args;
+
+	rc = json_parse_document(&jjs, js, jslen, tokens, tokcount, NULL);
+	if(0 > rc)
+	{
+		return rc;
+	}
+
+	va_start(args, json_jsmntok_count);
+	rc = json_jsmn_parse_va_list
 			(
 				&jjs,
 				keys_filter_list,
@@ -269,26 +1266,19 @@ int json_parse_fmt
 int json_parse_object_fmt
 	(
 		const char *js, unsigned int jslen,
-		jsmntok_t *tokens, int tokcount,
+		json_jsmn_token_t *tokens, int tokcount,
 		int objs_count, ...
 	)
 {
 	int rc;
-	jsmn_parser jsmn_parser_object;
 	json_jsmn_t jjs;
 	va_list args;
 
-	jsmn_init(&jsmn_parser_object);
-
-    rc = json_parse_jsmn(&jsmn_parser_object, js, jslen, tokens, tokcount);
-    if(0 > rc)
-    {
-        return rc;
-    }
-
-    jjs.js = js;
-	jjs.tokens = tokens;
-	jjs.token_count = jsmn_parser_object.toknext;
+	rc = json_parse_document(&jjs, js, jslen, tokens, tokcount, NULL);
+	if(0 > rc)
+	{
+		return rc;
+	}
 
 	va_start(args, objs_count);
 	rc = json_jsmn_parse_object_va_list
@@ -301,8 +1291,3 @@ int json_parse_object_fmt
 	return rc;
 }
 #endif // #if __STDC_VERSION__ >= 199901L
-
-
-
-
-
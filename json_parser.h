@@ -1,18 +1,159 @@
 #ifndef __JON_PARSER_H_
 #define __JON_PARSER_H_
 
+#include <stdio.h>
 #include "json_jsmn.h" 
+#include "json_jsmn_scan.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
     
 typedef int (*json_array_element_callback_t)(int index, jsmntype_t type, void *value, int len, void *callback_args);
+typedef int (*json_record_callback_t)(unsigned long index, json_jsmn_t *jjs, json_jsmntok_t *json_jsmntok, int json_jsmntok_count, void *callback_args);
+typedef int (*json_stream_member_callback_t)(const char *js, const json_jsmn_token_t *key, const json_jsmn_token_t *value, int span, void *callback_args);
+
+/*
+ * Resumable parser for documents arriving in pieces (e.g. successive socket
+ * reads). The jsmn state, the open containers and the token array are kept
+ * between calls so each call only scans the bytes appended since the
+ * previous one.
+ */
+typedef struct
+{
+	jsmn_parser parser;
+	json_jsmn_scan_state_t scan;
+	unsigned int scanned;					// jslen of the previous call
+	unsigned int limit;						// and the part of it fed to jsmn
+	json_jsmn_token_t *tokens;
+	int tokcount;
+	unsigned int member;					// next root member to report
+	json_stream_member_callback_t callback;
+	void *callback_args;
+}json_stream_t;
+
+/*
+ * Allocator hook for json_token_arena_t, e.g. to back the arena with a per
+ * thread pool. reallocate() follows realloc() semantics (ptr may be NULL),
+ * release() follows free(). A NULL allocator uses realloc()/free().
+ */
+typedef struct
+{
+	void *(*reallocate)(void *ctx, void *ptr, size_t size);
+	void (*release)(void *ctx, void *ptr);
+	void *ctx;
+}json_token_allocator_t;
+
+/*
+ * Growable token storage. The arena keeps its capacity between documents so a
+ * long lived (per thread) arena settles at the size of the largest message
+ * instead of a worst case buffer. tokmax (0: unlimited) caps the growth.
+ */
+typedef struct
+{
+	json_jsmn_token_t *tokens;
+	int tokcount;
+	int tokmax;
+	unsigned int *spans;					// tokcount entries once indexed
+	int spancount;
+	const json_token_allocator_t *allocator;
+}json_token_arena_t;
+
+/*
+ * Tokenize js once into a reusable document handle. When spans is not NULL
+ * (tokcount entries) the document is also indexed, see json_jsmn_index().
+ * Any number of queries can then run against jjs without re-tokenizing:
+ * json_jsmn_parse*(), json_jsmn_parse_object*() and json_jsmn_parse_array().
+ * Returns the number of tokens or a negative JSMN_ERROR_* code.
+ */
+int json_parse_document
+	(
+		json_jsmn_t *jjs,
+		const char *js, unsigned int jslen,
+		json_jsmn_token_t *tokens, int tokcount,
+		unsigned int *spans
+	);
+
+/*
+ * Counting pass: the number of tokens js needs, without storing any, or a
+ * negative JSMN_ERROR_* code.
+ */
+int json_parse_count(const char *js, unsigned int jslen);
+
+void json_token_arena_init
+	(
+		json_token_arena_t *arena,
+		int tokmax,
+		const json_token_allocator_t *allocator
+	);
+
+// make room for at least tokcount tokens, returns 0 or JSMN_ERROR_NOMEM
+int json_token_arena_reserve(json_token_arena_t *arena, int tokcount);
+
+void json_token_arena_free(json_token_arena_t *arena);
+
+/*
+ * json_parse_document() tokenizing on up to threads workers, see
+ * json_jsmn_scan_parallel(). Meant for documents of several megabytes,
+ * smaller ones are tokenized on the caller thread.
+ */
+int json_parse_document_parallel
+	(
+		json_jsmn_t *jjs,
+		const char *js, unsigned int jslen,
+		json_jsmn_token_t *tokens, int tokcount,
+		unsigned int *spans,
+		int threads
+	);
+
+/*
+ * json_parse_document() over an arena: on JSMN_ERROR_NOMEM the arena grows and
+ * tokenization resumes where it stopped instead of rescanning from the start.
+ * With index set the arena also holds the spans. jjs points into the arena
+ * and stays valid until the arena is reused, grown or freed.
+ */
+int json_parse_document_arena
+	(
+		json_jsmn_t *jjs,
+		const char *js, unsigned int jslen,
+		json_token_arena_t *arena,
+		int index
+	);
+
+/*
+ * json_parse_document_arena() tokenizing on up to threads workers, see
+ * json_jsmn_scan_parallel(). That tokenizer cannot resume, so a too small
+ * arena is grown and the whole document tokenized again; the first attempt
+ * sizes the arena from jslen.
+ */
+int json_parse_document_arena_parallel
+	(
+		json_jsmn_t *jjs,
+		const char *js, unsigned int jslen,
+		json_token_arena_t *arena,
+		int index,
+		int threads
+	);
+
+/*
+ * Call callback for each element of the array name: a member of the root
+ * object, a path ("/batch/items") or, when name is NULL, the root itself.
+ * Elements are visited one by one, nested objects and arrays being passed
+ * whole (see json_jsmn_array_foreach() for sub-document access). A non zero
+ * return from callback stops the walk. Returns the number of elements
+ * visited or -1 when there is no such array.
+ */
+int json_jsmn_parse_array
+	(
+		json_jsmn_t *jjs,
+		const char *name,
+		json_array_element_callback_t callback, void *callback_args
+	);
 
 int json_parse
 	(
 		const char *js, unsigned int jslen,
-		jsmntok_t *tokens, int tokcount,
+		json_jsmn_token_t *tokens, int tokcount,
 		const char **keys_filter_list,
 		json_jsmntok_t *json_jsmntok, int json_jsmntok_count
 	);
@@ -20,29 +161,111 @@ int json_parse
 int json_parse_object
 	(
 		const char *js, unsigned int jslen,
-		jsmntok_t *tokens, int tokcount,
+		json_jsmn_token_t *tokens, int tokcount,
 		json_jsmn_object_t *json_jsmn_objects, int json_jsmn_object_count
 	);
 
 int json_parse_object_fmt
 	(
 		const char *js, unsigned int jslen,
-		jsmntok_t *tokens, int tokcount,
+		json_jsmn_token_t *tokens, int tokcount,
 		int objs_count, ...
 	);
 
 int json_parse_array
 	(
 		const char *js, unsigned int jslen,
-		jsmntok_t *tokens, int tokcount,
+		json_jsmn_token_t *tokens, int tokcount,
 		const char *name,
 		json_array_element_callback_t callback, void *callback_args
 	);
 
+/*
+ * Early terminating variants of json_parse and json_parse_object: the input
+ * is tokenized incrementally and tokenization stops as soon as every filter
+ * key (or object) has been found, so the cost follows the position of the
+ * requested members rather than the message size. consumed (optional)
+ * receives the number of bytes of js that were scanned.
+ */
+int json_parse_lazy
+	(
+		const char *js, unsigned int jslen,
+		json_jsmn_token_t *tokens, int tokcount,
+		const char **keys_filter_list,
+		json_jsmntok_t *json_jsmntok, int json_jsmntok_count,
+		unsigned int *consumed
+	);
+
+int json_parse_object_lazy
+	(
+		const char *js, unsigned int jslen,
+		json_jsmn_token_t *tokens, int tokcount,
+		json_jsmn_object_t *json_jsmn_objects, int json_jsmn_object_count,
+		unsigned int *consumed
+	);
+
+/*
+ * callback (optional) is called for each root member as soon as its value is
+ * closed, before the rest of the document arrived; a non zero return stops
+ * further member callbacks.
+ */
+void json_stream_init
+	(
+		json_stream_t *stream,
+		json_jsmn_token_t *tokens, int tokcount,
+		json_stream_member_callback_t callback, void *callback_args
+	);
+
+/*
+ * js/jslen is the whole document received so far: data is only ever
+ * appended, the buffer itself may move between calls. Returns the token count
+ * and fills jjs (optional) once the root is closed, JSMN_ERROR_PART while
+ * more data is needed, or another negative JSMN_ERROR_* code.
+ */
+int json_stream_parse
+	(
+		json_stream_t *stream,
+		const char *js, unsigned int jslen,
+		json_jsmn_t *jjs
+	);
+
+/*
+ * Walk a buffer of concatenated documents (NDJSON or back to back) and call
+ * callback with each record as a ready json_jsmn_t. Tokenization stops at
+ * the end of each record and tokens is reused for the next one, so it only
+ * needs to fit the largest record, even several on a line. When keyset is
+ * not NULL each record is also filtered with json_jsmn_parse_keyset() into
+ * json_jsmntok before the callback. A non zero callback return stops the
+ * walk. Returns the number of records or a negative JSMN_ERROR_* code.
+ */
+int json_parse_records
+	(
+		const char *js, size_t jslen,
+		json_jsmn_token_t *tokens, int tokcount,
+		const json_jsmn_keyset_t *keyset,
+		json_jsmntok_t *json_jsmntok, int json_jsmntok_count,
+		json_record_callback_t callback, void *callback_args
+	);
+
+/*
+ * Same over a file read through buffer, which bounds memory use and must be
+ * able to hold the largest record. The json_jsmn_t passed to callback points
+ * into buffer and is only valid during the callback.
+ */
+long json_parse_records_file
+	(
+		FILE *fp,
+		char *buffer, size_t buffer_size,
+		json_jsmn_token_t *tokens, int tokcount,
+		const json_jsmn_keyset_t *keyset,
+		json_jsmntok_t *json_jsmntok, int json_jsmntok_count,
+		json_record_callback_t callback, void *callback_args
+	);
+
 int json_parse_fmt
 	(
 		const char *js, unsigned int jslen,
-		jsmntok_t *tokens, int tokcount,
+		json_jsmn_token_t *tokens, int tokcount,
 		const char **keys_filter_list,
 		int json_jsmntok_count, ...
 	);
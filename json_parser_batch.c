@@ -0,0 +1,438 @@
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "json_parser_batch.h"
+#include "json_jsmn_thread.h"
+
+#ifdef JSON_JSMN_DEBUG_ENABLED
+#ifndef debugPrintf
+#define debugPrintf    				printf
+#define debugPrintln(fmt,args...)   debugPrintf(fmt "%s", ## args, "\r\n")
+#else
+#define debugPrintln(fmt,args...)   debugPrintf(fmt "%s", ## args, "\r\n")
+#endif
+#else
+#define debugPrintf(...)
+#define debugPrintln(...)
+#endif
+
+#ifndef JSON_BATCH_CHUNK
+#define JSON_BATCH_CHUNK		(64 * 1024)
+#endif
+
+#ifndef JSON_ARRAY_BATCH_CHUNK
+#define JSON_ARRAY_BATCH_CHUNK	256
+#endif
+
+#define JSON_BATCH_SKIP			INT_MIN		// blank line or stopped batch: no callback
+
+struct json_batch_chunk
+{
+	size_t start;
+	unsigned long line;		// lines in the chunk, then index of its first line
+};
+
+struct json_batch_context
+{
+	const json_batch_t *batch;
+	const char *js;
+	size_t jslen;
+	struct json_batch_chunk *chunks;	// chunk_count + 1 entries, the last one ends the buffer
+	unsigned long chunk_count;
+	unsigned long next_chunk;
+	unsigned long records;
+	int stop;
+	unsigned long slots;				// lines of the largest chunk when ordered, else 1
+	json_jsmn_token_t *tokens;					// threads * tokcount
+	json_jsmn_object_t *objs;			// threads * slots * objs_count
+	char *scratch;						// threads * slots * record_size
+	int *matched;						// threads * slots, ordered only
+	json_jsmn_sequence_t sequence;		// chunk whose callbacks are due
+};
+
+static void json_batch_count(void *ctx, int id)
+{
+	struct json_batch_context *bctx = ctx;
+	struct json_batch_chunk *chunk;
+	const char *s, *end;
+	unsigned long k;
+
+	(void)id;
+	while((k = json_jsmn_thread_fetch_add(&bctx->next_chunk, 1)) < bctx->chunk_count)
+	{
+		chunk = &bctx->chunks[k];
+		s = bctx->js + chunk->start;
+		end = bctx->js + chunk[1].start;
+		for(chunk->line = 0; s < end && (s = memchr(s, '\n', end - s)); s++)
+		{
+			chunk->line++;
+		}
+		if(chunk[1].start == bctx->jslen && chunk[1].start > chunk->start && end[-1] != '\n')
+		{
+			// unterminated last line
+			chunk->line++;
+		}
+	}
+}
+
+static int json_batch_record
+	(
+		struct json_batch_context *bctx,
+		json_jsmn_token_t *tokens,
+		json_jsmn_object_t *objs,
+		char *record,
+		const char *line, size_t len
+	)
+{
+	const json_batch_t *batch = bctx->batch;
+	json_jsmn_t jjs;
+	int i, rc;
+
+	for(i = 0; i < batch->objs_count; i++)
+	{
+		objs[i] = batch->objs[i];
+		objs[i].value = record + (uintptr_t)batch->objs[i].value;
+	}
+
+	rc = json_parse_document(&jjs, line, len, tokens, batch->tokcount, NULL);
+	if(0 <= rc)
+	{
+		rc = batch->keyset ?
+				json_jsmn_parse_object_keyset(&jjs, batch->keyset, objs, batch->objs_count) :
+				json_jsmn_parse_object(&jjs, objs, batch->objs_count);
+	}
+	return rc;
+}
+
+static void json_batch_callback
+	(
+		struct json_batch_context *bctx,
+		unsigned long index,
+		json_jsmn_object_t *objs, int matched,
+		void *record
+	)
+{
+	const json_batch_t *batch = bctx->batch;
+
+	if(!__atomic_load_n(&bctx->stop, __ATOMIC_RELAXED) &&
+		batch->callback && (*batch->callback)(index, objs, matched, record, batch->callback_args))
+	{
+		// stop request from callback
+		__atomic_store_n(&bctx->stop, 1, __ATOMIC_RELAXED);
+	}
+}
+
+/*
+ * Slot j of worker id holds the objs, the record (without batch->records)
+ * and the result of line j of its chunk. Unordered, the callback follows
+ * each line and slot 0 is reused; ordered, the whole chunk is parsed first
+ * and only its callbacks wait for the previous chunks.
+ */
+static void json_batch_parse(void *ctx, int id)
+{
+	struct json_batch_context *bctx = ctx;
+	const json_batch_t *batch = bctx->batch;
+	json_jsmn_token_t *tokens = bctx->tokens + (size_t)id * batch->tokcount;
+	json_jsmn_object_t *objs;
+	char *record;
+	const char *s, *end, *eol;
+	unsigned long k, index, j, slot, records = 0;
+	size_t len;
+	int rc;
+
+	while((k = json_jsmn_thread_fetch_add(&bctx->next_chunk, 1)) < bctx->chunk_count)
+	{
+		index = bctx->chunks[k].line;
+		s = bctx->js + bctx->chunks[k].start;
+		end = bctx->js + bctx->chunks[k + 1].start;
+		for(j = 0; s < end; s = eol + 1, j++)
+		{
+			eol = memchr(s, '\n', end - s);
+			if(!eol)
+			{
+				eol = end;
+			}
+
+			slot = (size_t)id * bctx->slots + (batch->ordered ? j : 0);
+			for(len = eol - s; len && (*s == ' ' || *s == '\t' || *s == '\r'); s++, len--);
+			if(!len || __atomic_load_n(&bctx->stop, __ATOMIC_RELAXED))
+			{
+				if(batch->ordered)
+				{
+					bctx->matched[slot] = JSON_BATCH_SKIP;
+				}
+				continue;
+			}
+
+			objs = bctx->objs + slot * batch->objs_count;
+			if(batch->records)
+			{
+				record = (char *)batch->records + (index + j) * batch->record_size;
+			}
+			else
+			{
+				record = bctx->scratch + slot * batch->record_size;
+				memset(record, 0, batch->record_size);
+			}
+			rc = json_batch_record(bctx, tokens, objs, record, s, len);
+			records++;
+
+			if(batch->ordered)
+			{
+				bctx->matched[slot] = rc;
+			}
+			else
+			{
+				json_batch_callback(bctx, index + j, objs, rc, record);
+			}
+		}
+
+		if(batch->ordered)
+		{
+			json_jsmn_sequence_wait(&bctx->sequence, k);
+			for(j = 0, slot = (size_t)id * bctx->slots; j < bctx->chunks[k + 1].line - index; j++, slot++)
+			{
+				if(bctx->matched[slot] != JSON_BATCH_SKIP)
+				{
+					json_batch_callback
+						(
+							bctx, index + j,
+							bctx->objs + slot * batch->objs_count, bctx->matched[slot],
+							batch->records ?
+								(char *)batch->records + (index + j) * batch->record_size :
+								bctx->scratch + slot * batch->record_size
+						);
+				}
+			}
+			json_jsmn_sequence_next(&bctx->sequence);
+		}
+	}
+
+	json_jsmn_thread_fetch_add(&bctx->records, records);
+}
+
+long json_parse_batch
+	(
+		const json_batch_t *batch,
+		const char *js, size_t jslen
+	)
+{
+	struct json_batch_context bctx;
+	const char *eol;
+	unsigned long k, n, lines;
+	int threads;
+	long rc;
+
+	memset(&bctx, 0, sizeof(bctx));
+	bctx.batch = batch;
+	bctx.js = js;
+	bctx.jslen = jslen;
+	bctx.chunk_count = jslen / JSON_BATCH_CHUNK + 1;
+	threads = json_jsmn_thread_count(batch->threads);
+
+	bctx.chunks = malloc((bctx.chunk_count + 1) * sizeof(*bctx.chunks));
+	bctx.tokens = malloc((size_t)threads * batch->tokcount * sizeof(*bctx.tokens));
+	if(!bctx.chunks || !bctx.tokens)
+	{
+		rc = JSMN_ERROR_NOMEM;
+		goto done;
+	}
+
+	// cut at line boundaries: a line belongs to the chunk it starts in, one longer than a chunk leaves the next ones empty
+	bctx.chunks[0].start = 0;
+	for(k = 1; k < bctx.chunk_count; k++)
+	{
+		eol = memchr(js + k * JSON_BATCH_CHUNK - 1, '\n', jslen - (k * JSON_BATCH_CHUNK - 1));
+		bctx.chunks[k].start = eol ? (size_t)(eol - js + 1) : jslen;
+	}
+	bctx.chunks[bctx.chunk_count].start = jslen;
+
+	json_jsmn_thread_run(threads, json_batch_count, &bctx);
+	for(k = 0, lines = 0, bctx.slots = 1; k < bctx.chunk_count; k++)
+	{
+		n = bctx.chunks[k].line;
+		bctx.chunks[k].line = lines;
+		lines += n;
+		if(batch->ordered && bctx.slots < n)
+		{
+			bctx.slots = n;
+		}
+	}
+	bctx.chunks[bctx.chunk_count].line = lines;
+
+	if(batch->records && lines > batch->records_count)
+	{
+		debugPrintln("json_parse_batch: %lu lines for %lu records", lines, batch->records_count);
+		rc = JSMN_ERROR_NOMEM;
+		goto done;
+	}
+
+	bctx.objs = malloc((size_t)threads * bctx.slots * batch->objs_count * sizeof(*bctx.objs) + 1);
+	bctx.scratch = batch->records ? NULL : malloc((size_t)threads * bctx.slots * batch->record_size + 1);
+	bctx.matched = batch->ordered ? malloc((size_t)threads * bctx.slots * sizeof(*bctx.matched)) : NULL;
+	if(!bctx.objs || (!batch->records && !bctx.scratch) || (batch->ordered && !bctx.matched))
+	{
+		rc = JSMN_ERROR_NOMEM;
+		goto done;
+	}
+
+	json_jsmn_sequence_init(&bctx.sequence);
+	bctx.next_chunk = 0;
+	json_jsmn_thread_run(threads, json_batch_parse, &bctx);
+	json_jsmn_sequence_destroy(&bctx.sequence);
+	rc = bctx.records;
+
+done:
+	free(bctx.matched);
+	free(bctx.scratch);
+	free(bctx.objs);
+	free(bctx.tokens);
+	free(bctx.chunks);
+	return rc;
+}
+
+struct json_array_batch_context
+{
+	const json_array_batch_t *batch;
+	const json_jsmn_t *jjs;
+	const json_jsmn_token_t **chunks;	// first element of each chunk
+	unsigned long chunk_count;
+	unsigned long chunk;
+	unsigned long elements;
+	unsigned long next_chunk;
+	unsigned long processed;
+	int stop;
+	json_jsmn_object_t *objs;			// threads * objs_count
+	char *scratch;						// threads * record_size
+};
+
+static void json_array_batch_element
+	(
+		struct json_array_batch_context *actx,
+		int id,
+		const json_jsmn_t *element,
+		unsigned long index
+	)
+{
+	const json_array_batch_t *batch = actx->batch;
+	json_jsmn_object_t *objs = NULL;
+	char *record;
+	int i, rc = 0;
+
+	if(batch->records)
+	{
+		record = (char *)batch->records + index * batch->record_size;
+	}
+	else
+	{
+		record = actx->scratch + (size_t)id * batch->record_size;
+		memset(record, 0, batch->record_size);
+	}
+
+	if(batch->desc)
+	{
+		rc = json_jsmn_struct_decode(batch->desc, element, record);
+	}
+	else if(batch->objs)
+	{
+		objs = actx->objs + (size_t)id * batch->objs_count;
+		for(i = 0; i < batch->objs_count; i++)
+		{
+			objs[i] = batch->objs[i];
+			objs[i].value = record + (uintptr_t)batch->objs[i].value;
+		}
+		rc = batch->keyset ?
+				json_jsmn_parse_object_keyset((json_jsmn_t *)element, batch->keyset, objs, batch->objs_count) :
+				json_jsmn_parse_object((json_jsmn_t *)element, objs, batch->objs_count);
+	}
+
+	if(batch->callback && (*batch->callback)(index, element, objs, rc, record, batch->callback_args))
+	{
+		// stop request from callback
+		__atomic_store_n(&actx->stop, 1, __ATOMIC_RELAXED);
+	}
+}
+
+static void json_array_batch_parse(void *ctx, int id)
+{
+	struct json_array_batch_context *actx = ctx;
+	const json_jsmn_token_t *t;
+	json_jsmn_t element;
+	unsigned long k, index, end, processed = 0;
+
+	while((k = json_jsmn_thread_fetch_add(&actx->next_chunk, 1)) < actx->chunk_count)
+	{
+		index = k * actx->chunk;
+		end = index + actx->chunk < actx->elements ? index + actx->chunk : actx->elements;
+		for(t = actx->chunks[k]; index < end && !__atomic_load_n(&actx->stop, __ATOMIC_RELAXED); index++)
+		{
+			json_jsmn_subdocument(actx->jjs, t, &element);
+			json_array_batch_element(actx, id, &element, index);
+			t += element.token_count;
+			processed++;
+		}
+	}
+
+	json_jsmn_thread_fetch_add(&actx->processed, processed);
+}
+
+long json_parse_array_batch
+	(
+		const json_array_batch_t *batch,
+		const json_jsmn_t *jjs,
+		const json_jsmn_token_t *array
+	)
+{
+	struct json_array_batch_context actx;
+	const json_jsmn_token_t *t, *end;
+	int threads;
+	long rc;
+
+	if(array->type != JSMN_ARRAY)
+	{
+		return JSMN_ERROR_INVAL;
+	}
+
+	memset(&actx, 0, sizeof(actx));
+	actx.batch = batch;
+	actx.jjs = jjs;
+	actx.chunk = batch->chunk ? batch->chunk : JSON_ARRAY_BATCH_CHUNK;
+	threads = json_jsmn_thread_count(batch->threads);
+
+	// every element takes at least one token: this bounds the chunk count
+	end = array + json_jsmn_span(jjs, array);
+	actx.chunks = malloc(((end - array) / actx.chunk + 1) * sizeof(*actx.chunks));
+	actx.objs = malloc((size_t)threads * batch->objs_count * sizeof(*actx.objs) + 1);
+	actx.scratch = batch->records ? NULL : malloc((size_t)threads * batch->record_size + 1);
+	if(!actx.chunks || !actx.objs || (!batch->records && !actx.scratch))
+	{
+		rc = JSMN_ERROR_NOMEM;
+		goto done;
+	}
+
+	for(t = array + 1; t < end; t += json_jsmn_span(jjs, t), actx.elements++)
+	{
+		if(actx.elements % actx.chunk == 0)
+		{
+			actx.chunks[actx.chunk_count++] = t;
+		}
+	}
+
+	if(batch->records && actx.elements > batch->records_count)
+	{
+		debugPrintln("json_parse_array_batch: %lu elements for %lu records", actx.elements, batch->records_count);
+		rc = JSMN_ERROR_NOMEM;
+		goto done;
+	}
+
+	json_jsmn_thread_run(threads, json_array_batch_parse, &actx);
+	rc = actx.processed;
+
+done:
+	free(actx.scratch);
+	free(actx.objs);
+	free(actx.chunks);
+	return rc;
+}
@@ -0,0 +1,103 @@
+#ifndef __JSON_PARSER_BATCH_H_
+#define __JSON_PARSER_BATCH_H_
+
+#include <stddef.h>
+#include "json_parser.h"
+#include "json_jsmn_struct.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// template value of a batch object: offset of the destination in a record
+#define JSON_BATCH_FIELD(type, member)		((void *)offsetof(type, member))
+
+/*
+ * Called once per non blank line: objs holds the statuses of the record
+ * template, matched the json_jsmn_parse_object() result (or a negative
+ * JSMN_ERROR_* when the line does not parse) and record its destination
+ * slot. A non zero return stops the batch.
+ */
+typedef int (*json_batch_callback_t)(unsigned long index, json_jsmn_object_t *objs, int matched, void *record, void *callback_args);
+
+typedef struct
+{
+	int threads;						// workers, including the caller thread
+	int tokcount;						// token arena of each worker
+	int ordered;						// callbacks in input order instead of completion order
+	const json_jsmn_object_t *objs;		// record template, value from JSON_BATCH_FIELD()
+	int objs_count;
+	const json_jsmn_keyset_t *keyset;	// optional, built from objs
+	void *records;						// one slot per line, NULL for a per worker scratch record
+	size_t record_size;
+	unsigned long records_count;		// slots in records
+	json_batch_callback_t callback;
+	void *callback_args;
+}json_batch_t;
+
+/*
+ * Parse a NDJSON buffer on batch->threads workers (see json_jsmn_thread.h).
+ * The buffer is cut into JSON_BATCH_CHUNK sized pieces at line boundaries
+ * which idle workers keep claiming until none is left. The record index is
+ * the line number. Ordered, a worker parses its whole chunk before the
+ * callbacks of that chunk wait for the previous one, which takes objs (and
+ * a scratch record) for each line of the largest chunk per worker. Returns
+ * the number of records or a negative JSMN_ERROR_*.
+ */
+long json_parse_batch
+	(
+		const json_batch_t *batch,
+		const char *js, size_t jslen
+	);
+
+/*
+ * Called once per element of a parallel array walk: element is its
+ * sub-document, record its destination slot. With a record template objs
+ * holds the statuses and matched the json_jsmn_parse_object() result, with
+ * a struct descriptor objs is NULL and matched the json_jsmn_struct_decode()
+ * result. A non zero return stops the walk.
+ */
+typedef int (*json_array_batch_callback_t)
+		(
+			unsigned long index,
+			const json_jsmn_t *element,
+			json_jsmn_object_t *objs, int matched,
+			void *record,
+			void *callback_args
+		);
+
+typedef struct
+{
+	int threads;						// workers, including the caller thread
+	unsigned long chunk;				// elements per work item, 0 for JSON_ARRAY_BATCH_CHUNK
+	const json_jsmn_object_t *objs;		// optional record template, value from JSON_BATCH_FIELD()
+	int objs_count;
+	const json_jsmn_keyset_t *keyset;	// optional, built from objs
+	const json_jsmn_struct_t *desc;		// optional compiled descriptor, used instead of objs
+	void *records;						// one slot per element, NULL for a per worker scratch record
+	size_t record_size;
+	unsigned long records_count;		// slots in records
+	json_array_batch_callback_t callback;
+	void *callback_args;
+}json_array_batch_t;
+
+/*
+ * Decode the elements of the array token array (from an already tokenized
+ * document) on batch->threads workers. One walk over the elements by their
+ * spans cuts the array into chunks of batch->chunk elements, which idle
+ * workers then claim until none is left; index the document first so that
+ * walk is O(elements). Returns the number of elements processed or a
+ * negative JSMN_ERROR_*.
+ */
+long json_parse_array_batch
+	(
+		const json_array_batch_t *batch,
+		const json_jsmn_t *jjs,
+		const json_jsmn_token_t *array
+	);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JSON_PARSER_BATCH_H_ */
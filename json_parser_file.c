@@ -0,0 +1,202 @@
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "json_parser_file.h"
+
+#ifdef JSON_JSMN_MMAP_ENABLED
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef JSON_JSMN_DEBUG_ENABLED
+#ifndef debugPrintf
+#define debugPrintf    				printf
+#define debugPrintln(fmt,args...)   debugPrintf(fmt "%s", ## args, "\r\n")
+#else
+#define debugPrintln(fmt,args...)   debugPrintf(fmt "%s", ## args, "\r\n")
+#endif
+#else
+#define debugPrintf(...)
+#define debugPrintln(...)
+#endif
+
+static void json_file_release(json_file_t *file)
+{
+#ifdef JSON_JSMN_MMAP_ENABLED
+	if(file->mapped)
+	{
+		munmap((void *)file->js, file->jslen);
+	}
+	else
+#endif
+	{
+		free((void *)file->js);
+	}
+	file->js = NULL;
+	file->jslen = 0;
+	file->mapped = 0;
+	memset(&file->jjs, 0, sizeof(file->jjs));
+}
+
+#ifdef JSON_JSMN_MMAP_ENABLED
+static int json_file_load(json_file_t *file, const char *path)
+{
+	struct stat st;
+	void *map;
+	int fd, err;
+
+	fd = open(path, O_RDONLY);
+	if(fd < 0)
+	{
+		return JSON_FILE_ERROR_IO;
+	}
+	if(fstat(fd, &st))
+	{
+		goto error;
+	}
+	if((unsigned long long)st.st_size > INT_MAX)
+	{
+		// token offsets are int
+		close(fd);
+		return JSMN_ERROR_NOMEM;
+	}
+	if(!st.st_size)
+	{
+		// nothing to map, tokenizes to no token
+		close(fd);
+		return 0;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if(map == MAP_FAILED)
+	{
+		goto error;
+	}
+	close(fd);
+
+	file->js = map;
+	file->jslen = st.st_size;
+	file->mapped = 1;
+	return 0;
+
+error:
+	err = errno;
+	close(fd);
+	errno = err;
+	return JSON_FILE_ERROR_IO;
+}
+#else
+static int json_file_load(json_file_t *file, const char *path)
+{
+	FILE *fp;
+	char *js;
+	long size;
+	int err;
+
+	fp = fopen(path, "rb");
+	if(!fp)
+	{
+		return JSON_FILE_ERROR_IO;
+	}
+	if(fseek(fp, 0, SEEK_END) || 0 > (size = ftell(fp)) || fseek(fp, 0, SEEK_SET))
+	{
+		goto error;
+	}
+	if((unsigned long)size > INT_MAX)
+	{
+		// token offsets are int
+		fclose(fp);
+		return JSMN_ERROR_NOMEM;
+	}
+
+	js = malloc(size ? size : 1);
+	if(!js)
+	{
+		fclose(fp);
+		return JSMN_ERROR_NOMEM;
+	}
+	if(fread(js, 1, size, fp) != (size_t)size)
+	{
+		free(js);
+		goto error;
+	}
+	fclose(fp);
+
+	file->js = js;
+	file->jslen = size;
+	return 0;
+
+error:
+	err = ferror(fp) ? errno : EIO;
+	fclose(fp);
+	errno = err;
+	return JSON_FILE_ERROR_IO;
+}
+#endif
+
+void json_file_init
+	(
+		json_file_t *file,
+		int tokmax,
+		const json_token_allocator_t *allocator
+	)
+{
+	memset(file, 0, sizeof(*file));
+	json_token_arena_init(&file->arena, tokmax, allocator);
+}
+
+int json_parse_file
+	(
+		json_file_t *file,
+		const char *path,
+		int index,
+		int threads
+	)
+{
+	int rc;
+
+	json_file_release(file);
+
+	rc = json_file_load(file, path);
+	if(0 > rc)
+	{
+		return rc;
+	}
+	debugPrintln("json_parse_file(): %s: %lu bytes, mapped: %d", path, (unsigned long)file->jslen, file->mapped);
+
+#ifdef JSON_JSMN_MMAP_ENABLED
+	if(file->mapped)
+	{
+		madvise((void *)file->js, file->jslen, MADV_SEQUENTIAL);
+	}
+#endif
+
+	rc = json_parse_document_arena_parallel
+			(
+				&file->jjs,
+				file->js ? file->js : "", file->jslen,
+				&file->arena,
+				index,
+				threads
+			);
+
+#ifdef JSON_JSMN_MMAP_ENABLED
+	if(file->mapped)
+	{
+		// queries jump around the document
+		madvise((void *)file->js, file->jslen, MADV_NORMAL);
+	}
+#endif
+
+	return rc;
+}
+
+void json_file_close(json_file_t *file)
+{
+	json_file_release(file);
+	json_token_arena_free(&file->arena);
+}
@@ -0,0 +1,61 @@
+#ifndef __JSON_PARSER_FILE_H_
+#define __JSON_PARSER_FILE_H_
+
+#include <stddef.h>
+#include "json_parser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// the file could not be opened, sized, mapped or read; errno tells why
+#define JSON_FILE_ERROR_IO		(-4)
+
+/*
+ * A JSON file tokenized in place. Built with JSON_JSMN_MMAP_ENABLED the file
+ * is mapped read-only and never copied: js points into the mapping, and so do
+ * the string views of json_jsmn_token_string(). Other builds read the file
+ * into a malloc()ed buffer. jjs answers the usual json_jsmn_t queries until
+ * the next json_parse_file() or json_file_close().
+ */
+typedef struct
+{
+	json_jsmn_t jjs;
+	const char *js;
+	size_t jslen;
+	int mapped;
+	json_token_arena_t arena;
+}json_file_t;
+
+// tokmax and allocator configure the token arena, see json_token_arena_init()
+void json_file_init
+	(
+		json_file_t *file,
+		int tokmax,
+		const json_token_allocator_t *allocator
+	);
+
+/*
+ * Load and tokenize path into file, releasing the previous file but keeping
+ * the arena. The mapping is advised sequential while tokenizing and back to
+ * normal for the queries. With threads > 1 the document is tokenized by
+ * json_parse_document_arena_parallel(), index as in
+ * json_parse_document_arena(). Returns the number of tokens, a negative
+ * JSMN_ERROR_* code or JSON_FILE_ERROR_IO.
+ */
+int json_parse_file
+	(
+		json_file_t *file,
+		const char *path,
+		int index,
+		int threads
+	);
+
+// unmap or free the file and free the arena
+void json_file_close(json_file_t *file);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JSON_PARSER_FILE_H_ */
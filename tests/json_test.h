@@ -0,0 +1,163 @@
+/*
+ * Shared helpers of the tests run by ctest: a failure counter, a seeded
+ * random source and a generator of random JSON documents, valid or cut and
+ * mangled, so every run covers the same inputs.
+ */
+#ifndef __JSON_TEST_H_
+#define __JSON_TEST_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int json_test_failures;
+
+#define JSON_TEST_CHECK(cond)												\
+	do																		\
+	{																		\
+		if(!(cond))															\
+		{																	\
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);	\
+			json_test_failures++;											\
+		}																	\
+	}while(0)
+
+// exit code of main()
+static inline int json_test_result(const char *name)
+{
+	if(json_test_failures)
+	{
+		printf("%s: %d failure(s)\n", name, json_test_failures);
+		return 1;
+	}
+	printf("%s: ok\n", name);
+	return 0;
+}
+
+static uint64_t json_test_rng = 88172645463325252ull;
+
+static inline uint64_t json_test_random(void)
+{
+	json_test_rng ^= json_test_rng << 13;
+	json_test_rng ^= json_test_rng >> 7;
+	json_test_rng ^= json_test_rng << 17;
+	return json_test_rng;
+}
+
+// 0 .. n - 1
+static inline unsigned int json_test_below(unsigned int n)
+{
+	return (unsigned int)(json_test_random() % n);
+}
+
+struct json_test_buffer
+{
+	char *data;
+	size_t len, cap;
+};
+
+static inline void json_test_put(struct json_test_buffer *b, const char *s, size_t len)
+{
+	if(b->len + len + 1 > b->cap)
+	{
+		b->cap = (b->len + len + 1) * 2;
+		b->data = (char *)realloc(b->data, b->cap);
+		if(!b->data)
+		{
+			abort();
+		}
+	}
+	memcpy(b->data + b->len, s, len);
+	b->len += len;
+	b->data[b->len] = '\0';
+}
+
+static inline void json_test_puts(struct json_test_buffer *b, const char *s)
+{
+	json_test_put(b, s, strlen(s));
+}
+
+static inline void json_test_space(struct json_test_buffer *b)
+{
+	static const char *spaces[] = { "", "", "", " ", "\n", "  \t", "\r\n    " };
+
+	json_test_puts(b, spaces[json_test_below(sizeof(spaces) / sizeof(spaces[0]))]);
+}
+
+// strings long enough for the SIMD paths, with spaces and escapes
+static inline void json_test_string(struct json_test_buffer *b)
+{
+	static const char *parts[] =
+	{
+		"a", "key", "word ", "two words", "\\\"", "\\\\", "\\n", "\\u00e9", "\\ud83d\\ude00",
+		"\xc3\xa9", ",:{}[]", "0123456789abcdefghijklmnopqrstuvwxyz"
+	};
+	unsigned int i, n;
+
+	json_test_puts(b, "\"");
+	for(i = 0, n = json_test_below(4) ? json_test_below(6) : json_test_below(40); i < n; i++)
+	{
+		json_test_puts(b, parts[json_test_below(sizeof(parts) / sizeof(parts[0]))]);
+	}
+	json_test_puts(b, "\"");
+}
+
+static inline void json_test_value(struct json_test_buffer *b, int depth)
+{
+	static const char *primitives[] =
+	{
+		"0", "-1", "42", "3.25", "-0.5e-3", "1e300", "18446744073709551615", "true", "false", "null"
+	};
+	unsigned int i, n, kind;
+
+	kind = depth > 5 ? 2 + json_test_below(2) : json_test_below(5);
+	if(kind < 2)
+	{
+		json_test_puts(b, kind ? "[" : "{");
+		for(i = 0, n = json_test_below(6); i < n; i++)
+		{
+			if(i)
+			{
+				json_test_puts(b, ",");
+			}
+			json_test_space(b);
+			if(!kind)
+			{
+				json_test_string(b);
+				json_test_space(b);
+				json_test_puts(b, ":");
+				json_test_space(b);
+			}
+			json_test_value(b, depth + 1);
+			json_test_space(b);
+		}
+		json_test_puts(b, kind ? "]" : "}");
+	}
+	else if(kind == 2)
+	{
+		json_test_string(b);
+	}
+	else
+	{
+		json_test_puts(b, primitives[json_test_below(sizeof(primitives) / sizeof(primitives[0]))]);
+	}
+}
+
+// root object of a few random members
+static inline void json_test_document(struct json_test_buffer *b)
+{
+	unsigned int i, n;
+
+	json_test_puts(b, "{");
+	for(i = 0, n = 1 + json_test_below(8); i < n; i++)
+	{
+		json_test_puts(b, i ? ", " : " ");
+		json_test_string(b);
+		json_test_puts(b, ": ");
+		json_test_value(b, 1);
+	}
+	json_test_puts(b, " }");
+}
+
+#endif /* __JSON_TEST_H_ */
@@ -0,0 +1,211 @@
+/*
+ * json_parse_batch() and the thread pool under it: every non blank line is
+ * reported once, ordered batches report them in line order (also after a
+ * stop request), and the result does not depend on the worker count, on
+ * lines longer than a chunk or on the pool being reused or resized.
+ */
+#include "json_test.h"
+#include "json_parser_batch.h"
+#include "json_jsmn_thread.h"
+#include "json_jsmn_stats.h"
+
+#define BATCH_LINES					100000
+#define BATCH_TOKENS				64
+
+struct batch_record
+{
+	int64_t id;
+	int64_t value;
+};
+
+struct batch_run
+{
+	const char *kind;					// per line: 'v' valid, 'b' blank, 'x' invalid, 'l' long
+	unsigned char *seen;
+	unsigned long calls;
+	unsigned long last;					// ordered: next index expected at least
+	unsigned long stop;					// callback index stopping the batch, 0 for none
+	int ordered;
+};
+
+static int batch_callback
+	(
+		unsigned long index,
+		json_jsmn_object_t *objs, int matched,
+		struct batch_record *record,
+		struct batch_run *run
+	)
+{
+	JSON_TEST_CHECK(index < BATCH_LINES && run->kind[index] != 'b');
+	if(index >= BATCH_LINES)
+	{
+		return 1;
+	}
+	JSON_TEST_CHECK(!__atomic_fetch_add(&run->seen[index], 1, __ATOMIC_RELAXED));
+	__atomic_fetch_add(&run->calls, 1, __ATOMIC_RELAXED);
+	if(run->ordered)
+	{
+		JSON_TEST_CHECK(index >= run->last);
+		run->last = index + 1;
+	}
+
+	if(run->kind[index] == 'x')
+	{
+		JSON_TEST_CHECK(matched < 0);
+	}
+	else
+	{
+		JSON_TEST_CHECK(matched == 2);
+		JSON_TEST_CHECK(objs[0].status == JSON_JSMN_VALID && objs[1].status == JSON_JSMN_VALID);
+		JSON_TEST_CHECK(record->id == (int64_t)index && record->value == 3 * (int64_t)index);
+	}
+	return run->stop && index == run->stop;
+}
+
+static void batch_document(struct json_test_buffer *b, char *kind)
+{
+	char line[96];
+	unsigned long i, j;
+
+	for(i = 0; i < BATCH_LINES; i++)
+	{
+		switch(json_test_below(1000))
+		{
+		case 0:
+		case 1:
+			kind[i] = 'b';
+			json_test_puts(b, json_test_below(2) ? "" : " \t\r");
+			break;
+		case 2:
+			kind[i] = 'x';
+			json_test_puts(b, "{\"id\": ");
+			break;
+		case 3:
+			// more than a chunk: the next chunks are left empty
+			kind[i] = 'l';
+			snprintf(line, sizeof(line), "{\"id\": %lu, \"pad\": \"", i);
+			json_test_puts(b, line);
+			for(j = 0; j < 1000 + json_test_below(100000); j += 10)
+			{
+				json_test_puts(b, "0123456789");
+			}
+			snprintf(line, sizeof(line), "\", \"value\": %lu}", 3 * i);
+			json_test_puts(b, line);
+			break;
+		default:
+			kind[i] = 'v';
+			snprintf(line, sizeof(line), "{\"id\": %lu, \"value\": %lu}", i, 3 * i);
+			json_test_puts(b, line);
+			break;
+		}
+		if(i + 1 < BATCH_LINES || json_test_below(2))
+		{
+			json_test_puts(b, json_test_below(8) ? "\n" : "\r\n");
+		}
+	}
+}
+
+static void batch_run
+	(
+		const struct json_test_buffer *b,
+		const char *kind,
+		int threads, int ordered, int slots,
+		unsigned long stop
+	)
+{
+	static struct batch_record records[BATCH_LINES];
+	static unsigned char seen[BATCH_LINES];
+	struct batch_record template;
+	json_jsmn_object_t objs[] =
+	{
+		{ "id", NULL, sizeof(template.id), JSMN_PRIMITIVE, JSON_JSMN_EMPTY, NULL, JSON_JSMN_VTYPE_INT64 },
+		{ "value", NULL, sizeof(template.value), JSMN_PRIMITIVE, JSON_JSMN_EMPTY, NULL, JSON_JSMN_VTYPE_INT64 },
+	};
+	struct batch_run run;
+	json_batch_t batch;
+	unsigned long i, lines;
+	long rc;
+
+	while(stop && kind[stop] == 'b')
+	{
+		// only a reported line can stop the batch
+		stop++;
+	}
+	objs[0].value = JSON_BATCH_FIELD(struct batch_record, id);
+	objs[1].value = JSON_BATCH_FIELD(struct batch_record, value);
+	memset(seen, 0, sizeof(seen));
+	memset(&run, 0, sizeof(run));
+	run.kind = kind;
+	run.seen = seen;
+	run.ordered = ordered;
+	run.stop = stop;
+
+	memset(&batch, 0, sizeof(batch));
+	batch.threads = threads;
+	batch.tokcount = BATCH_TOKENS;
+	batch.ordered = ordered;
+	batch.objs = objs;
+	batch.objs_count = 2;
+	batch.records = slots ? records : NULL;
+	batch.record_size = sizeof(records[0]);
+	batch.records_count = BATCH_LINES;
+	batch.callback = (json_batch_callback_t)batch_callback;
+	batch.callback_args = &run;
+
+	json_jsmn_stats_reset();
+	rc = json_parse_batch(&batch, b->data, b->len);
+	for(i = 0, lines = 0; i < BATCH_LINES; i++)
+	{
+		lines += kind[i] != 'b';
+	}
+	if(!stop)
+	{
+		JSON_TEST_CHECK(rc == (long)lines);
+		JSON_TEST_CHECK(run.calls == lines);
+#ifdef JSON_JSMN_STATS_ENABLED
+		{
+			json_jsmn_stats_t stats;
+
+			// the workers' counters end up on this thread
+			json_jsmn_stats_get(&stats);
+			JSON_TEST_CHECK(stats.tokenize_calls == lines);
+		}
+#endif
+	}
+	else if(ordered)
+	{
+		// every line up to the stop and none after it
+		for(i = 0; i < BATCH_LINES; i++)
+		{
+			JSON_TEST_CHECK(seen[i] == (kind[i] != 'b' && i <= stop));
+		}
+	}
+}
+
+int main(void)
+{
+	static char kind[BATCH_LINES];
+	struct json_test_buffer b = { NULL, 0, 0 };
+	int threads, ordered;
+
+	batch_document(&b, kind);
+	for(threads = 1; threads <= 8; threads *= 2)
+	{
+		for(ordered = 0; ordered < 2; ordered++)
+		{
+			batch_run(&b, kind, threads, ordered, 1, 0);
+			batch_run(&b, kind, threads, ordered, 0, 0);
+		}
+		batch_run(&b, kind, threads, 1, json_test_below(2), BATCH_LINES / 2 + json_test_below(BATCH_LINES / 4));
+	}
+
+	// the pool shrinks and grows back between calls
+	JSON_TEST_CHECK(json_jsmn_thread_pool(1) == 1);
+	batch_run(&b, kind, 4, 1, 1, 0);
+	JSON_TEST_CHECK(json_jsmn_thread_pool(3) == json_jsmn_thread_count(3));
+	batch_run(&b, kind, 8, 0, 0, 0);
+	JSON_TEST_CHECK(json_jsmn_thread_pool(1) == 1);
+
+	free(b.data);
+	return json_test_result("json_test_batch");
+}
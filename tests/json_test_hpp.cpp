@@ -0,0 +1,161 @@
+/*
+ * json_jsmn.hpp built as C++17: every supported member type, nested
+ * objects, members left out of the table or of another type, the document
+ * holder and key tables large enough to need the full key hash, on tokens
+ * from json_parse_document().
+ */
+#include "json_test.h"
+#include "json_parser.h"
+#include "json_jsmn.hpp"
+
+#define HPP_TOKENS					256
+
+struct hpp_inner
+{
+	int32_t x;
+	bool flag;
+};
+
+struct hpp_record
+{
+	int64_t id;
+	uint8_t small;
+	double ratio;
+	float f;
+	std::string_view raw;
+	std::string text;
+	char name[8];
+	const json_jsmn_token_t *any;
+	json_jsmn_t sub;
+	hpp_inner inner;
+};
+
+// same length, first and last byte: the cheap key hash cannot tell them apart
+struct hpp_wide
+{
+	int v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11;
+};
+
+JSON_JSMN_FIELDS(hpp_inner,
+	json_jsmn::field("x", &hpp_inner::x),
+	json_jsmn::field("flag", &hpp_inner::flag));
+
+JSON_JSMN_FIELDS(hpp_record,
+	json_jsmn::field("id", &hpp_record::id),
+	json_jsmn::field("small", &hpp_record::small),
+	json_jsmn::field("ratio", &hpp_record::ratio),
+	json_jsmn::field("f", &hpp_record::f),
+	json_jsmn::field("raw", &hpp_record::raw),
+	json_jsmn::field("text", &hpp_record::text),
+	json_jsmn::field("name", &hpp_record::name),
+	json_jsmn::field("any", &hpp_record::any),
+	json_jsmn::field("sub", &hpp_record::sub),
+	json_jsmn::field("inner", &hpp_record::inner));
+
+JSON_JSMN_FIELDS(hpp_wide,
+	json_jsmn::field("k00z", &hpp_wide::v0),
+	json_jsmn::field("k01z", &hpp_wide::v1),
+	json_jsmn::field("k02z", &hpp_wide::v2),
+	json_jsmn::field("k03z", &hpp_wide::v3),
+	json_jsmn::field("k04z", &hpp_wide::v4),
+	json_jsmn::field("k05z", &hpp_wide::v5),
+	json_jsmn::field("k06z", &hpp_wide::v6),
+	json_jsmn::field("k07z", &hpp_wide::v7),
+	json_jsmn::field("k08z", &hpp_wide::v8),
+	json_jsmn::field("k09z", &hpp_wide::v9),
+	json_jsmn::field("k10z", &hpp_wide::v10),
+	json_jsmn::field("k11z", &hpp_wide::v11));
+
+static json_jsmn_token_t hpp_tokens[HPP_TOKENS];
+static unsigned int hpp_spans[HPP_TOKENS];
+
+static int hpp_document(json_jsmn_t *jjs, const char *js)
+{
+	return json_parse_document(jjs, js, strlen(js), hpp_tokens, HPP_TOKENS, hpp_spans);
+}
+
+static void hpp_record_decode(void)
+{
+	static const char js[] =
+		"{\"id\": 9007199254740993, \"small\": 300, \"ratio\": 0.5, \"f\": 1.5,"
+		" \"raw\": \"a\\nb\", \"text\": \"a\\nb\\u00e9\", \"name\": \"truncated name\","
+		" \"skip\": {\"id\": 1, \"deep\": [1, {\"x\": 2}]}, \"any\": [1, 2],"
+		" \"sub\": {\"q\": 1}, \"inner\": {\"x\": -7, \"other\": [3], \"flag\": true},"
+		" \"ratio\": \"not a number\"}";
+	json_jsmn_t jjs;
+	hpp_record r{};
+	int n;
+
+	JSON_TEST_CHECK(hpp_document(&jjs, js) > 0);
+	r.small = 42;
+	n = json_jsmn::decode(jjs, r);
+
+	// small does not fit uint8_t, the second ratio is a string: both skipped
+	JSON_TEST_CHECK(n == 10);
+	JSON_TEST_CHECK(r.id == 9007199254740993ll);
+	JSON_TEST_CHECK(r.small == 42);
+	JSON_TEST_CHECK(r.ratio == 0.5 && r.f == 1.5f);
+	JSON_TEST_CHECK(r.raw == "a\\nb");
+	JSON_TEST_CHECK(r.text == "a\nb\xc3\xa9");
+	JSON_TEST_CHECK(!strcmp(r.name, "truncat"));
+	JSON_TEST_CHECK(r.any != nullptr && json_jsmn::detail::token_type(r.any) == JSMN_ARRAY && json_jsmn_span(&jjs, r.any) == 3);
+	JSON_TEST_CHECK(r.sub.token_count == 3 && !jsmntok_strcmp(js, &r.sub.tokens[1], "q"));
+	JSON_TEST_CHECK(r.inner.x == -7 && r.inner.flag);
+
+	// only objects decode
+	JSON_TEST_CHECK(json_jsmn::decode(jjs, &jjs.tokens[1], r) == JSMN_ERROR_INVAL);
+	JSON_TEST_CHECK(json_jsmn::decode(jjs, r.any, r) == JSMN_ERROR_INVAL);
+	JSON_TEST_CHECK(json_jsmn::decode(jjs, nullptr, r) == JSMN_ERROR_INVAL);
+
+	JSON_TEST_CHECK(json_jsmn::find_key<hpp_record>(js, &jjs.tokens[1]) == 0);
+	JSON_TEST_CHECK(json_jsmn::find_key<hpp_inner>(js, &jjs.tokens[1]) < 0);
+}
+
+static void hpp_wide_decode(void)
+{
+	static const char js[] =
+		"{\"k00z\": 0, \"k01z\": 1, \"k02z\": 2, \"k03z\": 3, \"k04z\": 4, \"k05z\": 5,"
+		" \"k06z\": 6, \"k07z\": 7, \"k08z\": 8, \"k09z\": 9, \"k10z\": 10, \"k11z\": 11,"
+		" \"k12z\": 12, \"k0z\": 13}";
+	json_jsmn_t jjs;
+	hpp_wide w{};
+
+	JSON_TEST_CHECK(json_jsmn::detail::key_matcher<hpp_wide>::table.full);
+	JSON_TEST_CHECK(hpp_document(&jjs, js) > 0);
+	JSON_TEST_CHECK(json_jsmn::decode(jjs, w) == 12);
+	JSON_TEST_CHECK
+		(
+			w.v0 == 0 && w.v1 == 1 && w.v2 == 2 && w.v3 == 3 && w.v4 == 4 && w.v5 == 5 &&
+			w.v6 == 6 && w.v7 == 7 && w.v8 == 8 && w.v9 == 9 && w.v10 == 10 && w.v11 == 11
+		);
+}
+
+// the holder over tokens from any C entry point, with and without the index
+static void hpp_holder(void)
+{
+	static const char js[] = "{\"a\": {\"x\": 1, \"flag\": false}, \"b\": {\"x\": 2, \"flag\": true}}";
+	json_jsmn_t jjs;
+	hpp_inner a{}, b{};
+	int count;
+
+	count = json_parse_document(&jjs, js, strlen(js), hpp_tokens, HPP_TOKENS, NULL);
+	JSON_TEST_CHECK(count == 13);
+
+	json_jsmn::document doc(js, hpp_tokens, count);
+	JSON_TEST_CHECK(doc.root() == hpp_tokens);
+	JSON_TEST_CHECK(doc.decode(&hpp_tokens[2], a) == 2 && a.x == 1 && !a.flag);
+	JSON_TEST_CHECK(doc.index(hpp_spans, HPP_TOKENS) >= 0);
+	JSON_TEST_CHECK(doc.decode(&hpp_tokens[8], b) == 2 && b.x == 2 && b.flag);
+	JSON_TEST_CHECK(json_jsmn_span(doc.get(), doc.root()) == 13);
+
+	// no member of the root is in the table
+	JSON_TEST_CHECK(doc.decode(a) == 0);
+}
+
+int main(void)
+{
+	hpp_record_decode();
+	hpp_wide_decode();
+	hpp_holder();
+	return json_test_result("json_test_hpp");
+}
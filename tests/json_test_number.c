@@ -0,0 +1,221 @@
+/*
+ * json_jsmn_number_*() against the C library: doubles and floats must be
+ * the correctly rounded strtod()/strtof() result bit for bit, whatever the
+ * length of the literal, integers must be exact up to their limits and
+ * report overflow.
+ */
+#include <float.h>
+#include <math.h>
+#include "json_test.h"
+#include "json_jsmn_number.h"
+
+#define NUMBER_ITERATIONS			200000
+
+static void number_double(const char *s)
+{
+	double expected, d;
+	float expected_f, f;
+	int rc;
+
+	expected = strtod(s, NULL);
+	rc = json_jsmn_number_double(s, strlen(s), &d);
+	JSON_TEST_CHECK(rc == (isinf(expected) ? JSON_JSMN_NUMBER_RANGE : 0));
+	JSON_TEST_CHECK(!memcmp(&expected, &d, sizeof(d)));
+
+	expected_f = strtof(s, NULL);
+	rc = json_jsmn_number_float(s, strlen(s), &f);
+	JSON_TEST_CHECK(rc == (isinf(expected_f) ? JSON_JSMN_NUMBER_RANGE : 0));
+	JSON_TEST_CHECK(!memcmp(&expected_f, &f, sizeof(f)));
+}
+
+// the shortest round trip of a random bit pattern and a few precisions
+static void number_bits(void)
+{
+	char s[64];
+	uint64_t bits;
+	double d;
+
+	bits = json_test_random();
+	memcpy(&d, &bits, sizeof(d));
+	if(isnan(d) || isinf(d))
+	{
+		return;
+	}
+	snprintf(s, sizeof(s), "%.17g", d);
+	number_double(s);
+	snprintf(s, sizeof(s), "%.*g", 1 + json_test_below(17), d);
+	number_double(s);
+	snprintf(s, sizeof(s), "%.*e", json_test_below(25), d);
+	number_double(s);
+}
+
+// random JSON number text: long mantissas, halfway cases, extreme exponents
+static void number_text(void)
+{
+	char s[1024];
+	int n, i, digits;
+
+	n = 0;
+	if(json_test_below(2))
+	{
+		s[n++] = '-';
+	}
+	digits = 1 + json_test_below(json_test_below(4) ? 20 : json_test_below(50) ? 40 : 900);
+	s[n++] = digits > 1 ? '1' + json_test_below(9) : '0' + json_test_below(10);
+	for(i = 1; i < digits; i++)
+	{
+		// runs of 0 and 9 land next to powers of ten and halfway points
+		s[n++] = json_test_below(3) ? "09"[json_test_below(2)] : (char)('0' + json_test_below(10));
+	}
+	if(json_test_below(2))
+	{
+		s[n++] = '.';
+		for(i = 0, digits = 1 + json_test_below(json_test_below(50) ? 20 : 50); i < digits; i++)
+		{
+			s[n++] = '0' + json_test_below(10);
+		}
+	}
+	if(json_test_below(2))
+	{
+		n += snprintf(s + n, sizeof(s) - n, "e%d", (int)json_test_below(700) - 350);
+	}
+	s[n] = '\0';
+	number_double(s);
+}
+
+/*
+ * Exact decimal expansion of the midpoint of two adjacent floats (a double):
+ * the tie itself, then a 1 far after the point, past what a truncated
+ * mantissa or a double rounding keeps.
+ */
+static void number_float_tie(void)
+{
+	char s[1100], *e;
+	uint32_t bits;
+	float f, next;
+
+	// finite, positive and below FLT_MAX
+	bits = (uint32_t)json_test_random() & 0x7f7fffff;
+	memcpy(&f, &bits, sizeof(f));
+	bits++;
+	memcpy(&next, &bits, sizeof(next));
+	snprintf(s, sizeof(s) - 8, "%.900e", ((double)f + (double)next) / 2);
+	number_double(s);
+
+	// the trailing zeros then a 1: just above the tie
+	e = strchr(s, 'e');
+	memmove(e + 1, e, strlen(e) + 1);
+	e[0] = '1';
+	number_double(s);
+}
+
+static void number_integers(void)
+{
+	static const struct
+	{
+		const char *s;
+		int rc;
+		int64_t value;
+	}ints[] =
+	{
+		{ "0", 0, 0 },
+		{ "-0", 0, 0 },
+		{ "12345678", 0, 12345678 },
+		{ "-123456789012345678", 0, -123456789012345678ll },
+		{ "9223372036854775807", 0, INT64_MAX },
+		{ "-9223372036854775808", 0, INT64_MIN },
+		{ "9223372036854775808", JSON_JSMN_NUMBER_RANGE, 0 },
+		{ "-9223372036854775809", JSON_JSMN_NUMBER_RANGE, 0 },
+		{ "99999999999999999999", JSON_JSMN_NUMBER_RANGE, 0 },
+		{ "1.5", JSMN_ERROR_INVAL, 0 },
+		{ "1e3", JSMN_ERROR_INVAL, 0 },
+		{ "01", JSMN_ERROR_INVAL, 0 },
+		{ "-", JSMN_ERROR_INVAL, 0 },
+		{ "", JSMN_ERROR_INVAL, 0 },
+	};
+	char s[32];
+	int64_t i, v;
+	uint64_t u;
+	int16_t i16;
+	uint8_t u8;
+	unsigned int k;
+
+	for(k = 0; k < sizeof(ints) / sizeof(ints[0]); k++)
+	{
+		v = -1;
+		JSON_TEST_CHECK(json_jsmn_number_int64(ints[k].s, strlen(ints[k].s), &v) == ints[k].rc);
+		JSON_TEST_CHECK(ints[k].rc || v == ints[k].value);
+	}
+
+	JSON_TEST_CHECK(json_jsmn_number_uint64("18446744073709551615", 20, &u) == 0 && u == UINT64_MAX);
+	JSON_TEST_CHECK(json_jsmn_number_uint64("18446744073709551616", 20, &u) == JSON_JSMN_NUMBER_RANGE);
+	JSON_TEST_CHECK(json_jsmn_number_uint64("-1", 2, &u) != 0);
+
+	// every width checks its own range
+	JSON_TEST_CHECK(json_jsmn_number_decode("32767", 5, JSON_JSMN_VTYPE_INT16, &i16, sizeof(i16)) == 0 && i16 == 32767);
+	JSON_TEST_CHECK(json_jsmn_number_decode("-32769", 6, JSON_JSMN_VTYPE_INT16, &i16, sizeof(i16)) == JSON_JSMN_NUMBER_RANGE);
+	JSON_TEST_CHECK(json_jsmn_number_decode("256", 3, JSON_JSMN_VTYPE_UINT8, &u8, sizeof(u8)) == JSON_JSMN_NUMBER_RANGE);
+	JSON_TEST_CHECK(json_jsmn_number_decode("true", 4, JSON_JSMN_VTYPE_UINT8, &u8, sizeof(u8)) == 0 && u8 == 1);
+	JSON_TEST_CHECK(json_jsmn_number_decode("null", 4, JSON_JSMN_VTYPE_BOOL, &u8, sizeof(u8)) == JSMN_ERROR_INVAL);
+
+	for(k = 0; k < NUMBER_ITERATIONS; k++)
+	{
+		i = (int64_t)json_test_random() >> json_test_below(64);
+		snprintf(s, sizeof(s), "%lld", (long long)i);
+		JSON_TEST_CHECK(json_jsmn_number_int64(s, strlen(s), &v) == 0 && v == i);
+	}
+}
+
+int main(void)
+{
+	int i;
+
+	number_integers();
+
+	number_double("0");
+	number_double("-0");
+	number_double("4.9406564584124654e-324");
+	number_double("2.4703282292062327e-324");
+	number_double("2.4703282292062328e-324");
+	number_double("1.7976931348623157e308");
+	number_double("1.7976931348623159e308");
+	number_double("9007199254740993");
+	number_double("3.4028235677973366e38");
+	number_double("1e-400");
+	number_double("1e400");
+
+	// one rounding to binary32: through a double this is 1.0f
+	number_double("1.0000000596046447753906250001");
+	{
+		float f;
+
+		JSON_TEST_CHECK(json_jsmn_number_float("1.0000000596046447753906250001", 30, &f) == 0 && f == 1.00000012f);
+	}
+	// the deciding digit is past 128 characters
+	{
+		struct json_test_buffer b = { NULL, 0, 0 };
+		double d;
+
+		json_test_puts(&b, "9007199254740993.");
+		for(i = 0; i < 150; i++)
+		{
+			json_test_puts(&b, "0");
+		}
+		json_test_puts(&b, "1");
+		number_double(b.data);
+		JSON_TEST_CHECK(json_jsmn_number_double(b.data, b.len, &d) == 0 && d == 9007199254740994.0);
+		free(b.data);
+	}
+
+	for(i = 0; i < NUMBER_ITERATIONS; i++)
+	{
+		number_bits();
+		number_text();
+		if(i % 4 == 0)
+		{
+			number_float_tie();
+		}
+	}
+
+	return json_test_result("json_test_number");
+}
@@ -0,0 +1,365 @@
+/*
+ * json_parser.c entry points that feed jsmn in chunks: the chunk boundaries
+ * must never change the result, in particular for strings longer than a
+ * chunk that contain delimiters, and records must not need more tokens than
+ * the largest of them. json_stream_parse() fed a document in random pieces
+ * must give the tokens of a single call.
+ */
+#include "json_test.h"
+#include "json_parser.h"
+
+#define PARSER_ITERATIONS			5000
+#define PARSER_TOKENS				1024
+#define PARSER_RECORDS				64
+
+static json_jsmn_token_t parser_tokens[PARSER_TOKENS];
+
+struct parser_records
+{
+	struct json_test_buffer b;
+	size_t start[PARSER_RECORDS];
+	size_t len[PARSER_RECORDS];
+	int count[PARSER_RECORDS];
+	int n;
+};
+
+// "word word ..." of len bytes, quotes included
+static void parser_long_string(struct json_test_buffer *b, size_t len)
+{
+	size_t i;
+
+	json_test_puts(b, "\"");
+	for(i = 2; i < len; i++)
+	{
+		json_test_puts(b, i % 5 == 4 ? " " : "w");
+	}
+	json_test_puts(b, "\"");
+}
+
+static void parser_lazy_long_string(void)
+{
+	static const size_t lengths[] = { 100, 127, 128, 129, 300, 5000 };
+	const char *keys[] = { "b", NULL };
+	struct json_test_buffer b = { NULL, 0, 0 };
+	json_jsmntok_t found[1];
+	unsigned int consumed, i;
+	int rc;
+
+	for(i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++)
+	{
+		b.len = 0;
+		json_test_puts(&b, "{\"a\":");
+		parser_long_string(&b, lengths[i]);
+		json_test_puts(&b, ",\"b\":1}");
+
+		rc = json_parse_lazy(b.data, b.len, parser_tokens, PARSER_TOKENS, keys, found, 1, &consumed);
+		JSON_TEST_CHECK(rc == 1);
+		JSON_TEST_CHECK(rc == 1 && found[0].t_value->type == JSMN_PRIMITIVE);
+		JSON_TEST_CHECK(rc == 1 && b.data[found[0].t_value->start] == '1');
+		JSON_TEST_CHECK(consumed <= b.len);
+
+		// the key is never there: the whole document is scanned
+		keys[0] = "c";
+		rc = json_parse_lazy(b.data, b.len, parser_tokens, PARSER_TOKENS, keys, found, 1, NULL);
+		JSON_TEST_CHECK(rc == 0);
+		keys[0] = "b";
+
+		// the input ends inside the string
+		rc = json_parse_lazy(b.data, 5 + lengths[i] / 2, parser_tokens, PARSER_TOKENS, keys, found, 1, NULL);
+		JSON_TEST_CHECK(rc == JSMN_ERROR_PART);
+	}
+
+	// jsmn stops at a NUL byte: an error, not a loop
+	b.len = 0;
+	json_test_puts(&b, "{\"a\":");
+	parser_long_string(&b, 300);
+	json_test_puts(&b, ",\"b\":1}");
+	b.data[150] = '\0';
+	rc = json_parse_lazy(b.data, b.len, parser_tokens, PARSER_TOKENS, keys, found, 1, NULL);
+	JSON_TEST_CHECK(rc == JSMN_ERROR_PART);
+
+	free(b.data);
+}
+
+// every root member found by json_parse_lazy() is the one json_parse() finds
+static void parser_lazy_document(const struct json_test_buffer *b)
+{
+	static json_jsmn_token_t document[PARSER_TOKENS], tokens[PARSER_TOKENS];
+	json_jsmntok_t expected[1], found[1];
+	const json_jsmn_token_t *k, *end;
+	json_jsmn_t jjs;
+	char key[256];
+	const char *keys[] = { key, NULL };
+	int n, rc;
+
+	if(json_parse_document(&jjs, b->data, b->len, document, PARSER_TOKENS, NULL) <= 0)
+	{
+		return;
+	}
+	for(k = document + 1, end = document + json_jsmn_span(&jjs, document); k + 1 < end; k += json_jsmn_span(&jjs, k))
+	{
+		n = k->end - k->start;
+		if(n >= (int)sizeof(key) || memchr(b->data + k->start, '\\', n))
+		{
+			// keys are compared unescaped
+			continue;
+		}
+		memcpy(key, b->data + k->start, n);
+		key[n] = '\0';
+
+		rc = json_parse(b->data, b->len, tokens, PARSER_TOKENS, keys, expected, 1);
+		JSON_TEST_CHECK(rc == 1);
+		rc = json_parse_lazy(b->data, b->len, parser_tokens, PARSER_TOKENS, keys, found, 1, NULL);
+		JSON_TEST_CHECK(rc == 1);
+		if(rc == 1)
+		{
+			JSON_TEST_CHECK(found[0].t_value->start == expected[0].t_value->start);
+			JSON_TEST_CHECK(found[0].t_value->end == expected[0].t_value->end);
+			JSON_TEST_CHECK(found[0].t_value_type == expected[0].t_value_type);
+		}
+	}
+}
+
+// each record reported is the one generated, with its own tokens only
+static int parser_record
+	(
+		unsigned long index,
+		json_jsmn_t *jjs,
+		json_jsmntok_t *json_jsmntok, int json_jsmntok_count,
+		struct parser_records *records
+	)
+{
+	(void)json_jsmntok;
+	(void)json_jsmntok_count;
+
+	JSON_TEST_CHECK(index < (unsigned long)records->n);
+	if(index >= (unsigned long)records->n)
+	{
+		return 1;
+	}
+	JSON_TEST_CHECK(jjs->token_count == (unsigned int)records->count[index]);
+	JSON_TEST_CHECK(jjs->tokens[0].start == 0);
+	JSON_TEST_CHECK(jjs->tokens[0].end == (int)records->len[index]);
+	JSON_TEST_CHECK(!memcmp(jjs->js, records->b.data + records->start[index], records->len[index]));
+	return 0;
+}
+
+static void parser_record_add(struct parser_records *records, size_t start)
+{
+	records->start[records->n] = start;
+	records->len[records->n] = records->b.len - start;
+	records->count[records->n] = json_parse_count(records->b.data + start, records->b.len - start);
+	records->n++;
+}
+
+static long parser_records_parse(struct parser_records *records, int tokcount, size_t buffer_size)
+{
+	FILE *fp;
+	char *buffer;
+	long n;
+
+	if(!buffer_size)
+	{
+		return json_parse_records
+				(
+					records->b.data, records->b.len,
+					parser_tokens, tokcount,
+					NULL, NULL, 0,
+					(json_record_callback_t)parser_record, records
+				);
+	}
+
+	fp = tmpfile();
+	buffer = malloc(buffer_size);
+	if(!fp || !buffer)
+	{
+		JSON_TEST_CHECK(!"tmpfile");
+		exit(1);
+	}
+	fwrite(records->b.data, 1, records->b.len, fp);
+	rewind(fp);
+	n = json_parse_records_file
+		(
+			fp,
+			buffer, buffer_size,
+			parser_tokens, tokcount,
+			NULL, NULL, 0,
+			(json_record_callback_t)parser_record, records
+		);
+	fclose(fp);
+	free(buffer);
+	return n;
+}
+
+static void parser_records_long_string(void)
+{
+	static const size_t lengths[] = { 4095, 4096, 4097, 5000, 12000 };
+	struct parser_records records;
+	size_t start;
+	unsigned int i;
+
+	memset(&records, 0, sizeof(records));
+	for(i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++)
+	{
+		start = records.b.len;
+		json_test_puts(&records.b, "{\"a\":");
+		parser_long_string(&records.b, lengths[i]);
+		json_test_puts(&records.b, ",\"b\":1}");
+		parser_record_add(&records, start);
+		json_test_puts(&records.b, "\n");
+	}
+
+	JSON_TEST_CHECK(parser_records_parse(&records, PARSER_TOKENS, 0) == records.n);
+	JSON_TEST_CHECK(parser_records_parse(&records, PARSER_TOKENS, 16384) == records.n);
+	free(records.b.data);
+}
+
+static void parser_records_back_to_back(void)
+{
+	static const char *separators[] = { "", " ", "\n", "\r\n", "\t\n " };
+	struct parser_records records;
+	size_t start;
+	int i, tokmax;
+
+	// several records on a line need no more tokens than the largest one
+	memset(&records, 0, sizeof(records));
+	json_test_puts(&records.b, "{\"a\":1}");
+	parser_record_add(&records, 0);
+	json_test_puts(&records.b, "{\"b\":2}");
+	parser_record_add(&records, 7);
+	json_test_puts(&records.b, "\n{\"c\":3}");
+	parser_record_add(&records, 15);
+	json_test_puts(&records.b, " {\"d\":4}");
+	parser_record_add(&records, 23);
+	json_test_puts(&records.b, "\n");
+	JSON_TEST_CHECK(parser_records_parse(&records, 3, 0) == 4);
+	JSON_TEST_CHECK(parser_records_parse(&records, 3, 64) == 4);
+
+	for(i = 0; i < PARSER_ITERATIONS / 10; i++)
+	{
+		records.b.len = 0;
+		records.n = 0;
+		tokmax = 0;
+		while(records.n < PARSER_RECORDS && json_test_below(PARSER_RECORDS / 4))
+		{
+			json_test_puts(&records.b, separators[json_test_below(sizeof(separators) / sizeof(separators[0]))]);
+			start = records.b.len;
+			json_test_document(&records.b);
+			parser_record_add(&records, start);
+			if(tokmax < records.count[records.n - 1])
+			{
+				tokmax = records.count[records.n - 1];
+			}
+		}
+		JSON_TEST_CHECK(parser_records_parse(&records, tokmax, 0) == records.n);
+		JSON_TEST_CHECK(parser_records_parse(&records, tokmax, 64 * 1024) == records.n);
+		if(tokmax > 1)
+		{
+			JSON_TEST_CHECK(parser_records_parse(&records, tokmax - 1, 0) == JSMN_ERROR_NOMEM);
+		}
+	}
+	free(records.b.data);
+}
+
+static int parser_stream_member
+	(
+		const char *js,
+		const json_jsmn_token_t *key, const json_jsmn_token_t *value, int span,
+		int *members
+	)
+{
+	(void)js;
+	(void)key;
+	(void)value;
+	(void)span;
+
+	(*members)++;
+	return 0;
+}
+
+// cut points drawn at random, several bytes may arrive at once
+static void parser_stream(const struct json_test_buffer *b)
+{
+	static json_jsmn_token_t document[PARSER_TOKENS];
+	const json_jsmn_token_t *k;
+	json_stream_t stream;
+	json_jsmn_t jjs;
+	unsigned int len;
+	int count, expected, members, rc;
+
+	count = json_parse_document(&jjs, b->data, b->len, document, PARSER_TOKENS, NULL);
+	JSON_TEST_CHECK(count > 0);
+	for(k = document + 1, expected = 0; k < document + count; k += 1 + json_jsmn_span(&jjs, k + 1))
+	{
+		expected++;
+	}
+
+	members = 0;
+	json_stream_init(&stream, parser_tokens, PARSER_TOKENS, (json_stream_member_callback_t)parser_stream_member, &members);
+	for(len = 0, rc = JSMN_ERROR_PART; len < b->len && rc == JSMN_ERROR_PART; )
+	{
+		len += 1 + json_test_below(json_test_below(2) ? 4 : 64);
+		if(len > b->len)
+		{
+			len = b->len;
+		}
+		rc = json_stream_parse(&stream, b->data, len, NULL);
+		JSON_TEST_CHECK(rc == (len < b->len ? JSMN_ERROR_PART : count));
+	}
+	JSON_TEST_CHECK(members == expected);
+	JSON_TEST_CHECK(!memcmp(document, parser_tokens, count * sizeof(document[0])));
+}
+
+// more siblings than the walk back allows and more levels than the open stack holds
+static void parser_stream_shapes(void)
+{
+	struct json_test_buffer b = { NULL, 0, 0 };
+	int i, j;
+
+	for(i = 0; i < 20; i++)
+	{
+		b.len = 0;
+		json_test_puts(&b, "{\"wide\": [");
+		for(j = 0; j < 300; j++)
+		{
+			json_test_puts(&b, j ? ", " : "");
+			json_test_puts(&b, j % 3 ? "12345" : "\"a \\\" b\\u00e9\"");
+		}
+		json_test_puts(&b, "], \"deep\": ");
+		for(j = 0; j < 80; j++)
+		{
+			json_test_puts(&b, j % 2 ? "[" : "{\"k\": ");
+		}
+		json_test_puts(&b, "1");
+		for(j = 80; j-- > 0; )
+		{
+			json_test_puts(&b, j % 2 ? "]" : "}");
+		}
+		json_test_puts(&b, ", \"long\": ");
+		parser_long_string(&b, 1000);
+		json_test_puts(&b, "}");
+		parser_stream(&b);
+	}
+	free(b.data);
+}
+
+int main(void)
+{
+	struct json_test_buffer b = { NULL, 0, 0 };
+	int i;
+
+	parser_lazy_long_string();
+	parser_stream_shapes();
+	for(i = 0; i < PARSER_ITERATIONS; i++)
+	{
+		b.len = 0;
+		json_test_document(&b);
+		parser_lazy_document(&b);
+		parser_stream(&b);
+	}
+	free(b.data);
+
+	parser_records_long_string();
+	parser_records_back_to_back();
+	return json_test_result("json_test_parser");
+}
@@ -0,0 +1,294 @@
+/*
+ * json_jsmn_patch() round trips: the slices must join into valid JSON with
+ * exactly the edited members and elements, the commas of deleted ones
+ * removed and those of inserted ones added, whatever the edit order.
+ */
+#include "json_test.h"
+#include "json_jsmn_patch.h"
+#include "json_parser.h"
+
+#define PATCH_ITERATIONS			5000
+#define PATCH_TOKENS				1024
+#define PATCH_MEMBERS				12
+
+static json_jsmn_token_t patch_tokens[PATCH_TOKENS];
+
+// joined slices, NULL with the error in *rc
+static char *patch_apply(const char *js, const json_jsmn_patch_t *edits, int n, int *rc)
+{
+	static json_jsmn_slice_t slices[JSON_JSMN_PATCH_SLICES(PATCH_MEMBERS * 2)];
+	static char out[64 * 1024];
+	json_jsmn_t jjs;
+	size_t len;
+	int i;
+
+	if(json_parse_document(&jjs, js, strlen(js), patch_tokens, PATCH_TOKENS, NULL) < 0)
+	{
+		JSON_TEST_CHECK(!"document");
+		*rc = JSMN_ERROR_INVAL;
+		return NULL;
+	}
+	*rc = json_jsmn_patch(&jjs, strlen(js), edits, n, slices, JSON_JSMN_PATCH_SLICES(n));
+	if(*rc < 0)
+	{
+		return NULL;
+	}
+	for(i = 0, len = 0; i < *rc; i++)
+	{
+		if(len + slices[i].iov_len >= sizeof(out))
+		{
+			JSON_TEST_CHECK(!"output size");
+			return NULL;
+		}
+		memcpy(out + len, slices[i].iov_base, slices[i].iov_len);
+		len += slices[i].iov_len;
+	}
+	out[len] = '\0';
+	JSON_TEST_CHECK(len == json_jsmn_slices_length(slices, *rc));
+
+	// the result is a document again
+	JSON_TEST_CHECK(json_parse_document(&jjs, out, len, patch_tokens, PATCH_TOKENS, NULL) > 0);
+	return out;
+}
+
+static void patch_case(const char *js, const json_jsmn_patch_t *edits, int n, const char *expected)
+{
+	char *out;
+	int rc;
+
+	out = patch_apply(js, edits, n, &rc);
+	if(!expected)
+	{
+		JSON_TEST_CHECK(rc == JSMN_ERROR_INVAL);
+		return;
+	}
+	JSON_TEST_CHECK(out && !strcmp(out, expected));
+	if(out && strcmp(out, expected))
+	{
+		printf("  got      %s  expected %s", out, expected);
+	}
+}
+
+#define PATCH_REPLACE(path, v)		{ JSON_JSMN_PATCH_REPLACE, path, NULL, v, sizeof(v) - 1 }
+#define PATCH_DELETE(path)			{ JSON_JSMN_PATCH_DELETE, path, NULL, NULL, 0 }
+#define PATCH_INSERT(path, k, v)	{ JSON_JSMN_PATCH_INSERT, path, k, v, sizeof(v) - 1 }
+#define PATCH_CASE(js, expected, ...)																\
+	do																								\
+	{																								\
+		json_jsmn_patch_t edits[] = { __VA_ARGS__ };												\
+		patch_case(js, edits, sizeof(edits) / sizeof(edits[0]), expected);							\
+	}while(0)
+
+static void patch_cases(void)
+{
+	const char *doc = "{\"ts\": 1, \"route\": \"a\", \"body\": {\"x\": [1, 2, 3], \"y\": {}}, \"z\": null}\n";
+
+	PATCH_CASE(doc, "{\"ts\": 1700000000, \"route\": \"b\", \"body\": {\"x\": [1, 2, 3], \"y\": {}}, \"z\": null}\n",
+		PATCH_REPLACE("/ts", "1700000000"), PATCH_REPLACE("/route", "\"b\""));
+
+	// the comma after a member, or before the last one, goes with it
+	PATCH_CASE(doc, "{\"route\": \"a\", \"body\": {\"x\": [1, 2, 3], \"y\": {}}, \"z\": null}\n",
+		PATCH_DELETE("/ts"));
+	PATCH_CASE(doc, "{\"ts\": 1, \"route\": \"a\", \"body\": {\"x\": [1, 2, 3], \"y\": {}}}\n",
+		PATCH_DELETE("/z"));
+	PATCH_CASE(doc, "{\"ts\": 1, \"z\": null}\n",
+		PATCH_DELETE("/route"), PATCH_DELETE("/body"));
+	PATCH_CASE(doc, "{\"ts\": 1}\n",
+		PATCH_DELETE("/route"), PATCH_DELETE("/body"), PATCH_DELETE("/z"));
+	PATCH_CASE(doc, "{}\n",
+		PATCH_DELETE("/z"), PATCH_DELETE("/route"), PATCH_DELETE("/ts"), PATCH_DELETE("/body"));
+	PATCH_CASE(doc, "{\"n\":1,\"m\":2}\n",
+		PATCH_DELETE("/ts"), PATCH_DELETE("/route"), PATCH_DELETE("/body"), PATCH_DELETE("/z"),
+		PATCH_INSERT("", "n", "1"), PATCH_INSERT("", "m", "2"));
+	PATCH_CASE(doc, "{\"ts\": 1, \"route\": \"a\", \"body\": {\"x\": [2], \"y\": {}}, \"z\": null}\n",
+		PATCH_DELETE("/body/x/0"), PATCH_DELETE("/body/x/2"));
+	PATCH_CASE(doc, "{\"ts\": 1, \"route\": \"a\", \"body\": {\"x\": [1], \"y\": {}}, \"z\": null}\n",
+		PATCH_DELETE("/body/x/2"), PATCH_DELETE("/body/x/1"));
+	PATCH_CASE(doc, "{\"ts\": 1, \"route\": \"a\", \"body\": {\"x\": [9], \"y\": {}}, \"z\": null}\n",
+		PATCH_DELETE("/body/x/0"), PATCH_DELETE("/body/x/1"), PATCH_DELETE("/body/x/2"),
+		PATCH_INSERT("/body/x", NULL, "9"));
+
+	// inserts append, or replace a member already there
+	PATCH_CASE(doc, "{\"ts\": 5, \"route\": \"a\", \"body\": {\"x\": [1, 3,4], \"y\": {\"k\":\"v\"}}, \"z\": null,\"new\":[]}\n",
+		PATCH_DELETE("/body/x/1"), PATCH_INSERT("/body/x", NULL, "4"), PATCH_INSERT("/body/y", "k", "\"v\""),
+		PATCH_INSERT("", "ts", "5"), PATCH_INSERT("", "new", "[]"));
+	PATCH_CASE(doc, "[]\n",
+		PATCH_REPLACE("", "[]"));
+
+	// overlapping edits, missing paths and edits that do not fit their target
+	PATCH_CASE(doc, NULL, PATCH_REPLACE("/body", "0"), PATCH_REPLACE("/body/x", "1"));
+	PATCH_CASE(doc, NULL, PATCH_DELETE("/body"), PATCH_INSERT("/body/y", "a", "1"));
+	PATCH_CASE(doc, NULL, PATCH_DELETE("/nope"));
+	PATCH_CASE(doc, NULL, PATCH_DELETE(""));
+	PATCH_CASE(doc, NULL, PATCH_INSERT("/ts", "a", "1"));
+}
+
+/*
+ * Random edits on a root object of members k0..kn and an array a: the
+ * patched document must hold the members and elements left, in order, with
+ * their original text.
+ */
+static void patch_random(void)
+{
+	static char paths[PATCH_MEMBERS * 2][16];
+	struct json_test_buffer b = { NULL, 0, 0 };
+	size_t value_start[PATCH_MEMBERS], value_len[PATCH_MEMBERS];
+	json_jsmn_patch_t edits[PATCH_MEMBERS * 2];
+	int op[PATCH_MEMBERS], kept[PATCH_MEMBERS];
+	int members, elements, n, i, j, rc, inserted;
+	const json_jsmn_token_t *k, *end;
+	json_jsmn_t jjs;
+	char key[16];
+	char *out;
+
+	b.len = 0;
+	members = 1 + json_test_below(PATCH_MEMBERS);
+	elements = json_test_below(PATCH_MEMBERS);
+	json_test_puts(&b, "{");
+	for(i = 0; i < members; i++)
+	{
+		json_test_puts(&b, i ? "," : "");
+		json_test_space(&b);
+		snprintf(key, sizeof(key), "\"k%d\"", i);
+		json_test_puts(&b, key);
+		json_test_space(&b);
+		json_test_puts(&b, ":");
+		json_test_space(&b);
+		value_start[i] = b.len;
+		json_test_value(&b, 3);
+		value_len[i] = b.len - value_start[i];
+		json_test_space(&b);
+	}
+	json_test_puts(&b, ", \"a\": [");
+	for(i = 0; i < elements; i++)
+	{
+		snprintf(key, sizeof(key), i ? ",%d" : "%d", i);
+		json_test_puts(&b, key);
+		json_test_space(&b);
+	}
+	json_test_puts(&b, "]}");
+	json_test_put(&b, "", 1);
+
+	// 0 kept, 1 deleted, 2 replaced by "r"
+	for(i = 0, n = 0; i < members; i++)
+	{
+		op[i] = json_test_below(3);
+		if(!op[i])
+		{
+			continue;
+		}
+		snprintf(paths[n], sizeof(paths[n]), "/k%d", i);
+		edits[n].op = op[i] == 1 ? JSON_JSMN_PATCH_DELETE : JSON_JSMN_PATCH_REPLACE;
+		edits[n].path = paths[n];
+		edits[n].key = NULL;
+		edits[n].value = "\"r\"";
+		edits[n].value_len = 3;
+		n++;
+	}
+	for(i = 0; i < elements; i++)
+	{
+		kept[i] = json_test_below(2);
+		if(!kept[i])
+		{
+			snprintf(paths[n], sizeof(paths[n]), "/a/%d", i);
+			edits[n].op = JSON_JSMN_PATCH_DELETE;
+			edits[n].path = paths[n];
+			edits[n].key = NULL;
+			edits[n].value = NULL;
+			edits[n].value_len = 0;
+			n++;
+		}
+	}
+	inserted = json_test_below(2);
+	if(inserted)
+	{
+		edits[n].op = JSON_JSMN_PATCH_INSERT;
+		edits[n].path = "";
+		edits[n].key = "new";
+		edits[n].value = "true";
+		edits[n].value_len = 4;
+		n++;
+	}
+	// any order
+	for(i = n - 1; i > 0; i--)
+	{
+		json_jsmn_patch_t edit;
+
+		j = json_test_below(i + 1);
+		edit = edits[i];
+		edits[i] = edits[j];
+		edits[j] = edit;
+	}
+
+	out = patch_apply(b.data, edits, n, &rc);
+	JSON_TEST_CHECK(out != NULL);
+	if(!out || json_parse_document(&jjs, out, strlen(out), patch_tokens, PATCH_TOKENS, NULL) <= 0)
+	{
+		free(b.data);
+		return;
+	}
+
+	k = patch_tokens + 1;
+	end = patch_tokens + json_jsmn_span(&jjs, patch_tokens);
+	for(i = 0; i < members; i++)
+	{
+		if(op[i] == 1)
+		{
+			continue;
+		}
+		snprintf(key, sizeof(key), "k%d", i);
+		JSON_TEST_CHECK(k + 1 < end && !jsmntok_strcmp(out, k, key));
+		if(k + 1 >= end)
+		{
+			break;
+		}
+		if(op[i])
+		{
+			JSON_TEST_CHECK(k[1].type == JSMN_STRING && k[1].end - k[1].start == 1 && out[k[1].start] == 'r');
+		}
+		else
+		{
+			// strings are reported without their quotes
+			j = k[1].type == JSMN_STRING;
+			JSON_TEST_CHECK((size_t)(k[1].end - k[1].start + 2 * j) == value_len[i]);
+			JSON_TEST_CHECK(!memcmp(out + k[1].start - j, b.data + value_start[i], value_len[i]));
+		}
+		k += json_jsmn_span(&jjs, k);
+	}
+
+	JSON_TEST_CHECK(k + 1 < end && !jsmntok_strcmp(out, k, "a") && k[1].type == JSMN_ARRAY);
+	if(k + 1 < end)
+	{
+		const json_jsmn_token_t *e = k + 2;
+
+		for(i = 0; i < elements; i++)
+		{
+			if(kept[i])
+			{
+				JSON_TEST_CHECK(e < end && atoi(out + e->start) == i);
+				e++;
+			}
+		}
+		JSON_TEST_CHECK(e == k + json_jsmn_span(&jjs, k));
+		k = e;
+	}
+	if(inserted)
+	{
+		JSON_TEST_CHECK(k + 1 < end && !jsmntok_strcmp(out, k, "new"));
+		k += 2;
+	}
+	JSON_TEST_CHECK(k == end);
+	free(b.data);
+}
+
+int main(void)
+{
+	int i;
+
+	patch_cases();
+	for(i = 0; i < PATCH_ITERATIONS; i++)
+	{
+		patch_random();
+	}
+	return json_test_result("json_test_patch");
+}
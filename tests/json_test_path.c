@@ -0,0 +1,64 @@
+/*
+ * json_jsmn_path_query(): every path resolves to the first matching member,
+ * whatever the other paths of the same walk and any later duplicate key.
+ */
+#include "json_test.h"
+#include "json_jsmn_path.h"
+#include "json_parser.h"
+
+#define PATH_TOKENS					256
+
+static json_jsmn_token_t path_tokens[PATH_TOKENS];
+
+// value text of the match of paths[i], "-" when unresolved
+static void path_case(const char *js, const char **paths, int count, const char **expected)
+{
+	json_jsmntok_t results[JSON_JSMN_PATH_MAX];
+	json_jsmn_t jjs;
+	const json_jsmn_token_t *t;
+	int i, n, rc;
+
+	JSON_TEST_CHECK(json_parse_document(&jjs, js, strlen(js), path_tokens, PATH_TOKENS, NULL) > 0);
+	rc = json_jsmn_path_query(&jjs, paths, count, results);
+	for(i = 0, n = 0; i < count; i++)
+	{
+		t = results[i].t_value;
+		if(!t)
+		{
+			JSON_TEST_CHECK(!strcmp(expected[i], "-"));
+			continue;
+		}
+		n++;
+		JSON_TEST_CHECK((size_t)(t->end - t->start) == strlen(expected[i]));
+		JSON_TEST_CHECK(!strncmp(js + t->start, expected[i], t->end - t->start));
+	}
+	JSON_TEST_CHECK(rc == n);
+}
+
+int main(void)
+{
+	const char *doc = "{\"a\": {\"x\": 1, \"y\": [10, 20, {\"z\": 30}]}, \"b\": 2, \"a/b\": 3, \"m~n\": 4, \"b\": 5}";
+
+	{
+		const char *paths[] = { "/a/x", "/a/y/1", "/a/y/2/z", "/b", "/a~1b", "/m~0n", "/a/y/3", "/c", "" };
+		const char *expected[] = { "1", "20", "30", "2", "3", "4", "-", "-", doc };
+		path_case(doc, paths, 9, expected);
+	}
+	{
+		// the duplicate "b" comes after every other path resolved
+		const char *paths[] = { "/b" };
+		const char *expected[] = { "2" };
+		path_case(doc, paths, 1, expected);
+	}
+	{
+		const char *paths[] = { "/k", "/k/v" };
+		const char *expected[] = { "{\"v\": 1}", "1" };
+		path_case("{\"k\": {\"v\": 1}, \"k\": {\"v\": 2}, \"k\": 3}", paths, 2, expected);
+	}
+	{
+		const char *paths[] = { "/k/v", "/j" };
+		const char *expected[] = { "1", "4" };
+		path_case("{\"k\": {\"v\": 1}, \"k\": {\"v\": 2}, \"j\": 4, \"j\": 5}", paths, 2, expected);
+	}
+	return json_test_result("json_test_path");
+}
@@ -0,0 +1,270 @@
+/*
+ * json_jsmn_project*() round trips: the writer and slice outputs must be the
+ * same valid JSON, holding the selected members with their original text.
+ */
+#include "json_test.h"
+#include "json_jsmn_project.h"
+#include "json_parser.h"
+
+#define PROJECT_ITERATIONS			5000
+#define PROJECT_TOKENS				1024
+#define PROJECT_MEMBERS				12
+#define PROJECT_SLICES				256
+
+static json_jsmn_token_t project_tokens[PROJECT_TOKENS];
+static unsigned int project_spans[PROJECT_TOKENS];
+
+struct project_result
+{
+	int rc;
+	char text[64 * 1024];
+};
+
+static void project_slices_join(const json_jsmn_slice_t *slices, int count, struct project_result *r)
+{
+	size_t len;
+	int i;
+
+	for(i = 0, len = 0; i < count; i++)
+	{
+		if(len + slices[i].iov_len >= sizeof(r->text))
+		{
+			JSON_TEST_CHECK(!"output size");
+			break;
+		}
+		memcpy(r->text + len, slices[i].iov_base, slices[i].iov_len);
+		len += slices[i].iov_len;
+	}
+	r->text[len] = '\0';
+}
+
+/*
+ * Project js on keys (paths NULL) or on paths to both outputs, which must
+ * agree; writer receives the writer output.
+ */
+static void project_run
+	(
+		const char *js,
+		const char **keys,
+		const char **paths, int paths_count,
+		struct project_result *writer
+	)
+{
+	static json_jsmn_slice_t slices[PROJECT_SLICES];
+	static struct project_result sliced;
+	json_jsmn_project_out_t out;
+	json_jsmn_writer_t w;
+	json_jsmn_t jjs;
+
+	if(json_parse_document(&jjs, js, strlen(js), project_tokens, PROJECT_TOKENS, project_spans) < 0)
+	{
+		JSON_TEST_CHECK(!"document");
+		writer->rc = JSMN_ERROR_INVAL;
+		return;
+	}
+
+	json_jsmn_writer_init(&w, writer->text, sizeof(writer->text), NULL, NULL);
+	json_jsmn_project_out_writer(&out, &w);
+	writer->rc = paths ? json_jsmn_project_paths(&jjs, paths, paths_count, &out) : json_jsmn_project(&jjs, keys, &out);
+	if(json_jsmn_writer_finish(&w) < 0)
+	{
+		writer->rc = writer->rc < 0 ? writer->rc : JSMN_ERROR_NOMEM;
+	}
+
+	json_jsmn_project_out_slices(&out, slices, PROJECT_SLICES);
+	sliced.rc = paths ? json_jsmn_project_paths(&jjs, paths, paths_count, &out) : json_jsmn_project(&jjs, keys, &out);
+	JSON_TEST_CHECK(sliced.rc == writer->rc);
+	if(writer->rc < 0)
+	{
+		return;
+	}
+	project_slices_join(slices, out.count, &sliced);
+	JSON_TEST_CHECK(!strcmp(sliced.text, writer->text));
+
+	// the projection is a document again
+	JSON_TEST_CHECK(json_parse_document(&jjs, writer->text, strlen(writer->text), project_tokens, PROJECT_TOKENS, NULL) > 0);
+}
+
+static void project_case(const char *js, const char **keys, const char **paths, int paths_count, const char *expected)
+{
+	static struct project_result r;
+
+	project_run(js, keys, paths, paths_count, &r);
+	if(!expected)
+	{
+		JSON_TEST_CHECK(r.rc == JSMN_ERROR_INVAL);
+		return;
+	}
+	JSON_TEST_CHECK(r.rc >= 0 && !strcmp(r.text, expected));
+	if(r.rc >= 0 && strcmp(r.text, expected))
+	{
+		printf("  got      %s\n  expected %s\n", r.text, expected);
+	}
+}
+
+static void project_cases(void)
+{
+	const char *doc = "{ \"id\" : 7, \"n\\\"q\": \"s\\n\", \"skip\": {\"id\": 1}, "
+		"\"tel\": {\"bat\": {\"v\": 3.7, \"a\": 1}, \"t\": [1, {\"x\": 2, \"y\": 3}, 4]}, \"list\": [ 1 , 2 ] }";
+	json_jsmn_keyset_slot_t slots[8];
+	json_jsmn_keyset_t keyset;
+	json_jsmn_project_out_t out;
+	json_jsmn_slice_t slices[3];
+	json_jsmn_writer_t w;
+	json_jsmn_t jjs;
+	char buffer[256];
+	int rc;
+
+	{
+		const char *keys[] = { "id", "list", "n\\\"q", NULL };
+		project_case(doc, keys, NULL, 0, "{\"id\":7,\"n\\\"q\":\"s\\n\",\"list\":[ 1 , 2 ]}");
+	}
+	{
+		const char *keys[] = { "none", NULL };
+		project_case(doc, keys, NULL, 0, "{}");
+	}
+	project_case("[1]", NULL, NULL, 0, NULL);
+
+	// paths keep the containers leading to them, array elements renumbered
+	{
+		const char *paths[] = { "/tel/bat/v", "/id", "/tel/t/1/y", "/missing/x", "/list/1" };
+		project_case(doc, NULL, paths, 5, "{\"id\":7,\"tel\":{\"bat\":{\"v\":3.7},\"t\":[{\"y\":3}]},\"list\":[2]}");
+	}
+	{
+		const char *paths[] = { "/tel/t/2", "/tel/bat" };
+		project_case(doc, NULL, paths, 2, "{\"tel\":{\"bat\":{\"v\": 3.7, \"a\": 1},\"t\":[4]}}");
+	}
+	{
+		const char *paths[] = { "/id", "" };
+		project_case(doc, NULL, paths, 2, doc);
+	}
+	{
+		const char *paths[] = { "/1/x" };
+		project_case("[0, {\"x\": [1]}, 2]", NULL, paths, 1, "[{\"x\":[1]}]");
+	}
+	{
+		const char *paths[] = { "/nothing" };
+		project_case(doc, NULL, paths, 1, "{}");
+	}
+
+	// short slices, keyset
+	{
+		const char *keys[] = { "id", "tel", NULL };
+
+		json_parse_document(&jjs, doc, strlen(doc), project_tokens, PROJECT_TOKENS, project_spans);
+		json_jsmn_project_out_slices(&out, slices, 3);
+		JSON_TEST_CHECK(json_jsmn_project(&jjs, keys, &out) == JSMN_ERROR_NOMEM);
+
+		json_jsmn_keyset_init(&keyset, slots, 8, keys);
+		json_jsmn_writer_init(&w, buffer, sizeof(buffer), NULL, NULL);
+		json_jsmn_project_out_writer(&out, &w);
+		rc = json_jsmn_project_keyset(&jjs, &keyset, &out);
+		json_jsmn_writer_finish(&w);
+		JSON_TEST_CHECK(rc == 2);
+		JSON_TEST_CHECK(!strcmp(buffer, "{\"id\":7,\"tel\":{\"bat\": {\"v\": 3.7, \"a\": 1}, \"t\": [1, {\"x\": 2, \"y\": 3}, 4]}}"));
+	}
+}
+
+/*
+ * Random selection of the members k0..kn of a generated root object: keys
+ * and the matching paths must give the same projection, made of the
+ * selected members in document order with their original value text.
+ */
+static void project_random(void)
+{
+	static char names[PROJECT_MEMBERS][8], paths[PROJECT_MEMBERS][8];
+	static struct project_result by_keys, by_paths;
+	struct json_test_buffer b = { NULL, 0, 0 };
+	size_t value_start[PROJECT_MEMBERS], value_len[PROJECT_MEMBERS];
+	const char *keys[PROJECT_MEMBERS + 1], *path_list[PROJECT_MEMBERS];
+	int selected[PROJECT_MEMBERS];
+	int members, n, i, j;
+	const json_jsmn_token_t *k, *end;
+	json_jsmn_t jjs;
+
+	members = 1 + json_test_below(PROJECT_MEMBERS);
+	json_test_puts(&b, "{");
+	for(i = 0; i < members; i++)
+	{
+		json_test_puts(&b, i ? "," : "");
+		json_test_space(&b);
+		snprintf(names[i], sizeof(names[i]), "k%d", i);
+		snprintf(paths[i], sizeof(paths[i]), "/k%d", i);
+		json_test_puts(&b, "\"");
+		json_test_puts(&b, names[i]);
+		json_test_puts(&b, "\":");
+		json_test_space(&b);
+		value_start[i] = b.len;
+		json_test_value(&b, 2);
+		value_len[i] = b.len - value_start[i];
+		json_test_space(&b);
+	}
+	json_test_puts(&b, "}");
+	json_test_put(&b, "", 1);
+
+	// filter order does not matter, output follows the document
+	for(i = 0, n = 0; i < members; i++)
+	{
+		selected[i] = json_test_below(2);
+		if(selected[i])
+		{
+			keys[n] = names[i];
+			path_list[n] = paths[i];
+			n++;
+		}
+	}
+	keys[n] = NULL;
+	for(i = n - 1; i > 0; i--)
+	{
+		const char *t;
+
+		j = json_test_below(i + 1);
+		t = keys[i];
+		keys[i] = keys[j];
+		keys[j] = t;
+	}
+
+	project_run(b.data, keys, NULL, 0, &by_keys);
+	project_run(b.data, NULL, path_list, n, &by_paths);
+	JSON_TEST_CHECK(by_keys.rc == n && by_paths.rc == n);
+	JSON_TEST_CHECK(!strcmp(by_keys.text, by_paths.text));
+	if(by_keys.rc != n || json_parse_document(&jjs, by_keys.text, strlen(by_keys.text), project_tokens, PROJECT_TOKENS, NULL) <= 0)
+	{
+		free(b.data);
+		return;
+	}
+
+	k = project_tokens + 1;
+	end = project_tokens + json_jsmn_span(&jjs, project_tokens);
+	for(i = 0; i < members; i++)
+	{
+		if(!selected[i])
+		{
+			continue;
+		}
+		JSON_TEST_CHECK(k + 1 < end && !jsmntok_strcmp(by_keys.text, k, names[i]));
+		if(k + 1 >= end)
+		{
+			break;
+		}
+		// strings are reported without their quotes
+		j = k[1].type == JSMN_STRING;
+		JSON_TEST_CHECK((size_t)(k[1].end - k[1].start + 2 * j) == value_len[i]);
+		JSON_TEST_CHECK(!memcmp(by_keys.text + k[1].start - j, b.data + value_start[i], value_len[i]));
+		k += json_jsmn_span(&jjs, k);
+	}
+	JSON_TEST_CHECK(k == end);
+	free(b.data);
+}
+
+int main(void)
+{
+	int i;
+
+	project_cases();
+	for(i = 0; i < PROJECT_ITERATIONS; i++)
+	{
+		project_random();
+	}
+	return json_test_result("json_test_project");
+}
@@ -0,0 +1,279 @@
+/*
+ * json_jsmn_scan() against jsmn_parse() on generated documents, valid, cut
+ * and mangled: return codes, parser state and tokens must be identical in
+ * the full, counting (tokens NULL), JSMN_ERROR_NOMEM and JSMN_ERROR_PART
+ * resume modes, also for containers wider than the tokenizer walks back
+ * over and nested deeper than its open stack. The compact and parallel
+ * tokenizers are checked against the serial ones.
+ */
+#include "json_test.h"
+#include "jsmn/jsmn.h"
+#include "json_jsmn_scan.h"
+
+#define SCAN_ITERATIONS				20000
+#define SCAN_TOKENS					1024
+#define SCAN_CHUNK					(1024 * 1024)	// JSON_JSMN_SCAN_CHUNK
+
+static jsmntok_t scan_expected[SCAN_TOKENS];
+static jsmntok_t scan_tokens[SCAN_TOKENS];
+
+static void scan_mangle(struct json_test_buffer *b)
+{
+	static const char bytes[] = "{}[]\":,\\ x0";
+
+	switch(json_test_below(4))
+	{
+	case 0:
+		// cut anywhere
+		b->len = json_test_below(b->len + 1);
+		break;
+	case 1:
+		b->data[json_test_below(b->len)] = bytes[json_test_below(sizeof(bytes))];
+		break;
+	default:
+		break;
+	}
+}
+
+// same result, parser state and tokens from both tokenizers
+static void scan_compare(int expected, int rc, const jsmn_parser *p1, const jsmn_parser *p2, unsigned int count)
+{
+	JSON_TEST_CHECK(expected == rc);
+	JSON_TEST_CHECK(!memcmp(p1, p2, sizeof(*p1)));
+	JSON_TEST_CHECK(!memcmp(scan_expected, scan_tokens, count * sizeof(jsmntok_t)));
+}
+
+static void scan_document(const char *js, size_t len)
+{
+	jsmn_parser p1, p2;
+	unsigned int num_tokens;
+	size_t cut;
+	int expected, rc;
+
+	// full
+	memset(scan_expected, 0x5a, sizeof(scan_expected));
+	memset(scan_tokens, 0x5a, sizeof(scan_tokens));
+	jsmn_init(&p1);
+	jsmn_init(&p2);
+	expected = jsmn_parse(&p1, js, len, scan_expected, SCAN_TOKENS);
+	rc = json_jsmn_scan(&p2, js, len, scan_tokens, SCAN_TOKENS);
+	scan_compare(expected, rc, &p1, &p2, SCAN_TOKENS);
+
+	// counting
+	jsmn_init(&p1);
+	jsmn_init(&p2);
+	expected = jsmn_parse(&p1, js, len, NULL, 0);
+	rc = json_jsmn_scan(&p2, js, len, NULL, 0);
+	JSON_TEST_CHECK(expected == rc);
+	JSON_TEST_CHECK(!memcmp(&p1, &p2, sizeof(p1)));
+
+	// too few tokens, then resumed with enough
+	num_tokens = json_test_below(8);
+	memset(scan_expected, 0x5a, sizeof(scan_expected));
+	memset(scan_tokens, 0x5a, sizeof(scan_tokens));
+	jsmn_init(&p1);
+	jsmn_init(&p2);
+	expected = jsmn_parse(&p1, js, len, scan_expected, num_tokens);
+	rc = json_jsmn_scan(&p2, js, len, scan_tokens, num_tokens);
+	scan_compare(expected, rc, &p1, &p2, SCAN_TOKENS);
+	if(expected == JSMN_ERROR_NOMEM)
+	{
+		expected = jsmn_parse(&p1, js, len, scan_expected, SCAN_TOKENS);
+		rc = json_jsmn_scan(&p2, js, len, scan_tokens, SCAN_TOKENS);
+		scan_compare(expected, rc, &p1, &p2, SCAN_TOKENS);
+	}
+
+	// a prefix first, then the whole input
+	cut = json_test_below(len + 1);
+	memset(scan_expected, 0x5a, sizeof(scan_expected));
+	memset(scan_tokens, 0x5a, sizeof(scan_tokens));
+	jsmn_init(&p1);
+	jsmn_init(&p2);
+	expected = jsmn_parse(&p1, js, cut, scan_expected, SCAN_TOKENS);
+	rc = json_jsmn_scan(&p2, js, cut, scan_tokens, SCAN_TOKENS);
+	scan_compare(expected, rc, &p1, &p2, SCAN_TOKENS);
+	if(expected == JSMN_ERROR_PART)
+	{
+		expected = jsmn_parse(&p1, js, len, scan_expected, SCAN_TOKENS);
+		rc = json_jsmn_scan(&p2, js, len, scan_tokens, SCAN_TOKENS);
+		scan_compare(expected, rc, &p1, &p2, SCAN_TOKENS);
+	}
+
+#ifndef JSON_JSMN_COMPACT_TOKENS
+	// json_jsmn_scan_resume() fed growing prefixes, jsmn_parse() the same ones
+	{
+		json_jsmn_scan_state_t state;
+
+		memset(scan_expected, 0x5a, sizeof(scan_expected));
+		memset(scan_tokens, 0x5a, sizeof(scan_tokens));
+		jsmn_init(&p1);
+		jsmn_init(&p2);
+		json_jsmn_scan_state_init(&state);
+		for(cut = 0, expected = rc = JSMN_ERROR_PART; cut < len && expected == JSMN_ERROR_PART && rc == expected; )
+		{
+			cut += 1 + json_test_below(json_test_below(2) ? 8 : 200);
+			cut = cut < len ? cut : len;
+			expected = jsmn_parse(&p1, js, cut, scan_expected, SCAN_TOKENS);
+			rc = json_jsmn_scan_resume(&p2, &state, js, cut, scan_tokens, SCAN_TOKENS);
+			scan_compare(expected, rc, &p1, &p2, SCAN_TOKENS);
+		}
+	}
+#else
+	{
+		json_jsmn_token_t compact[SCAN_TOKENS];
+		int i;
+
+		jsmn_init(&p1);
+		jsmn_init(&p2);
+		expected = jsmn_parse(&p1, js, len, scan_expected, SCAN_TOKENS);
+		rc = json_jsmn_scan_compact(&p2, js, len, compact, SCAN_TOKENS);
+		JSON_TEST_CHECK(expected == rc);
+		for(i = 0; i < expected; i++)
+		{
+			JSON_TEST_CHECK
+				(
+					compact[i].start == scan_expected[i].start &&
+					compact[i].end == scan_expected[i].end &&
+					compact[i].type == (unsigned int)scan_expected[i].type
+				);
+		}
+	}
+#endif
+}
+
+// siblings after a nested container: the one a ',' or bracket returns to is far back
+static void scan_siblings(struct json_test_buffer *b, int object, unsigned int n)
+{
+	unsigned int i;
+
+	for(i = 0; i < n; i++)
+	{
+		json_test_puts(b, ",");
+		if(object)
+		{
+			json_test_string(b);
+			json_test_puts(b, ":");
+		}
+		json_test_puts(b, json_test_below(2) ? "7" : "\"s\"");
+	}
+}
+
+// up to 100 levels, up to 300 siblings at any of them
+static void scan_shape(struct json_test_buffer *b)
+{
+	char object[100];
+	unsigned int depth, i;
+
+	depth = 1 + json_test_below(100);
+	for(i = 0; i < depth; i++)
+	{
+		object[i] = (char)json_test_below(2);
+		json_test_puts(b, object[i] ? "{\"k\":" : "[");
+	}
+	json_test_value(b, 5);
+	for(i = depth; i-- > 0; )
+	{
+		scan_siblings(b, object[i], json_test_below(4) ? json_test_below(3) : json_test_below(300));
+		json_test_puts(b, object[i] ? "}" : "]");
+	}
+}
+
+// documents of several chunks on several threads, against the serial tokenizer
+static void scan_parallel_compare(const struct json_test_buffer *b, int valid)
+{
+	json_jsmn_token_t *serial, *parallel;
+	jsmn_parser p;
+	int count, expected, rc;
+
+	jsmn_init(&p);
+	count = jsmn_parse(&p, b->data, b->len, NULL, 0);
+	JSON_TEST_CHECK(count > 0);
+	serial = calloc(count, sizeof(*serial));
+	parallel = calloc(count, sizeof(*parallel));
+
+	jsmn_init(&p);
+#ifdef JSON_JSMN_COMPACT_TOKENS
+	expected = json_jsmn_scan_compact(&p, b->data, b->len, serial, count);
+#else
+	expected = json_jsmn_scan(&p, b->data, b->len, serial, count);
+#endif
+	rc = json_jsmn_scan_parallel(b->data, b->len, parallel, count, 4);
+	JSON_TEST_CHECK(expected == count || !valid);
+	JSON_TEST_CHECK(rc == expected);
+	if(expected > 0)
+	{
+		JSON_TEST_CHECK(!memcmp(serial, parallel, expected * sizeof(*serial)));
+	}
+
+	if(valid)
+	{
+		// short token array: the same error as the serial tokenizer
+		JSON_TEST_CHECK(json_jsmn_scan_parallel(b->data, b->len, parallel, count - 1, 4) == JSMN_ERROR_NOMEM);
+	}
+
+	free(serial);
+	free(parallel);
+}
+
+// a valid array, then ':' where jsmn takes it outside an object, its last ',' starting the second chunk
+static void scan_parallel(void)
+{
+	static const char *stray[] = { "", "[[]:,", "[]:7,", "1:2,", "{\"k\":[7]:8}," };
+	struct json_test_buffer b = { NULL, 0, 0 };
+	const char *insert;
+	unsigned int i;
+
+	for(i = 0; i < sizeof(stray) / sizeof(stray[0]); i++)
+	{
+		b.len = 0;
+		insert = stray[i];
+		json_test_puts(&b, "[");
+		while(b.len < (i ? 2 * SCAN_CHUNK + 4096 : 3 * SCAN_CHUNK))
+		{
+			json_test_document(&b);
+			json_test_puts(&b, ",\n");
+			if(*insert && b.len + 64 * 1024 > SCAN_CHUNK)
+			{
+				while(b.len + strlen(insert) <= SCAN_CHUNK)
+				{
+					json_test_puts(&b, " ");
+				}
+				json_test_puts(&b, insert);
+				insert = "";
+			}
+		}
+		json_test_puts(&b, "0]");
+		scan_parallel_compare(&b, !i);
+	}
+	free(b.data);
+}
+
+int main(void)
+{
+	struct json_test_buffer b = { NULL, 0, 0 };
+	int i;
+
+	printf("scanner: %s\n", json_jsmn_scan_impl());
+	for(i = 0; i < SCAN_ITERATIONS; i++)
+	{
+		b.len = 0;
+		switch(json_test_below(8))
+		{
+		case 0:
+			json_test_value(&b, 3);
+			break;
+		case 1:
+			scan_shape(&b);
+			break;
+		default:
+			json_test_document(&b);
+			break;
+		}
+		scan_mangle(&b);
+		scan_document(b.data, b.len);
+	}
+	free(b.data);
+
+	scan_parallel();
+	return json_test_result("json_test_scan");
+}